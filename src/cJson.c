@@ -9,12 +9,73 @@
 **********************************************************************************/
 #include <stdio.h>
 #include <assert.h>   /* assert() */
-#include <errno.h>    /* errno, ERANGE */
-#include <math.h>     /*HUGE_VAL*/
-#include <stdlib.h>   /* NULL, strtod(), malloc(), realloc(), free() */
+#include <float.h>    /*FLT_EVAL_METHOD*/
+#include <stdlib.h>   /* NULL, malloc(), realloc(), free() */
 #include <string.h>   /*memcpy*/
+#include <stdint.h>   /*uintptr_t, uint64_t*/
+#include <errno.h>    /*EINTR*/
+#if defined(_WIN32)
+#include <io.h>       /*_write*/
+#else
+#include <unistd.h>   /*write*/
+#endif
+#if !defined(CJSON_NO_THREADS)
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>  /*_beginthreadex*/
+#else
+#include <pthread.h>  /*pthread_create, pthread_join*/
+#endif
+#endif
 #include "cJson.h"
 #include "cJsonStruct.h"
+#include "cJsonPow5.h"
+
+//字符串扫描的SIMD实现：AVX2每次32字节，SSE2每次16字节，都不支持时逐字节扫描
+#if defined(__AVX2__)
+#define CJSON_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CJSON_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static unsigned int CountTrailingZeros(unsigned int x) { unsigned long i; _BitScanForward(&i, x); return (unsigned int)i; }
+static unsigned int CountTrailingZeros64(uint64_t x)
+{
+    unsigned long i;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanForward64(&i, x);
+#else
+    if(!_BitScanForward(&i, (unsigned long)x)){
+        _BitScanForward(&i, (unsigned long)(x >> 32));
+        i += 32;
+    }
+#endif
+    return (unsigned int)i;
+}
+#define CTZ(x)             CountTrailingZeros(x)
+#define CTZ64(x)           CountTrailingZeros64(x)
+#else
+#define CTZ(x)             ((unsigned int)__builtin_ctz(x))
+#define CTZ64(x)           ((unsigned int)__builtin_ctzll(x))
+#endif
+
+//ParseNumber中尾数最多累加的有效数字位数，19位十进制数一定能放进uint64_t
+#define NUMBER_MAX_DIGITS  19
+//慢速路径中参与大整数比较的最多有效数字位数，超过后只记录是否还有非0数字
+#define NUMBER_MAX_BIG_DIGITS 800
+//慢速路径大整数的32位字数，足够容纳NUMBER_MAX_BIG_DIGITS位数字乘以5的幂再移位后的结果
+#define BIGINT_LIMBS       200
+
+//SIMD扫描按对齐块读取，可能读到字符串结尾之后同一块内的字节，不会越过页边界，但需要让ASan忽略
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define NO_SANITIZE_ADDRESS
+#endif
 
 //用 #ifndef X #define X ... #endif 的好处是：可在编译选项中自行设置宏，没设置就用缺省值
 #ifndef STACK_INIT_SIZE
@@ -25,24 +86,463 @@
 #define STRINGIFY_STACK_INIT_SIZE 256
 #endif
 
+//流式生成时内部缓冲区的大小，写满后交给输出函数，整个生成过程只占用这么多内存
+#ifndef STRINGIFY_WRITER_BUFFER_SIZE
+#define STRINGIFY_WRITER_BUFFER_SIZE (16 * 1024)
+#endif
+
+//文档中每个内存块的大小，超过该大小的单次申请会单独占用一个块
+#ifndef DOCUMENT_CHUNK_SIZE
+#define DOCUMENT_CHUNK_SIZE (64 * 1024)
+#endif
+
+//文档分配的对齐字节数，需要满足double和指针的对齐要求
+#define DOCUMENT_ALIGN     sizeof(double)
+#define DOCUMENT_ROUND(size) (((size) + DOCUMENT_ALIGN - 1) & ~(size_t)(DOCUMENT_ALIGN - 1))
+
+//成员个数不少于该值的对象，按键查找时建立哈希索引，更小的对象直接顺序比较
+#ifndef OBJECT_INDEX_THRESHOLD
+#define OBJECT_INDEX_THRESHOLD 16
+#endif
+
+//解析字符串时是否检查UTF-8编码，为0时字符串中的字节原样接受
+#ifndef PARSE_VALIDATE_UTF8
+#define PARSE_VALIDATE_UTF8 1
+#endif
+
+//数组、对象通过PushBackArrayElement、SetObjectValue追加元素时的最小容量
+#ifndef CONTAINER_INIT_SIZE
+#define CONTAINER_INIT_SIZE 4
+#endif
+
+//磁带和字符串区的初始容量
+#ifndef TAPE_INIT_SIZE
+#define TAPE_INIT_SIZE 256
+#endif
+
+//增量解析器嵌套层次栈的初始容量
+#ifndef PARSER_LEVEL_INIT_SIZE
+#define PARSER_LEVEL_INIT_SIZE 16
+#endif
+
+//解析时数组、对象最多嵌套的层数，超过时返回PARSE_DEPTH_EXCEEDED
+#ifndef PARSE_MAX_DEPTH
+#define PARSE_MAX_DEPTH 1024
+#endif
+
+//生成、释放节点树时显式栈放在函数内的层数，嵌套更深时才申请内存
+#ifndef WALK_INIT_SIZE
+#define WALK_INIT_SIZE 32
+#endif
+
+//ParseValue的层次栈放在函数内的层数，嵌套更深时才申请内存
+#ifndef PARSE_LEVEL_INIT_SIZE
+#define PARSE_LEVEL_INIT_SIZE 32
+#endif
+
+//并行解析时每个线程至少分到的输入字节数，更小的输入不值得创建线程
+#ifndef PARSE_PARALLEL_MIN_SIZE
+#define PARSE_PARALLEL_MIN_SIZE (64 * 1024)
+#endif
+
+//NDJSON批量解析时每一批的输入字节数，一批由一个线程解析，结果按批交付
+#ifndef PARSE_LINES_BATCH_SIZE
+#define PARSE_LINES_BATCH_SIZE (64 * 1024)
+#endif
+
+//定义CJSON_NO_THREADS时不使用线程，ParseParallelInDocument、ParseLines在调用线程中完成
+#if !defined(CJSON_NO_THREADS)
+#if defined(_WIN32)
+typedef HANDLE CJSONThread;
+typedef unsigned (__stdcall *CJSONThreadFunc)(void *);
+typedef CRITICAL_SECTION CJSONMutex;
+typedef CONDITION_VARIABLE CJSONCond;
+#define THREAD_FUNC(name)   static unsigned __stdcall name(void *arg)
+#define MUTEX_INIT(m)       InitializeCriticalSection(m)
+#define MUTEX_DESTROY(m)    DeleteCriticalSection(m)
+#define MUTEX_LOCK(m)       EnterCriticalSection(m)
+#define MUTEX_UNLOCK(m)     LeaveCriticalSection(m)
+#define COND_INIT(cv)       InitializeConditionVariable(cv)
+#define COND_DESTROY(cv)    ((void)(cv))
+#define COND_WAIT(cv, m)    SleepConditionVariableCS(cv, m, INFINITE)
+#define COND_BROADCAST(cv)  WakeAllConditionVariable(cv)
+#else
+typedef pthread_t CJSONThread;
+typedef void *(*CJSONThreadFunc)(void *);
+typedef pthread_mutex_t CJSONMutex;
+typedef pthread_cond_t CJSONCond;
+#define THREAD_FUNC(name)   static void *name(void *arg)
+#define MUTEX_INIT(m)       pthread_mutex_init(m, NULL)
+#define MUTEX_DESTROY(m)    pthread_mutex_destroy(m)
+#define MUTEX_LOCK(m)       pthread_mutex_lock(m)
+#define MUTEX_UNLOCK(m)     pthread_mutex_unlock(m)
+#define COND_INIT(cv)       pthread_cond_init(cv, NULL)
+#define COND_DESTROY(cv)    pthread_cond_destroy(cv)
+#define COND_WAIT(cv, m)    pthread_cond_wait(cv, m)
+#define COND_BROADCAST(cv)  pthread_cond_broadcast(cv)
+#endif
+#endif
+
+//定义CJSON_STATS时收集解析、生成的统计信息，否则下面的宏都是空的，不产生任何代码
+#if defined(CJSON_STATS)
+#if defined(CJSON_NO_THREADS)
+#define STATS_TLS
+#elif defined(_MSC_VER)
+#define STATS_TLS           __declspec(thread)
+#else
+#define STATS_TLS           __thread
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define READ_CYCLES()       __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define READ_CYCLES()       __rdtsc()
+#else
+#include <time.h>
+#define READ_CYCLES()       ReadNanoseconds()
+static unsigned long long ReadNanoseconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+static STATS_TLS CJSONStats threadStats;
+static STATS_TLS size_t threadStackPeak;   //当前这次解析或生成的栈最大使用量
+#define STATS_ADD(field, n) (threadStats.field += (n))
+#define STATS_MAX(field, n) do { if((size_t)(n) > threadStats.field) threadStats.field = (n); } while(0)
+#define STATS_PEAK(c)       do { if((c)->top > threadStackPeak) threadStackPeak = (c)->top; } while(0)
+//一次解析或生成开始时记下输入位置(输出位置)和周期计数，结束时累计到对应的统计项
+#define STATS_PARSE_BEGIN(c) \
+    const char *statsJson = (c)->json; unsigned long long statsCycles = (threadStackPeak = 0, READ_CYCLES())
+#define STATS_PARSE_END(c) \
+    do { threadStats.parses++; threadStats.parseBytes += (size_t)((c)->json - statsJson); \
+        threadStats.parseCycles += READ_CYCLES() - statsCycles; STATS_MAX(parseStackPeak, threadStackPeak); } while(0)
+#define STATS_STRINGIFY_BEGIN(c) \
+    size_t statsTop = (c)->top; unsigned long long statsCycles = (threadStackPeak = 0, READ_CYCLES())
+#define STATS_STRINGIFY_END(c) \
+    do { threadStats.stringifies++; if((c)->write == NULL) threadStats.stringifyBytes += (c)->top - statsTop; \
+        threadStats.stringifyCycles += READ_CYCLES() - statsCycles; STATS_MAX(stringifyStackPeak, threadStackPeak); } while(0)
+#else
+#define STATS_ADD(field, n) ((void)0)
+#define STATS_MAX(field, n) ((void)0)
+#define STATS_PEAK(c)       ((void)0)
+#define STATS_PARSE_BEGIN(c) ((void)0)
+#define STATS_PARSE_END(c)  ((void)0)
+#define STATS_STRINGIFY_BEGIN(c) ((void)0)
+#define STATS_STRINGIFY_END(c) ((void)0)
+#endif
+
 #define EXPECT(c, ch)      do { assert(*c->json == (ch)); c->json++;} while(0)
+#define ISWHITESPACE(ch)   ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+//读取p处的字符，到达输入结尾时得到'\0'，只用于和非'\0'的字符比较
+#define PEEK(p, end)       ((p) < (end) ? *(p) : '\0')
 #define ISDIGIT(ch)        ((ch) >= '0' && (ch) <= '9')
 #define ISDIGIT1TO9(ch)    ((ch) >= '1' && (ch) <= '9')
+#define ISHEX(ch)          (ISDIGIT(ch) || ((ch) >= 'A' && (ch) <= 'F') || ((ch) >= 'a' && (ch) <= 'f'))
 #define PUTC(c, ch)        do { *(char *)ContextPush(c, sizeof(char)) = (ch); } while(0)
-//在栈上申请len字节，将s字符串的内容拷贝进去
-#define PUTS(c, s, len)    memcpy(ContextPush(c, len), s, len)
+//在栈上申请len字节，将s字符串的内容拷贝进去，len为0时什么也不做
+#define PUTS(c, s, len)    do { size_t _n = (len); if(_n > 0) memcpy(ContextPush(c, _n), s, _n); } while(0)
+//生成JSON时输出内容，有输出函数时缓冲区满了先交给输出函数，不再扩展缓冲区
+#define OUTC(c, ch)        do { *(char *)OutputPush(c, sizeof(char)) = (ch); } while(0)
+#define OUTS(c, s, len)    OutputWrite(c, s, len)
+//磁带中的字：高8位是类型标记，低56位是内容
+#define TAPE_WORD(tag, payload) (((unsigned long long)(unsigned char)(tag) << 56) | (unsigned long long)(payload))
+#define TAPE_TAG(w)        ((char)((w) >> 56))
+#define TAPE_PAYLOAD(w)    ((size_t)((w) & 0x00FFFFFFFFFFFFFFULL))
+//按需解析的数组、对象在第一次访问时展开，展开会改写节点，所以const节点也需要转换
+#define MATERIALIZE(v)     do { if((v)->flags & VALUE_FLAG_LAZY) LazyMaterialize((CJSONValue *)(v)); } while(0)
+//展开失败时记下的错误码，其他节点为PARSE_OK
+#define VALUE_ERROR(v)     ((int)((v)->flags >> VALUE_ERROR_SHIFT))
+#define VALUE_FLAGS_ERROR  (~0u << VALUE_ERROR_SHIFT)
+//字符串节点、对象成员的键的内容和长度，短字符串存放在节点、成员内部
+#define STRING_PTR(v)      (((v)->flags & VALUE_FLAG_SHORT) ? (v)->u.ss : (v)->u.s.s)
+#define STRING_LEN(v)      (((v)->flags & VALUE_FLAG_SHORT) ? SHORT_STRING_MAX - (unsigned char)(v)->u.ss[SHORT_STRING_MAX] : (v)->u.s.len)
+#define KEY_PTR(m)         ((KEY_TAG(m) <= SHORT_KEY_MAX) ? (m)->key.s : (m)->key.p.k)
+#define KEY_LEN(m)         ((KEY_TAG(m) <= SHORT_KEY_MAX) ? SHORT_KEY_MAX - KEY_TAG(m) : (m)->key.p.klen)
+//对象成员的键的标记，短键是SHORT_KEY_MAX减去长度，否则是KEY_TAG_OWNED或KEY_TAG_BORROWED
+#define KEY_TAG(m)         ((unsigned char)(m)->key.s[SHORT_KEY_MAX])
+#define KEY_TAG_OWNED      0xFE  //key.p指向申请的内存，对象在文档中时来自文档
+#define KEY_TAG_BORROWED   0xFF  //key.p指向调用方的缓冲区(原位解析)，不释放
+//节点的内容在文档中，VALUE_FLAG_DOCUMENT随值转移；其他节点上这个标志属于所在的位置
+#define DOCUMENT_MEMORY(v) ((v)->type >= TYPE_STRING && ((v)->flags & VALUE_FLAG_DOCUMENT) && !((v)->flags & (VALUE_FLAG_BORROWED | VALUE_FLAG_SHORT)))
+//节点持有从分配器申请的内存，FreeDocument不会释放它，不能放进文档中的节点
+#define OWNS_MEMORY(v)     ((v)->type >= TYPE_STRING && !((v)->flags & (VALUE_FLAG_DOCUMENT | VALUE_FLAG_BORROWED | VALUE_FLAG_SHORT)))
+//通过分配器申请、扩展、释放内存
+#define MALLOC(a, size)      ((a)->alloc((a)->user, (size)))
+#define REALLOC(a, p, size)  ((a)->realloc((a)->user, (p), (size)))
+#define FREE(a, p)           do { void *_p = (p); if(_p != NULL) (a)->free((a)->user, _p); } while(0)
+//把事件交给处理函数，回调为NULL时忽略，回调返回0时中止解析
+#define HANDLE(c, event)     do { if((c)->handler->event != NULL && !(c)->handler->event((c)->handler->user)) return PARSE_TERMINATED; } while(0)
+#define HANDLE_ARGS(c, event, ...) \
+    do { if((c)->handler->event != NULL && !(c)->handler->event((c)->handler->user, __VA_ARGS__)) return PARSE_TERMINATED; } while(0)
+//和HANDLE相同，但不直接返回：处理函数要求中止时结果为0，用于返回前需要清理的地方
+#define HANDLED(c, event)    ((c)->handler->event == NULL || (c)->handler->event((c)->handler->user))
+#define HANDLED_ARGS(c, event, ...) ((c)->handler->event == NULL || (c)->handler->event((c)->handler->user, __VA_ARGS__))
+
+//结构扫描每次处理64字节，跨块时需要保留的状态
+typedef struct{
+    uint64_t escaped;         //上一块最后的'\\'转义了这一块的第一个字符时为1
+    uint64_t instring;        //上一块结束时在字符串内部时全为1
+}CJSONScanState;
+
+//并行解析时的一段输入，每段有自己的文档，解析出的元素留在c的栈上，最后拼成一个数组
+typedef struct{
+    CJSONDocument doc;        //这一段的节点从它分配，成功后它的块全部转交给调用方的文档
+    CJSONContext c;           //[c.json, c.end)是这一段的输入
+    CJSONHandler dom;         //user指向c的DOM处理函数
+    size_t size;              //解析出的元素个数
+    int ret;                  //这一段的解析结果
+#if !defined(CJSON_NO_THREADS)
+    CJSONThread thread;
+    int started;              //是否在单独的线程中解析
+#endif
+}CJSONParallelSlice;
+
+//NDJSON批量解析中一行的结果
+typedef struct{
+    CJSONValue v;
+    size_t line;              //在这一批中的行序号，从0开始
+    int ret;
+}CJSONLineResult;
+
+typedef struct CJSONLinePool CJSONLinePool;
+
+//NDJSON批量解析的一个工作者，第i个工作者依次解析第i、i+n、i+2n...批，文档和栈在各批之间复用
+typedef struct{
+    CJSONLinePool *pool;
+    size_t index;             //工作者序号，0号由调用线程担任
+    CJSONDocument doc;        //当前这一批的节点，解析下一批前ClearDocument
+    CJSONContext c;
+    CJSONHandler dom;         //user指向c的DOM处理函数
+    CJSONLineResult *results; //当前这一批中各个非空行的结果
+    size_t count;
+    size_t capacity;
+    size_t lines;             //当前这一批的行数，包括空行
+#if !defined(CJSON_NO_THREADS)
+    int ready;                //这一批已经解析完，还没有交付，在pool->lock保护下读写
+    CJSONThread thread;
+    int started;              //是否在单独的线程中解析
+#endif
+}CJSONLineWorker;
+
+//NDJSON批量解析的工作者池，第k批是[json + cuts[k], json + cuts[k + 1])
+struct CJSONLinePool{
+    const char *json;
+    size_t *cuts;
+    size_t batches;
+    CJSONLineWorker *workers;
+    size_t size;              //工作者个数
+#if !defined(CJSON_NO_THREADS)
+    int stop;                 //回调中止时通知工作线程退出
+    CJSONMutex lock;
+    CJSONCond cond;
+#endif
+};
+
+//非递归遍历节点树时的一层：所在的数组或对象，以及当前处理到的元素
+typedef struct{
+    CJSONValue *v;
+    size_t i;
+}CJSONWalkFrame;
+
+//非递归遍历节点树的显式栈，嵌套不超过WALK_INIT_SIZE层时只使用内嵌的数组
+typedef struct{
+    CJSONWalkFrame *frames;
+    size_t depth;
+    size_t capacity;
+    const CJSONAllocator *allocator;  //嵌套更深时从它申请
+    CJSONWalkFrame stack[WALK_INIT_SIZE];
+}CJSONWalk;
+
+//按需解析的结构索引中的一项，见struct CJSONLazy
+typedef struct{
+    size_t close;
+    size_t next;
+}CJSONLazyEntry;
 
 static void ParseWhiteSpace(CJSONContext *c);
-static int ParseLiteral(CJSONContext *c, CJSONValue *v, const char *literal, CJSONType type);
-static int ParseNumber(CJSONContext *c, CJSONValue *v);
-static int ParseStringRaw(CJSONContext *c,  char **str, size_t *len);
-static int ParseString(CJSONContext *c, CJSONValue *v);
-static int ParseArray(CJSONContext *c, CJSONValue *v);
-static int ParseObject(CJSONContext *c, CJSONValue *v);
-static int ParseValue(CJSONContext *c, CJSONValue *v);
+static int ParseLiteral(CJSONContext *c, const char *literal, CJSONType type);
+static int ParseNumber(CJSONContext *c);
+static int ParseNumberRaw(CJSONContext *c, double *n);
+static uint64_t DecimalToBinary(uint64_t w, int q);
+static uint64_t DecimalToBinarySlow(const char *p, const char *end, int e, uint64_t lower);
+static const char *ScanStringRun(const char *p, const char *end, unsigned int *high);
+static int ParseEscape(const char **pp, const char *end, char *buf, size_t *n);
+static int ParseHex4(const char **pp, const char *end, unsigned int *u);
+static size_t EncodeUtf8(char *buf, unsigned int u);
+static int ValidateUtf8(const char *s, size_t len);
+static int EscapeComplete(const char *escape, size_t n);
+static int ParseStringRaw(CJSONContext *c, const char **str, size_t *len);
+static int ParseStringInsitu(CJSONContext *c, const char **str, size_t *len);
+static int ParseString(CJSONContext *c);
+static int ParseMemberKey(CJSONContext *c);
+static int ParseValue(CJSONContext *c, size_t depth);
+static int ParseScalar(CJSONContext *c);
+static int ParseText(CJSONContext *c);
 static int StringifyValue(CJSONContext *c, const CJSONValue *v);
+static int StringifiedValueLength(const CJSONValue *v, size_t *length);
+static void StringifyString(CJSONContext *c, const char *s, size_t len);
+static size_t StringifiedStringLength(const char *s, size_t len);
+static void StringifyExact(const CJSONValue *v, char *buf, size_t len);
+static int FormatNumber(char *buffer, double d);
+static void WalkInit(CJSONWalk *w, const CJSONAllocator *allocator);
+static void WalkPush(CJSONWalk *w, const CJSONValue *v);
+static void WalkFree(CJSONWalk *w);
+static void *CopyAlloc(char **block, size_t size);
+static size_t CopySize(const CJSONValue *src);
+static void StringInit(CJSONValue *v, char **block, const char *s, size_t len);
+static void KeyInit(CJSONMember *m, char **block, const char *key, size_t klen);
+static void CopyTree(CJSONValue *dst, const CJSONValue *src, CJSONDocument *doc, char *block);
 static void *ContextPush(CJSONContext *c, size_t size);
 static void *ContextPop(CJSONContext *c, size_t size);
+static void OutputFlush(CJSONContext *c);
+static void *OutputPush(CJSONContext *c, size_t size);
+static void OutputWrite(CJSONContext *c, const char *s, size_t len);
+static int FileWrite(void *user, const char *buf, size_t len);
+static int FdWrite(void *user, const char *buf, size_t len);
+static void *ContextAlloc(CJSONContext *c, size_t size);
+static char *ContextStrdup(CJSONContext *c, const char *s, size_t len);
+static void *DocumentAlloc(CJSONDocument *doc, size_t size);
+static int ParseRoot(CJSONContext *c, CJSONValue *v);
+static int LazyScan(CJSONContext *c, CJSONLazyEntry **entries, size_t *count);
+static uint64_t ScanBlock(const char *p, CJSONScanState *st, uint64_t *comma);
+static uint64_t StructuralMasks(const char *p, uint64_t *quote, uint64_t *slash, uint64_t *comma);
+static int ParseDeferred(CJSONContext *c);
+static int LazyMaterialize(CJSONValue *v);
+static size_t ParallelSplit(const char *json, const char *end, const char **cuts, size_t parts);
+static int ParseSlice(CJSONParallelSlice *s);
+static const char *ScanNewline(const char *p, const char *end);
+static void LinesParseBatch(CJSONLineWorker *w, size_t batch);
+#if !defined(CJSON_NO_THREADS)
+THREAD_FUNC(ParallelWorker);
+THREAD_FUNC(LinesWorker);
+static int ThreadCreate(CJSONThread *thread, CJSONThreadFunc func, void *arg);
+static void ThreadJoin(CJSONThread thread);
+#endif
+static size_t HashKey(const char *key, size_t klen);
+static size_t ContainerGrow(size_t capacity);
+static size_t ObjectIndexBytes(size_t size);
+static void ObjectIndexFill(CJSONObjectIndex *index, size_t bytes, const CJSONMember *m, size_t size);
+static size_t ObjectIndexFind(const CJSONObjectIndex *index, const CJSONMember *m, const char *key, size_t klen);
+
+static int DomNull(void *user);
+static int DomBoolean(void *user, int b);
+static int DomNumber(void *user, double n);
+static int DomString(void *user, const char *s, size_t len);
+static int DomKey(void *user, const char *k, size_t klen);
+static int DomPushString(CJSONContext *c, const char *s, size_t len, size_t max);
+static int DomEndObject(void *user, size_t size);
+static int DomEndArray(void *user, size_t size);
+
+static void TapePush(CJSONTape *tape, unsigned long long w);
+static int TapeNull(void *user);
+static int TapeBoolean(void *user, int b);
+static int TapeNumber(void *user, double n);
+static int TapeString(void *user, const char *s, size_t len);
+static int TapeStart(CJSONTape *tape, char tag);
+static int TapeEnd(CJSONTape *tape, char tag, size_t size);
+static int TapeStartObject(void *user);
+static int TapeEndObject(void *user, size_t size);
+static int TapeStartArray(void *user);
+static int TapeEndArray(void *user, size_t size);
+
+static int ParserConsume(CJSONParser *p, const char *s, const char *end);
+static void ParserEndValue(CJSONParser *p);
+static int ParserEndNumber(CJSONParser *p);
+static int ParserEndString(CJSONParser *p);
+static int ParserAfterValueError(const CJSONParser *p);
+static void ParserClear(CJSONParser *p);
+
+static void *DefaultAlloc(void *user, size_t size);
+static void *DefaultRealloc(void *user, void *p, size_t size);
+static void DefaultFree(void *user, void *p);
+
+//默认分配器直接使用malloc/realloc/free，可以通过SetAllocator替换
+static const CJSONAllocator mallocAllocator = { DefaultAlloc, DefaultRealloc, DefaultFree, NULL };
+static CJSONAllocator defaultAllocator = { DefaultAlloc, DefaultRealloc, DefaultFree, NULL };
+
+//生成字符串时需要转义的字符在'\\'之后的字符，'u'表示输出为\u00XX
+static const char escapeTable['\\' + 1] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    ['\"'] = '\"', ['\\'] = '\\'
+};
+
+//建立节点树的处理函数，startObject、startArray不需要处理，user在解析时设置为CJSONContext
+static const CJSONHandler domHandler = {
+    DomNull, DomBoolean, DomNumber, DomString, NULL, DomKey, DomEndObject, NULL, DomEndArray, NULL
+};
+
+//生成磁带的处理函数，user为CJSONTape，键和字符串的存放方式相同
+static const CJSONHandler tapeHandler = {
+    TapeNull, TapeBoolean, TapeNumber, TapeString, TapeStartObject, TapeString, TapeEndObject, TapeStartArray, TapeEndArray, NULL
+};
+
+/*
+对象的哈希索引：开放定址、线性探测
+slots中存放成员下标+1，0表示空槽，槽数是2的幂且不少于成员数的2倍
+*/
+struct CJSONObjectIndex{
+    CJSONAllocator allocator; //建立索引时使用的分配器，释放时交还给它
+    size_t mask;              //槽数-1
+    size_t slots[];
+};
+
+/*
+按需解析的结构索引：输入中所有的数组、对象按'['、'{'出现的顺序编号
+    * close, 对应的']'、'}'在输入中的偏移
+    * next, 整个子树之后的下一个数组或对象的序号，展开时跳过一个子树是O(1)的
+*/
+struct CJSONLazy{
+    const char *json;         //输入，使用期间需要保持有效
+    CJSONDocument *doc;       //展开时节点从文档中分配
+    CJSONLazyEntry entries[];
+};
+
+/*
+增量解析器的状态，每个状态都可以在任意字节处被输入块的边界打断
+*/
+typedef enum{
+    PARSER_VALUE,             //等待一个值
+    PARSER_ARRAY_FIRST,       //'['之后，等待第一个元素或']'
+    PARSER_OBJECT_FIRST,      //'{'之后，等待第一个键或'}'
+    PARSER_KEY,               //','之后，等待键
+    PARSER_COLON,             //键之后，等待':'
+    PARSER_AFTER_VALUE,       //一个值之后，等待','、']'、'}'或文本结束
+    PARSER_LITERAL,           //null、true、false的中间
+    PARSER_NUMBER,            //数值的中间
+    PARSER_STRING,            //字符串或键的中间
+    PARSER_ESCAPE             //字符串中'\\'之后
+}CJSONParserState;
+
+//嵌套层次：所在的数组或对象，以及已经解析出的元素或成员个数
+typedef struct{
+    char type;                //'['或'{'
+    size_t size;
+}CJSONParserLevel;
+
+struct CJSONParser{
+    CJSONContext c;           //栈中存放DOM节点和未完成的字符串、数值
+    CJSONAllocator allocator; //创建时的默认分配器
+    CJSONHandler dom;         //没有设置处理函数时使用的DOM处理函数
+    CJSONParserState state;
+    int ret;                  //出错后一直返回该错误码
+    const char *literal;      //PARSER_LITERAL: 正在匹配的literal
+    size_t index;             //PARSER_LITERAL: 下一个要匹配的字符
+    int key;                  //PARSER_STRING: 正在解析的是对象的键
+    size_t head;              //PARSER_NUMBER、PARSER_STRING: 字符串或数值在栈上的起点
+    char escape[12];          //PARSER_ESCAPE: '\\'之后已经收到的字符，最长是代理对"uXXXX\\uXXXX"
+    size_t nescape;
+    CJSONParserLevel *levels; //嵌套层次栈
+    size_t depth;
+    size_t capacity;
+};
+
+struct CJSONChunk{
+    CJSONChunk *next;         //下一个块
+    size_t size;              //块中可用的字节数，块头之后紧跟着数据
+};
 
 /*******************************************************************************
 * Function   : Parse
@@ -55,799 +555,5374 @@ static void *ContextPop(CJSONContext *c, size_t size);
 *******************************************************************************/
 int Parse(CJSONValue *v, const char *json)
 {
-    CJSONContext c;
-    int ret;
-    assert(NULL != v);
-    c.json = json;
-    c.stack = NULL;
-    c.size = c.top = 0;
-    INIT_VALUE_NULL(v);
-    ParseWhiteSpace(&c);
-    if((ret = ParseValue(&c, v)) == PARSE_OK){
-        //Json文本应该有3部分：`ws value ws`
-        //需要对三个部分都进行解析，解析空白，然后检查Json文本是否完结
-        ParseWhiteSpace(&c);
-        if(*c.json != '\0')
-            ret = PARSE_ROOT_NOT_SINGULAR;
-    }
-    //加断言，保证所有数据都被弹出
-    assert(c.top == 0);
-    free(c.stack);
-    return ret;
+    return ParseWithAllocator(v, json, &defaultAllocator);
 }
 
 /*******************************************************************************
-* Function   : Stringify
-* Description: 
-    * 将在内存中的树形结构生成对应的JSON字符串
-    * 该API提供length可选参数，当传入非空指针时，就能获得生成JSON的长度
-    * 为什么需要获得长度，不是可以用strlen()获取吗？
-    * 多了一个strlen()调用会带来不必要的性能消耗，理想地避免调用方有额外消耗
+* Function   : ParseWithAllocator
+* Description: 使用指定的分配器解析JSON
+    * 解析用的栈和解析出的节点都从allocator申请
+    * 解析出的树需要用同一个分配器调用FreeValueWithAllocator释放
 * Input      :
-    * v, 树形结构的根节点
-    * length, 可选，存储 JSON 的长度，传入 NULL 可忽略此参数
-* Output     : 
-    * json, json格式的字符串
-* Return     : 
-    * 
+    * v, 一个Json节点; json, 一个待解析的Json格式字符串; allocator, 分配器
+* Output     :
+* Return     : 同Parse
 * Others     : 
+    * 节点不记录分配器，SetString、PushBackArrayElement、CopyValue等总是使用默认分配器，
+    * allocator不是默认分配器时，解析出的树不能再修改
 *******************************************************************************/
-int Stringify(const CJSONValue *v, char **json, size_t *length)
+int ParseWithAllocator(CJSONValue *v, const char *json, const CJSONAllocator *allocator)
 {
     CJSONContext c;
-    int ret;
-    assert(NULL != v);
-    assert(NULL != json);
-    //初始化一个STRINGIFY_STACK_INIT_SIZE大小的堆
-    c.stack = (char *)malloc(c.size = STRINGIFY_STACK_INIT_SIZE);
-    c.top = 0;
-    //以v为根节点解析，将解析结果放到c中
-    if((ret = StringifyValue(&c, v)) != STRINGIFY_OK){
-        free(c.stack);
-        *json = NULL;
-        return ret;
-    }
-    //获取解析结果长度
-    if(length)
-        *length = c.top;
-    //将栈顶设置为'\0'，表示字符串结尾
-    PUTC(&c, '\0');
-    *json = c.stack;
-    return STRINGIFY_OK;
+    assert(NULL != v && NULL != json && NULL != allocator);
+    c.json = json;
+    c.end = json + strlen(json);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = allocator;
+    c.doc = NULL;
+    c.vflags = 0;
+    c.pflags = 0;
+    return ParseRoot(&c, v);
 }
 
 /*******************************************************************************
-* Function   : GetType
-* Description: 获取Json的某个节点值的类型
+* Function   : ParseN
+* Description: 解析长度为len的JSON文本，不要求以'\0'结尾
+    * mmap的文件、网络缓冲区可以直接解析，不需要为了补'\0'而复制一份
 * Input      :
-    * v, 一个Json节点
+    * v, 一个Json节点; json, 待解析的Json文本; len, 文本的字节数
 * Output     :
-* Return     : JSON节点的类型
+* Return     : 同Parse
 * Others     : 
+    * 和Parse不同，文本中间的'\0'不表示结束，而是按照非法字符处理
 *******************************************************************************/
-CJSONType GetType(const CJSONValue *v)
+int ParseN(CJSONValue *v, const char *json, size_t len)
 {
-    assert(NULL != v);
-    return v->type;
+    CJSONContext c;
+    assert(NULL != v && (NULL != json || len == 0));
+    c.json = json;
+    c.end = json + len;
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = &defaultAllocator;
+    c.doc = NULL;
+    c.vflags = 0;
+    c.pflags = 0;
+    return ParseRoot(&c, v);
 }
 
 /*******************************************************************************
-* Function   : GetBoolean
-* Description: 将JSON节点作为布尔类型获得其值
+* Function   : ParseInsitu
+* Description: 原位解析JSON
+    * 字符串直接在json缓冲区中解码并补'\0'，节点的字符串和对象的键都指向缓冲区
+    * 省去了字符串先压栈、再复制到新申请内存的两次拷贝
 * Input      :
-    * v, 一个Json节点
+    * v, 一个Json节点; json, 一个待解析的、可修改的Json格式字符串
 * Output     :
-* Return     : TYPE_FALSE; TYPE_TRUE
+    * json, 解析后内容被改写，不能再次解析
+* Return     : 同Parse
 * Others     : 
+    * json缓冲区的生命周期必须长于v，v仍需FreeValue释放数组、对象等其他内存
 *******************************************************************************/
-int GetBoolean(const CJSONValue *v)
+int ParseInsitu(CJSONValue *v, char *json)
 {
-    assert(NULL != v && (v->type == TYPE_TRUE || v->type == TYPE_FALSE));
-    return v->type;
+    CJSONContext c;
+    assert(NULL != v && NULL != json);
+    c.json = json;
+    c.end = json + strlen(json);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = &defaultAllocator;
+    c.doc = NULL;
+    c.vflags = 0;
+    c.pflags = PARSE_FLAG_INSITU;
+    return ParseRoot(&c, v);
 }
 
 /*******************************************************************************
-* Function   : SetBoolean
-* Description: 将JSON节点作为布尔类型设置其值
+* Function   : SetAllocator
+* Description: 设置默认分配器，Parse、Stringify、SetString、FreeValue等都使用默认分配器
 * Input      :
-    * v, 一个Json节点
-    * b, 要设置的值
-* Output     : 
+    * allocator, 新的默认分配器，传入NULL恢复为malloc/realloc/free
+* Output     :
 * Return     : 
 * Others     : 
+    * 默认分配器是全局的，应在使用cJson之前设置
+    * 修改节点树的函数(SetString、PushBackArrayElement、SetObjectValue、CopyValue等)只使用默认分配器
+    * 替换前用旧分配器申请的节点必须用FreeValueWithAllocator交还给旧分配器
 *******************************************************************************/
-void SetBoolean(CJSONValue *v, int b)
+void SetAllocator(const CJSONAllocator *allocator)
 {
-    FreeValue(v);
-    v->type = b;
+    defaultAllocator = (allocator != NULL) ? *allocator : mallocAllocator;
 }
 
 /*******************************************************************************
-* Function   : GetNumber
-* Description: 获取Json的某个数值型节点值的数值
+* Function   : GetAllocator
+* Description: 获取当前的默认分配器
 * Input      :
-    * v, 一个Json节点
 * Output     :
-* Return     : JSON节点的数值
+* Return     : 默认分配器
 * Others     : 
 *******************************************************************************/
-double GetNumber(const CJSONValue *v)
+const CJSONAllocator *GetAllocator(void)
 {
-    assert(v != NULL && v->type == TYPE_NUMBER);
-    return v->u.n;
+    return &defaultAllocator;
 }
 
 /*******************************************************************************
-* Function   : SetNumber
-* Description: 设置JSON节点为数值类型
+* Function   : ParseInDocument
+* Description: 在文档中解析JSON
+    * 所有的节点、键、字符串都从文档的块中分配，解析过程中几乎不调用malloc
+    * 解析出的节点带有VALUE_FLAG_DOCUMENT标志，对其FreeValue只会重置为null，
+    * 可以用SetNumber等改写，但不能用SetString、SetArray、SetObject等放入从分配器申请的内存
+    * 整棵树的内存在ClearDocument/FreeDocument时一次性释放
 * Input      :
-    * v, 一个Json节点
-    * n, 要设置的数值
+    * doc, 已经InitDocument的文档; v, 一个Json节点; json, 一个待解析的Json格式字符串
 * Output     :
-* Return     : 
+* Return     : 同Parse
 * Others     : 
 *******************************************************************************/
-void SetNumber(CJSONValue *v, double n)
+int ParseInDocument(CJSONDocument *doc, CJSONValue *v, const char *json)
 {
-    FreeValue(v);
-    v->u.n = n;
-    v->type = TYPE_NUMBER;
+    CJSONContext c;
+    assert(NULL != doc && NULL != v && NULL != json);
+    c.json = json;
+    c.end = json + strlen(json);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = &doc->allocator;
+    c.doc = doc;
+    c.vflags = VALUE_FLAG_DOCUMENT;
+    c.pflags = 0;
+    return ParseRoot(&c, v);
 }
 
 /*******************************************************************************
-* Function   : GetString
-* Description: 获得JSON节点的字符串值
+* Function   : ParseLazyInDocument
+* Description: 在文档中按需解析JSON
+    * 先对整个输入做一遍结构扫描，只匹配引号和括号，记录每个数组、对象的结束位置
+    * 数组、对象第一次被访问时(GetArraySize、GetObjectValue、FindObjectValue等)才解析这一层
+    * 这一层中的字符串、数值等直接解析，嵌套的数组、对象仍然只记录位置，跳过它们是O(1)的
+    * 只读取大文档中少量字段时，没有访问的子树只做过一次结构扫描
 * Input      :
-    * v, 一个Json节点
-* Output     : 
-* Return     : 字符串指针
-* Others     : 
-*******************************************************************************/
-const char *GetString(const CJSONValue *v)
-{
-    assert(v != NULL && v->type == TYPE_STRING);
-    return v->u.s.s;
-}
-
-/*******************************************************************************
-* Function   : GetStringLength
-* Description: 获取JSON字符串节点的字符串长度
-* Input      : 
-    * v, 一个Json节点
-* Output     : 
-* Return     : 字符串长度
+    * doc, 已经InitDocument的文档; v, 一个Json节点; json, 一个待解析的Json格式字符串
+* Output     :
+* Return     : 
+    * 同Parse，根这一层完整检查，嵌套的数组、对象只检查引号、括号是否匹配
+    * 括号不匹配时的错误码可能和Parse不同
 * Others     : 
+    * json在文档使用期间必须保持有效且不被修改，展开时会再次读取
+    * 没有展开的子树中的语法错误要到展开时才能发现，用MaterializeValue可以得到错误码
+    * 展开失败的数组、对象记下错误码：生成JSON返回STRINGIFY_INVALID_LAZY_VALUE，
+    * 访问函数返回0、NULL或KEY_NOT_EXIST，和空的数组、对象无法区分，
+    * 输入不可信时先用MaterializeValue检查整棵树或者要读取的子树
+    * 展开会修改节点，包括只读的访问函数，多线程共享同一棵树时需先用MaterializeValue展开
 *******************************************************************************/
-size_t GetStringLength(const CJSONValue *v)
+int ParseLazyInDocument(CJSONDocument *doc, CJSONValue *v, const char *json)
 {
-    assert(v != NULL && v->type == TYPE_STRING);
-    return v->u.s.len;
+    CJSONContext c;
+    CJSONLazyEntry *entries = NULL;
+    size_t count = 0;
+    int ret;
+    assert(NULL != doc && NULL != v && NULL != json);
+    c.json = json;
+    c.end = json + strlen(json);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = &doc->allocator;
+    c.doc = doc;
+    c.vflags = VALUE_FLAG_DOCUMENT;
+    c.pflags = PARSE_FLAG_LAZY;
+    if((ret = LazyScan(&c, &entries, &count)) != PARSE_OK){
+        FREE(c.allocator, entries);
+        FREE(c.allocator, c.stack);
+        INIT_VALUE_NULL(v);
+        return ret;
+    }
+    //结构索引和节点一起放在文档中，随文档释放
+    c.lazy = (CJSONLazy *)DocumentAlloc(doc, sizeof(CJSONLazy) + count * sizeof(CJSONLazyEntry));
+    c.lazy->json = json;
+    c.lazy->doc = doc;
+    if(count > 0)
+        memcpy(c.lazy->entries, entries, count * sizeof(CJSONLazyEntry));
+    FREE(c.allocator, entries);
+    //根这一层直接解析，语法错误在这里就能发现；根是数组、对象时它是第0个，嵌套的从第1个开始
+    c.pflags = PARSE_FLAG_LAZY | PARSE_FLAG_EXPAND;
+    ParseWhiteSpace(&c);
+    c.ordinal = (PEEK(c.json, c.end) == '[' || PEEK(c.json, c.end) == '{') ? 1 : 0;
+    return ParseRoot(&c, v);
 }
 
 /*******************************************************************************
-* Function   : SetString
-* Description: 设置string类型节点的值
+* Function   : MaterializeValue
+* Description: 展开v之下所有还没有展开的数组、对象
 * Input      :
-    * s, 字符串值
-    * len, 字符串长度
+    * v, Json节点
 * Output     :
-    * v, Json的string节点
 * Return     : 
+    * PARSE_OK, 整个子树都是合法的JSON
+    * 其他同Parse，遇到的第一个错误
 * Others     : 
+    * 不是按需解析得到的节点直接返回PARSE_OK
+    * 展开失败的数组、对象变成空的数组、对象并记下错误码，之后再调用返回同样的错误码
 *******************************************************************************/
-void SetString(CJSONValue *v, const char *s, size_t len)
+int MaterializeValue(CJSONValue *v)
 {
-    assert(v != NULL && (s != NULL || len == 0));
-    FreeValue(v);
-    v->u.s.s = (char *)malloc(len + 1);
-    memcpy(v->u.s.s, s, len);
-    v->u.s.s[len] = '\0';
-    v->u.s.len = len;
-    v->type = TYPE_STRING;
+    CJSONWalk w;
+    CJSONWalkFrame *f;
+    int ret;
+    assert(NULL != v);
+    WalkInit(&w, &defaultAllocator);
+    for(;;){
+        MATERIALIZE(v);
+        if((ret = VALUE_ERROR(v)) != PARSE_OK)
+            break;
+        if(v->type == TYPE_ARRAY && v->u.a.size > 0){
+            WalkPush(&w, v);
+            v = &v->u.a.e[0];
+            continue;
+        }
+        if(v->type == TYPE_OBJECT && v->u.o.size > 0){
+            WalkPush(&w, v);
+            v = &v->u.o.m[0].v;
+            continue;
+        }
+        //回到所在的数组、对象，找到下一个元素
+        for(v = NULL; v == NULL && w.depth > 0; ){
+            f = &w.frames[w.depth - 1];
+            f->i++;
+            if(f->v->type == TYPE_ARRAY && f->i < f->v->u.a.size)
+                v = &f->v->u.a.e[f->i];
+            else if(f->v->type == TYPE_OBJECT && f->i < f->v->u.o.size)
+                v = &f->v->u.o.m[f->i].v;
+            else
+                w.depth--;
+        }
+        if(v == NULL){
+            ret = PARSE_OK;
+            break;
+        }
+    }
+    WalkFree(&w);
+    return ret;
 }
 
 /*******************************************************************************
-* Function   : GetArraySize
-* Description: 获取当前层数组元素个数
+* Function   : ParseParallelInDocument
+* Description: 多线程解析根节点是很大的数组的JSON
+    * 先做一遍结构扫描，在第一层元素之间的','处把数组切成threads段，各段大小接近
+    * 每段由一个线程解析到自己的文档中，当前线程解析第一段
+    * 全部完成后把各段的元素拼成一个数组，各段文档的内存块转交给doc
 * Input      :
-    * v, 当前层数组的起始指针
+    * doc, 已经InitDocument的文档; v, 一个Json节点; json, 一个待解析的Json格式字符串
+    * threads, 最多使用的线程数(包括当前线程)
 * Output     :
-* Return     : 
+* Return     : 同ParseInDocument
 * Others     : 
+    * 根节点不是数组、输入太小或threads不大于1时等同于ParseInDocument
+    * 任何一段出错时丢弃所有结果，再顺序解析一次，得到和ParseInDocument相同的错误码
+    * 各个线程同时使用doc的分配器，分配器必须是线程安全的，默认的malloc/free是
 *******************************************************************************/
-size_t GetArraySize(const CJSONValue *v)
+int ParseParallelInDocument(CJSONDocument *doc, CJSONValue *v, const char *json, size_t threads)
 {
-    assert(NULL != v && v->type == TYPE_ARRAY);
-    return v->u.a.size;
+    const char *p = json, *end, **cuts;
+    CJSONParallelSlice *slices, *s;
+    CJSONChunk *tail;
+    CJSONValue *e;
+    size_t n, i, total = 0;
+    int ret = PARSE_OK;
+    assert(NULL != doc && NULL != v && NULL != json);
+    end = json + strlen(json);
+    while(p < end && ISWHITESPACE(*p))
+        p++;
+#if defined(CJSON_NO_THREADS)
+    threads = 1;
+#endif
+    if(threads > (size_t)(end - p) / PARSE_PARALLEL_MIN_SIZE)
+        threads = (size_t)(end - p) / PARSE_PARALLEL_MIN_SIZE;
+    if(threads <= 1 || *p != '[')
+        return ParseInDocument(doc, v, json);
+    cuts = (const char **)MALLOC(&doc->allocator, threads * sizeof(const char *));
+    if((n = ParallelSplit(p, end, cuts, threads)) <= 1){
+        FREE(&doc->allocator, cuts);
+        return ParseInDocument(doc, v, json);
+    }
+    slices = (CJSONParallelSlice *)MALLOC(&doc->allocator, n * sizeof(CJSONParallelSlice));
+    for(i = 0; i < n; i++){
+        s = &slices[i];
+        InitDocumentWithAllocator(&s->doc, &doc->allocator);
+        s->dom = domHandler;
+        s->dom.user = &s->c;
+        s->c.json = (i == 0) ? p + 1 : cuts[i - 1] + 1;
+        s->c.end = cuts[i];
+        s->c.stack = NULL;
+        s->c.size = s->c.top = 0;
+        s->c.allocator = &s->doc.allocator;
+        s->c.doc = &s->doc;
+        s->c.vflags = VALUE_FLAG_DOCUMENT;
+        s->c.pflags = 0;
+        s->c.handler = &s->dom;
+        s->size = 0;
+    }
+#if !defined(CJSON_NO_THREADS)
+    for(i = 1; i < n; i++)
+        slices[i].started = ThreadCreate(&slices[i].thread, ParallelWorker, &slices[i]);
+#endif
+    slices[0].ret = ParseSlice(&slices[0]);
+    for(i = 1; i < n; i++){
+#if !defined(CJSON_NO_THREADS)
+        if(slices[i].started){
+            ThreadJoin(slices[i].thread);
+            continue;
+        }
+#endif
+        //创建线程失败时由当前线程解析这一段
+        slices[i].ret = ParseSlice(&slices[i]);
+    }
+    //数组之后只能有空白
+    for(p = cuts[n - 1] + 1; p < end && ISWHITESPACE(*p); p++)
+        ;
+    if(p != end)
+        ret = PARSE_ROOT_NOT_SINGULAR;
+    for(i = 0; i < n; i++){
+        total += slices[i].size;
+        if(slices[i].ret != PARSE_OK)
+            ret = slices[i].ret;
+    }
+    if(ret == PARSE_OK){
+        //先在doc中申请元素数组，保证doc至少有一个块，各段的块挂在它之后
+        e = (CJSONValue *)DocumentAlloc(doc, total * sizeof(CJSONValue));
+        v->type = TYPE_ARRAY;
+        v->flags = VALUE_FLAG_DOCUMENT;
+        v->u.a.e = e;
+        v->u.a.size = v->u.a.capacity = total;
+        for(i = 0; i < n; i++){
+            s = &slices[i];
+            memcpy(e, s->c.stack, s->size * sizeof(CJSONValue));
+            e += s->size;
+            if(s->doc.chunks != NULL){
+                for(tail = s->doc.chunks; tail->next != NULL; tail = tail->next)
+                    ;
+                tail->next = doc->chunks->next;
+                doc->chunks->next = s->doc.chunks;
+            }
+        }
+    }
+    for(i = 0; i < n; i++){
+        FREE(&doc->allocator, slices[i].c.stack);
+        if(ret != PARSE_OK)
+            FreeDocument(&slices[i].doc);
+    }
+    FREE(&doc->allocator, slices);
+    FREE(&doc->allocator, cuts);
+    //出错的情况很少，顺序解析一次得到和ParseInDocument一致的错误码和结果
+    if(ret != PARSE_OK)
+        return ParseInDocument(doc, v, json);
+    return PARSE_OK;
 }
 
 /*******************************************************************************
-* Function   : GetArrayElement
-* Description: 获取当前层数组的第index个元素
+* Function   : ParseLines
+* Description: 批量解析NDJSON(每行一个JSON文本)，按行的顺序把结果交给回调
+    * 输入按约PARSE_LINES_BATCH_SIZE字节切成若干批，切分点在'\n'之后
+    * threads个工作者轮流解析各批，调用线程是0号工作者，同时负责按顺序交付结果
+    * 每个工作者的文档和解析栈在各批之间复用，最多比交付进度领先一批
 * Input      :
-    * v, 当前层数组的起始指针
-    * index, 元素的顺序
+    * json, NDJSON文本，不要求以'\0'结尾，可以是mmap的文件; len, 文本的字节数
+    * threads, 最多使用的线程数(包括当前线程)
+    * callback, 每个非空行调用一次; user, 原样传给callback
 * Output     :
-    * v, Json的string节点
 * Return     : 
+    * PARSE_OK, 所有行都交给了回调，某一行的解析错误通过回调的ret参数报告
+    * PARSE_TERMINATED, 回调返回0中止了解析
 * Others     : 
+    * 行尾的'\r'作为空白忽略，最后一行可以没有'\n'
+    * 各个线程同时使用默认分配器，threads大于1时分配器必须是线程安全的
+    * 定义CJSON_NO_THREADS或创建线程失败时，对应的批由调用线程解析
 *******************************************************************************/
-CJSONValue *GetArrayElement(const CJSONValue *v, size_t index)
+int ParseLines(const char *json, size_t len, size_t threads, CJSONLineFunc callback, void *user)
 {
-    assert(NULL != v && v->type == TYPE_ARRAY);
-    assert(index < v->u.a.size);
-    return &v->u.a.e[index];
+    CJSONLinePool pool;
+    CJSONLineWorker *w;
+    CJSONLineResult *r;
+    const char *p, *q, *end = json + len;
+    size_t batch, i, base = 0;
+    int ret = PARSE_OK;
+    assert((NULL != json || len == 0) && NULL != callback);
+    //每批至少PARSE_LINES_BATCH_SIZE字节(最后一批除外)，批数不会超过len / PARSE_LINES_BATCH_SIZE + 1
+    pool.json = json;
+    pool.cuts = (size_t *)MALLOC(&defaultAllocator, (len / PARSE_LINES_BATCH_SIZE + 2) * sizeof(size_t));
+    pool.cuts[0] = 0;
+    for(pool.batches = 0, p = json; p < end; p = q){
+        q = end;
+        if((size_t)(end - p) > PARSE_LINES_BATCH_SIZE && (q = ScanNewline(p + PARSE_LINES_BATCH_SIZE - 1, end)) < end)
+            q++;
+        pool.cuts[++pool.batches] = (size_t)(q - json);
+    }
+#if defined(CJSON_NO_THREADS)
+    threads = 1;
+#endif
+    if(threads > pool.batches)
+        threads = pool.batches;
+    if(threads == 0)
+        threads = 1;
+    pool.size = threads;
+    pool.workers = (CJSONLineWorker *)MALLOC(&defaultAllocator, threads * sizeof(CJSONLineWorker));
+    for(i = 0; i < threads; i++){
+        w = &pool.workers[i];
+        w->pool = &pool;
+        w->index = i;
+        InitDocument(&w->doc);
+        w->dom = domHandler;
+        w->dom.user = &w->c;
+        w->c.stack = NULL;
+        w->c.size = w->c.top = 0;
+        w->c.allocator = &w->doc.allocator;
+        w->c.doc = &w->doc;
+        w->c.vflags = VALUE_FLAG_DOCUMENT;
+        w->c.pflags = 0;
+        w->c.handler = &w->dom;
+        w->results = NULL;
+        w->count = w->capacity = w->lines = 0;
+    }
+#if !defined(CJSON_NO_THREADS)
+    pool.stop = 0;
+    MUTEX_INIT(&pool.lock);
+    COND_INIT(&pool.cond);
+    pool.workers[0].started = 0;
+    for(i = 1; i < threads; i++){
+        pool.workers[i].ready = 0;
+        pool.workers[i].started = ThreadCreate(&pool.workers[i].thread, LinesWorker, &pool.workers[i]);
+    }
+#endif
+    for(batch = 0; batch < pool.batches && ret == PARSE_OK; batch++){
+        w = &pool.workers[batch % threads];
+#if !defined(CJSON_NO_THREADS)
+        if(w->started){
+            MUTEX_LOCK(&pool.lock);
+            while(!w->ready)
+                COND_WAIT(&pool.cond, &pool.lock);
+            MUTEX_UNLOCK(&pool.lock);
+        }
+        else
+#endif
+            LinesParseBatch(w, batch);
+        for(i = 0, r = w->results; i < w->count; i++, r++){
+            if(!callback(user, base + r->line + 1, r->ret, &r->v)){
+                ret = PARSE_TERMINATED;
+                break;
+            }
+        }
+        base += w->lines;
+#if !defined(CJSON_NO_THREADS)
+        //交付完成，这个工作者可以开始解析它的下一批
+        if(w->started){
+            MUTEX_LOCK(&pool.lock);
+            w->ready = 0;
+            COND_BROADCAST(&pool.cond);
+            MUTEX_UNLOCK(&pool.lock);
+        }
+#endif
+    }
+#if !defined(CJSON_NO_THREADS)
+    MUTEX_LOCK(&pool.lock);
+    pool.stop = 1;
+    COND_BROADCAST(&pool.cond);
+    MUTEX_UNLOCK(&pool.lock);
+    for(i = 1; i < threads; i++)
+        if(pool.workers[i].started)
+            ThreadJoin(pool.workers[i].thread);
+    COND_DESTROY(&pool.cond);
+    MUTEX_DESTROY(&pool.lock);
+#endif
+    for(i = 0; i < threads; i++){
+        w = &pool.workers[i];
+        FREE(&w->doc.allocator, w->results);
+        FREE(&w->doc.allocator, w->c.stack);
+        FreeDocument(&w->doc);
+    }
+    FREE(&defaultAllocator, pool.workers);
+    FREE(&defaultAllocator, pool.cuts);
+    return ret;
 }
 
 /*******************************************************************************
-* Function   : GetObjectSize
-* Description: 获取当前JSON对象的元素个数
+* Function   : ParseWithHandler
+* Description: SAX方式解析JSON，不建立节点树，每个语法单元都以事件的形式交给handler
+    * 内存占用只和字符串长度有关，和文档大小无关，嵌套深度决定递归深度
+    * 适合只需要从很大的文档中取出少量字段的场景
 * Input      :
-    * v, 当前层对象
+    * json, 一个待解析的Json格式字符串; handler, 事件处理函数
 * Output     :
-* Return     : JSON对象元素个数
+* Return     : 
+    * 同Parse
+    * PARSE_TERMINATED, 处理函数返回0中止了解析
 * Others     : 
+    * 出错前已经产生的事件不会撤销，handler需要自己处理不完整的事件序列
 *******************************************************************************/
-size_t GetObjectSize(const CJSONValue *v)
+int ParseWithHandler(const char *json, const CJSONHandler *handler)
 {
-    assert(v != NULL && v->type == TYPE_OBJECT);
-    return v->u.o.size;
+    CJSONContext c;
+    int ret;
+    assert(NULL != json && NULL != handler);
+    c.json = json;
+    c.end = json + strlen(json);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = &defaultAllocator;
+    c.doc = NULL;
+    c.vflags = 0;
+    c.pflags = 0;
+    c.handler = handler;
+    ret = ParseText(&c);
+    assert(c.top == 0);
+    FREE(c.allocator, c.stack);
+    return ret;
 }
 
 /*******************************************************************************
-* Function   : GetObjectKey
-* Description: 获取对象的第index个元素的键
+* Function   : ParserCreate
+* Description: 创建一个增量解析器，输入可以分成任意大小的块陆续交给ParserFeed
 * Input      :
-    * v, 当前层数组的起始指针
-    * index, 元素的顺序
-* Output     : 
-* Return     : 键指针
+* Output     :
+* Return     : 解析器，用ParserDestroy销毁
 * Others     : 
+    * 默认建立节点树，由ParserFinish输出；ParserSetHandler可改为产生SAX事件
+    * 使用创建时的默认分配器
 *******************************************************************************/
-const char *GetObjectKey(const CJSONValue *v, size_t index)
+CJSONParser *ParserCreate(void)
 {
-    assert(v != NULL && v->type == TYPE_OBJECT);
-    assert(index < v->u.o.size);
-    return v->u.o.m[index].k;
+    CJSONParser *p = (CJSONParser *)MALLOC(&defaultAllocator, sizeof(CJSONParser));
+    p->allocator = defaultAllocator;
+    p->c.json = p->c.end = NULL;
+    p->c.stack = NULL;
+    p->c.size = p->c.top = 0;
+    p->c.allocator = &p->allocator;
+    p->c.doc = NULL;
+    p->c.vflags = 0;
+    p->c.pflags = 0;
+    p->levels = NULL;
+    p->depth = p->capacity = 0;
+    p->state = PARSER_VALUE;
+    p->ret = PARSE_OK;
+    ParserSetHandler(p, NULL);
+    return p;
 }
 
 /*******************************************************************************
-* Function   : GetObjectKeyLength
-* Description: 获取对象的第index个元素的键长度
+* Function   : ParserSetHandler
+* Description: 设置事件处理函数
 * Input      :
-    * v, 当前层数组的起始指针
-    * index, 元素的顺序
+    * p, 解析器; handler, 事件处理函数，NULL表示建立节点树
 * Output     :
-* Return     : 键长度
-* Others     : 
+* Return     : 
+* Others     : 只能在开始解析一个文档之前设置
 *******************************************************************************/
-size_t GetObjectKeyLength(const CJSONValue *v, size_t index)
+void ParserSetHandler(CJSONParser *p, const CJSONHandler *handler)
 {
-    assert(v != NULL && v->type == TYPE_OBJECT);
-    assert(index < v->u.o.size);
-    return v->u.o.m[index].klen;
+    assert(NULL != p && p->state == PARSER_VALUE && p->c.top == 0);
+    p->dom = domHandler;
+    p->dom.user = &p->c;
+    p->c.handler = (handler != NULL) ? handler : &p->dom;
 }
 
 /*******************************************************************************
-* Function   : GetObjectValue
-* Description: 获取对象的第index个元素
+* Function   : ParserFeed
+* Description: 输入一块JSON文本并立即解析
+    * 块的边界可以落在任何位置，包括字符串、数值、literal、转义序列的中间
+    * 未完成的字符串和数值暂存在解析器的栈中，所在的数组、对象记录在层次栈中
 * Input      :
-    * v, 当前层数组的起始指针
-    * index, 元素的顺序
+    * p, 解析器; buf, 输入块，不需要以'\0'结尾; len, 输入块的长度
 * Output     :
-* Return     : 对象的第index个元素
-* Others     : 
+* Return     : 
+    * PARSE_OK, 目前为止的输入都合法
+    * 其他, 同Parse，出错后再输入也返回同一个错误码
+* Others     : 输入中的'\0'和Parse一样被当作JSON文本的结束
 *******************************************************************************/
-CJSONValue *GetObjectValue(const CJSONValue *v, size_t index)
+int ParserFeed(CJSONParser *p, const char *buf, size_t len)
 {
-    assert(v != NULL && v->type == TYPE_OBJECT);
-    assert(index < v->u.o.size);
-    return &v->u.o.m[index].v;
+    assert(NULL != p && (NULL != buf || len == 0));
+    if(p->ret == PARSE_OK && len > 0){
+        p->ret = ParserConsume(p, buf, buf + len);
+        STATS_ADD(parseBytes, len);
+    }
+    return p->ret;
 }
 
 /*******************************************************************************
-* Function   : FreeValue
-* Description: 释放以v为根节点的树的内存
+* Function   : ParserFinish
+* Description: 输入结束，检查JSON文本是否完整，得到解析结果
 * Input      :
-    * v, Json的节点
-* Output     : 
-* Return     : 
-* Others     : 
+    * p, 解析器
+* Output     :
+    * v, 没有设置处理函数时输出节点树，出错时为null；设置了处理函数时可以为NULL
+* Return     : 同Parse
+* Others     : 之后解析器回到初始状态，可以解析下一个文档，栈等内存会被保留
 *******************************************************************************/
-void FreeValue(CJSONValue *v)
+int ParserFinish(CJSONParser *p, CJSONValue *v)
 {
-    assert(v != NULL);
-    size_t i;
-    switch(v->type){
-        case TYPE_STRING:
-            free(v->u.s.s);
-            break;
-        case TYPE_ARRAY:
-            for(i = 0; i < v->u.a.size; i++)
-                FreeValue(&v->u.a.e[i]);
-            free(v->u.a.e);
-            break;
-        case TYPE_OBJECT:
-            for(i = 0; i < v->u.o.size; i++){
-                free(v->u.o.m[i].k);
-                FreeValue(&v->u.o.m[i].v);
-            }
-            free(v->u.o.m);
-            break;
-        default:
-            break;
+    int ret;
+    assert(NULL != p);
+    //用一个'\0'表示文本结束，和Parse遇到'\0'时的处理完全一样
+    if(p->ret == PARSE_OK)
+        p->ret = ParserConsume(p, "", (const char *)"" + 1);
+    ret = p->ret;
+    STATS_ADD(parses, 1);
+    if(p->c.handler == &p->dom){
+        assert(NULL != v);
+        INIT_VALUE_NULL(v);
+        if(ret == PARSE_OK)
+            memcpy(v, ContextPop(&p->c, sizeof(CJSONValue)), sizeof(CJSONValue));
     }
-    //避免重复释放
-    v->type = TYPE_NULL;
+    ParserClear(p);
+    return ret;
 }
 
-/*-----------------------------------------------------------------------------
-* Function   : ParseWhiteSpace
-* Description: 解析字符串中的空格，如果发现空格、制表符等字符串指针后移
+/*******************************************************************************
+* Function   : ParserParse
+* Description: 用解析器一次性解析一段完整的JSON文本
+    * 和ParseN的结果相同，但是解析栈属于解析器，下一次解析直接复用，不再从头扩展
+    * 适合在一个循环中解析大量小消息，每个线程使用自己的解析器
 * Input      :
-    * c, Json内容
+    * p, 没有正在进行增量解析的解析器; json, 待解析的JSON文本，不需要以'\0'结尾; len, 文本的长度
 * Output     :
-* Return     : 
+    * v, 没有设置处理函数时输出节点树，需要FreeValue释放；设置了处理函数时可以为NULL
+* Return     : 同Parse
 * Others     : 
------------------------------------------------------------------------------*/
-static void ParseWhiteSpace(CJSONContext *c)
+    * 节点从解析器创建时的默认分配器申请
+    * 和ParseN一样，文本中间的'\0'按照非法字符处理
+*******************************************************************************/
+int ParserParse(CJSONParser *p, CJSONValue *v, const char *json, size_t len)
 {
-    const char *p = c->json;
-    while(*p == ' ' || *p == '\t' || *p == '\n' || *p =='\r')
-        p++;
-    c->json = p;
+    CJSONContext *c;
+    int ret;
+    assert(NULL != p && (NULL != json || len == 0));
+    assert(p->state == PARSER_VALUE && p->depth == 0 && p->c.top == 0);
+    c = &p->c;
+    c->json = json;
+    c->end = json + len;
+    if(c->handler != &p->dom)
+        return ParseText(c);
+    assert(NULL != v);
+    INIT_VALUE_NULL(v);
+    ret = ParseText(c);
+    if(ret == PARSE_OK || ret == PARSE_ROOT_NOT_SINGULAR)
+        memcpy(v, ContextPop(c, sizeof(CJSONValue)), sizeof(CJSONValue));
+    else{
+        while(c->top > 0)
+            FreeValueWithAllocator((CJSONValue *)ContextPop(c, sizeof(CJSONValue)), c->allocator);
+    }
+    assert(c->top == 0);
+    return ret;
 }
 
-/*-----------------------------------------------------------------------------
-* Function   : ParseLiteral
-* Description: 按照固定字符串解析literal
+/*******************************************************************************
+* Function   : ParserReset
+* Description: 放弃正在进行的增量解析，回到初始状态
 * Input      :
-    * c, Json内容
-    * literal, 用于对比的固定字符串
-    * type, 节点类型
+    * p, 解析器
 * Output     :
-    * v, Json节点
 * Return     : 
-    * PARSE_OK, 解析成功
-    * PARSE_INVALID_VALUE, 解析得到非法值
-* Others     : JSON的null、false、true的语法描述如下
-
-JSON-text = ws value ws
-ws = *(%x20 / %x09 / %x0A / %x0D)
-value = null / false / true
-null = "null"
-false = "false"
-true = "true" 
------------------------------------------------------------------------------*/
-static int ParseLiteral(CJSONContext *c, CJSONValue *v, const char *literal, CJSONType type)
+* Others     : 已经产生的未完成节点被释放，栈等内存保留
+*******************************************************************************/
+void ParserReset(CJSONParser *p)
 {
-    //在C中，数组长度、索引值最好使用size_t，而不是int或unsigned
-    size_t i;
-    EXPECT(c, literal[0]);
-    for(i=0; literal[i+1]; i++)
-        if(c->json[i] != literal[i+1])
-            return PARSE_INVALID_VALUE;
-    c->json += i;
-    v->type = type;
-    return PARSE_OK;
+    assert(NULL != p);
+    ParserClear(p);
 }
 
-/*-----------------------------------------------------------------------------
-* Function   : ParseNumber
-* Description: 解析数值类型
+/*******************************************************************************
+* Function   : ParserShrink
+* Description: 释放解析器保留的多余内存
+    * 偶尔解析一个很大的文档会让栈一直保持很大，可以在之后调用它
 * Input      :
-    * c, Json内容
+    * p, 没有正在进行增量解析的解析器; size, 栈最多保留的字节数，小于STACK_INIT_SIZE时全部释放
 * Output     :
-    * v, Json节点
 * Return     : 
-    * PARSE_OK, 解析成功
-    * PARSE_INVALID_VALUE, 解析得到非法值
-* Others     : JSON数值类型的语法描述如下
-
-number = [ "-" ] int [ frac ] [ exp ]
-int = "0" / digit1-9 *digit
-frac = "." 1*digit
-exp = ("e" / "E") ["-" / "+"] 1*digit
------------------------------------------------------------------------------*/
-static int ParseNumber(CJSONContext *c, CJSONValue *v)
+* Others     : 层次栈全部释放，需要时重新申请
+*******************************************************************************/
+void ParserShrink(CJSONParser *p, size_t size)
 {
-    const char *p = c->json;
-    if(*p == '-') 
-        p++;
-    if(*p == '0') 
-        p++;
-    else{
-        if(!ISDIGIT1TO9(*p))
-            return PARSE_INVALID_VALUE;
-        for(p++; ISDIGIT(*p); p++);
-    }
-    if(*p == '.'){
-        p++;
-        if(!ISDIGIT(*p))
-            return PARSE_INVALID_VALUE;
-        for(p++; ISDIGIT(*p); p++);
-    }
-    if(*p == 'e' || *p == 'E'){
-        p++;
-        if(*p == '+' || *p == '-')
-            p++;
-        if(!ISDIGIT(*p))
-            return PARSE_INVALID_VALUE;
-        for(p++; ISDIGIT(*p); p++);
+    assert(NULL != p && p->state == PARSER_VALUE && p->depth == 0 && p->c.top == 0);
+    if(p->c.size > size){
+        //栈按1.5倍扩展，太小的栈无法扩展，直接释放，下次从STACK_INIT_SIZE开始
+        if(size < STACK_INIT_SIZE){
+            size = 0;
+            FREE(&p->allocator, p->c.stack);
+            p->c.stack = NULL;
+        }
+        else
+            p->c.stack = (char *)REALLOC(&p->allocator, p->c.stack, size);
+        p->c.size = size;
     }
-    errno = 0;
-    //前面这些就是按照数值的语法描述对其进行语法校验！
-    //这部分是JSON解析的一个重点：如何将语法描述翻译成代码
-
-    //使用strtod转换成数值型
-    v->u.n = strtod(c->json, NULL);
+    FREE(&p->allocator, p->levels);
+    p->levels = NULL;
+    p->capacity = 0;
+}
 
-    //检查数值是否过大！
-    if(errno == ERANGE && (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL))
-        return PARSE_NUMBER_TOO_BIG;
+/*******************************************************************************
+* Function   : ParserDestroy
+* Description: 销毁解析器，未完成的节点一并释放
+* Input      :
+    * p, 解析器
+* Output     :
+* Return     : 
+* Others     : 
+*******************************************************************************/
+void ParserDestroy(CJSONParser *p)
+{
+    if(p == NULL)
+        return;
+    ParserClear(p);
+    FREE(&p->allocator, p->c.stack);
+    FREE(&p->allocator, p->levels);
+    FREE(&p->allocator, p);
+}
 
-    v->type = TYPE_NUMBER;
-    c->json = p;
-    return PARSE_OK;
+/*******************************************************************************
+* Function   : GetStats
+* Description: 获取当前线程从上次ResetStats以来的解析、生成统计
+* Input      :
+* Output     :
+    * stats, 统计信息，编译cJson.c时没有定义CJSON_STATS则全部为0
+* Return     : 
+* Others     : 
+*******************************************************************************/
+void GetStats(CJSONStats *stats)
+{
+    assert(NULL != stats);
+#if defined(CJSON_STATS)
+    *stats = threadStats;
+#else
+    memset(stats, 0, sizeof(CJSONStats));
+#endif
 }
 
-/*-----------------------------------------------------------------------------
-* Function   : ParseStringRaw
-* Description: 解析字符串
-    * 先备份栈顶，然后把解析到的字符串压栈
-    * 最后计算出长度并一次性将所有字符弹出，再设置至值里面即可
+/*******************************************************************************
+* Function   : ResetStats
+* Description: 清零当前线程的解析、生成统计
 * Input      :
-    * c, Json内容
-    * len, 
 * Output     :
-    * str, 解析出来的字符串
 * Return     : 
-    * PARSE_OK, 解析成功
-    * PARSE_MISS_QUOTATION_MARK, 没有遇到结束"
 * Others     : 
+*******************************************************************************/
+void ResetStats(void)
+{
+#if defined(CJSON_STATS)
+    memset(&threadStats, 0, sizeof(CJSONStats));
+#endif
+}
 
-string = quotation-mark *char quotation-mark
-char = unescaped /
-   escape (
-      %x22 /                ; "  quotation mark   U+0022
-      %x5C /                ; \  reverse solidus  U+005C
-      %x2F /                ; /  solidus          U+002F
-      %x62 /                ; b  backspace        U+0008
-      %x66 /                ; f  form feed        U+000C
-      %x6E /                ; n  line feed        U+000A
-      %x72 /                ; r  carriage return  U+000D
-      %x74 /                ; t  tab              U+0009
-      %x75 4HEXDIG )        ; uXXXX               U+XXXX
-escape = %x5C               ; \
-quotation-mark = %x22       ; "
-unescaped = %x20-21 / %x23-5B / %x5D-10FFFF
------------------------------------------------------------------------------*/
-static int ParseStringRaw(CJSONContext *c, char **str, size_t *len)
+/*******************************************************************************
+* Function   : InitDocument
+* Description: 初始化一个空文档，第一次分配时才申请内存块
+* Input      :
+    * doc, 文档
+* Output     :
+* Return     : 
+* Others     : 文档记录下当前的默认分配器，之后SetAllocator不影响该文档
+*******************************************************************************/
+void InitDocument(CJSONDocument *doc)
 {
-    size_t head = c->top;      //先备份栈顶
-    const char *p;
+    InitDocumentWithAllocator(doc, &defaultAllocator);
+}
 
-    EXPECT(c, '\"');
-    p = c->json;
-    for(;;){
-        char ch = *p++;
-        switch(ch){
-            case '\"':
-                *len = c->top - head;
-                *str = ContextPop(c, *len);
-                c->json = p;
-                return PARSE_OK;
-            //解析转义字符
-            case '\\':
-                switch(*p++){
-                    case '\"': PUTC(c, '\"'); break;
-                    case '\\': PUTC(c, '\\'); break;
-                    case '/' : PUTC(c, '/');  break;
-                    case 'b' : PUTC(c, '\b'); break;
-                    case 'f' : PUTC(c, '\f'); break;
-                    case 'n' : PUTC(c, '\n'); break;
-                    case 'r' : PUTC(c, '\r'); break;
-                    case 't' : PUTC(c, '\t'); break;
-                    default:
-                       c->top = head;
-                       return PARSE_INVALID_STRING_ESCAPE;
-                }
-                break;
-            case '\0':
-                c->top = head;
-                return PARSE_MISS_QUOTATION_MARK;
-            default:
-                //处理不合法字符串
-                if((unsigned char)ch < 0x20){
-                    c->top = head;
-                    return PARSE_INVALID_STRING_CHAR;
-                }
-                PUTC(c, ch);
-        }
+/*******************************************************************************
+* Function   : InitDocumentWithAllocator
+* Description: 初始化一个空文档，文档的内存块从allocator申请
+* Input      :
+    * doc, 文档
+    * allocator, 分配器，文档中保存一份拷贝
+* Output     :
+* Return     : 
+* Others     : 
+*******************************************************************************/
+void InitDocumentWithAllocator(CJSONDocument *doc, const CJSONAllocator *allocator)
+{
+    assert(NULL != doc && NULL != allocator);
+    doc->chunks = NULL;
+    doc->cur = doc->end = NULL;
+    doc->allocator = *allocator;
+    doc->stack = NULL;
+    doc->ssize = 0;
+}
+
+/*******************************************************************************
+* Function   : ClearDocument
+* Description: 释放文档中的所有节点，但保留当前块以便下一次解析复用
+* Input      :
+    * doc, 文档
+* Output     :
+* Return     : 
+* Others     : 之前在该文档中解析出的节点全部失效，保存根节点的变量要再次使用时先INIT_VALUE_NULL
+*******************************************************************************/
+void ClearDocument(CJSONDocument *doc)
+{
+    CJSONChunk *chunk, *next;
+    assert(NULL != doc);
+    if(doc->chunks == NULL)
+        return;
+    for(chunk = doc->chunks->next; chunk != NULL; chunk = next){
+        next = chunk->next;
+        FREE(&doc->allocator, chunk);
     }
+    doc->chunks->next = NULL;
+    doc->cur = (char *)(doc->chunks + 1);
+    doc->end = doc->cur + doc->chunks->size;
 }
 
-/*-----------------------------------------------------------------------------
-* Function   : ParseString
-* Description: 
-    * ParseStringRaw 主要用于解析普遍的字符串：键值对的键、JSON字符串
-    * ParseString    用于在ParseStringRaw的基础上解析JSON的字符串对象
+/*******************************************************************************
+* Function   : FreeDocument
+* Description: 释放文档的所有内存块，时间只和块数有关，和节点个数无关
+* Input      :
+    * doc, 文档
+* Output     :
+* Return     : 
+* Others     : 之前在该文档中解析出的节点全部失效，保存根节点的变量要再次使用时先INIT_VALUE_NULL
+*******************************************************************************/
+void FreeDocument(CJSONDocument *doc)
+{
+    CJSONChunk *chunk, *next;
+    assert(NULL != doc);
+    for(chunk = doc->chunks; chunk != NULL; chunk = next){
+        next = chunk->next;
+        FREE(&doc->allocator, chunk);
+    }
+    FREE(&doc->allocator, doc->stack);
+    doc->chunks = NULL;
+    doc->cur = doc->end = NULL;
+    doc->stack = NULL;
+    doc->ssize = 0;
+}
+
+/*******************************************************************************
+* Function   : Stringify
+* Description: 
+    * 将在内存中的树形结构生成对应的JSON字符串
+    * 该API提供length可选参数，当传入非空指针时，就能获得生成JSON的长度
+    * 为什么需要获得长度，不是可以用strlen()获取吗？
+    * 多了一个strlen()调用会带来不必要的性能消耗，理想地避免调用方有额外消耗
+* Input      :
+    * v, 树形结构的根节点
+    * length, 可选，存储 JSON 的长度，传入 NULL 可忽略此参数
+* Output     : 
+    * json, json格式的字符串
+* Return     : 
+    * STRINGIFY_OK, 生成成功
+    * STRINGIFY_INVALID_NUMBER, 有inf或nan，json为NULL
+    * STRINGIFY_INVALID_LAZY_VALUE, 按需解析的数组、对象展开失败，json为NULL
+* Others     : 
+*******************************************************************************/
+int Stringify(const CJSONValue *v, char **json, size_t *length)
+{
+    return StringifyWithAllocator(v, json, length, &defaultAllocator);
+}
+
+/*******************************************************************************
+* Function   : StringifyWithAllocator
+* Description: 使用指定的分配器生成JSON字符串
+* Input      :
+    * v, 树形结构的根节点
+    * length, 可选，存储 JSON 的长度，传入 NULL 可忽略此参数
+    * allocator, 分配器
+* Output     : 
+    * json, json格式的字符串，需要用allocator释放
+* Return     : 同Stringify
+* Others     : 
+*******************************************************************************/
+int StringifyWithAllocator(const CJSONValue *v, char **json, size_t *length, const CJSONAllocator *allocator)
+{
+    CJSONContext c;
+    int ret;
+    assert(NULL != v);
+    assert(NULL != json);
+    assert(NULL != allocator);
+    c.allocator = allocator;
+    //初始化一个STRINGIFY_STACK_INIT_SIZE大小的堆
+    c.stack = (char *)MALLOC(allocator, c.size = STRINGIFY_STACK_INIT_SIZE);
+    c.top = 0;
+    c.write = NULL;
+    //以v为根节点解析，将解析结果放到c中
+    if((ret = StringifyValue(&c, v)) != STRINGIFY_OK){
+        FREE(allocator, c.stack);
+        *json = NULL;
+        return ret;
+    }
+    //获取解析结果长度
+    if(length)
+        *length = c.top;
+    //将栈顶设置为'\0'，表示字符串结尾
+    PUTC(&c, '\0');
+    *json = c.stack;
+    return STRINGIFY_OK;
+}
+
+/*******************************************************************************
+* Function   : StringifyToWriter
+* Description: 流式生成JSON字符串，边生成边交给输出函数
+    * 内部只有一个STRINGIFY_WRITER_BUFFER_SIZE大小的缓冲区，写满就交给write
+    * 峰值内存和生成的JSON大小无关，第一批内容在生成剩余部分时就已经输出
+* Input      :
+    * v, 树形结构的根节点
+    * write, 输出函数
+    * user, 原样传给输出函数
+* Output     :
+* Return     : 
+    * STRINGIFY_OK, 生成成功
+    * STRINGIFY_WRITE_ERROR, 输出函数返回0，此后的内容不再输出
+    * STRINGIFY_INVALID_NUMBER, 有inf或nan，已经输出的是不完整的JSON
+    * STRINGIFY_INVALID_LAZY_VALUE, 按需解析的数组、对象展开失败，已经输出的是不完整的JSON
+* Others     : 
+    * 输出的内容不以'\0'结尾
+    * 较长的字符串不经过缓冲区，直接交给输出函数
+*******************************************************************************/
+int StringifyToWriter(const CJSONValue *v, CJSONWriteFunc write, void *user)
+{
+    CJSONContext c;
+    int ret;
+    assert(NULL != v);
+    assert(NULL != write);
+    c.allocator = &defaultAllocator;
+    c.stack = (char *)MALLOC(c.allocator, c.size = STRINGIFY_WRITER_BUFFER_SIZE);
+    c.top = 0;
+    c.write = write;
+    c.wuser = user;
+    c.wret = STRINGIFY_OK;
+    ret = StringifyValue(&c, v);
+    //输出缓冲区中剩余的内容
+    OutputFlush(&c);
+    FREE(c.allocator, c.stack);
+    return (ret != STRINGIFY_OK) ? ret : c.wret;
+}
+
+/*******************************************************************************
+* Function   : StringifyToFile
+* Description: 流式生成JSON字符串，写入文件
+* Input      :
+    * v, 树形结构的根节点
+    * fp, 打开的文件
+* Output     :
+* Return     : 同StringifyToWriter，fwrite失败时返回STRINGIFY_WRITE_ERROR
+* Others     : 
+    * 不会调用fflush，需要时由调用方自行刷新
+*******************************************************************************/
+int StringifyToFile(const CJSONValue *v, FILE *fp)
+{
+    assert(NULL != fp);
+    return StringifyToWriter(v, FileWrite, fp);
+}
+
+/*******************************************************************************
+* Function   : StringifyToFd
+* Description: 流式生成JSON字符串，写入文件描述符(文件、管道、socket)
+* Input      :
+    * v, 树形结构的根节点
+    * fd, 文件描述符
+* Output     :
+* Return     : 同StringifyToWriter，write失败时返回STRINGIFY_WRITE_ERROR
+* Others     : 
+    * 部分写入和被信号中断时会继续写，直到写完或出错
+*******************************************************************************/
+int StringifyToFd(const CJSONValue *v, int fd)
+{
+    assert(fd >= 0);
+    return StringifyToWriter(v, FdWrite, &fd);
+}
+
+/*******************************************************************************
+* Function   : StringifiedLength
+* Description: 计算v生成的JSON字符串的精确长度，不生成字符串，通常也不申请内存(例外同StringifyInto)
+    * 可以先用它确定发送缓冲区的大小，再用StringifyInto直接生成到缓冲区中
+* Input      :
+    * v, 树形结构的根节点
+* Output     :
+* Return     : 
+    * 生成的JSON字符串的字节数，不包括结尾的'\0'
+    * INVALID_LENGTH, 无法生成，Stringify会返回错误码(如有inf、nan，按需解析的子树展开失败)
+* Others     : 
+    * 数值需要格式化一次才能知道宽度，代价和生成一次数值相同
+*******************************************************************************/
+size_t StringifiedLength(const CJSONValue *v)
+{
+    size_t len;
+    assert(NULL != v);
+    return (StringifiedValueLength(v, &len) == STRINGIFY_OK) ? len : INVALID_LENGTH;
+}
+
+/*******************************************************************************
+* Function   : StringifyInto
+* Description: 把JSON字符串生成到调用方提供的缓冲区中，输出不申请内存
+* Input      :
+    * v, 树形结构的根节点
+    * buf, 缓冲区
+    * cap, 缓冲区的字节数
+    * length, 可选，存储 JSON 的长度，传入 NULL 可忽略此参数
+* Output     :
+    * buf, 生成的JSON字符串，cap比长度大时在结尾补'\0'
+* Return     : 
+    * STRINGIFY_OK, 生成成功
+    * STRINGIFY_BUFFER_TOO_SMALL, 缓冲区放不下，buf的内容不变，length中是需要的长度
+    * STRINGIFY_INVALID_NUMBER, 有inf或nan，buf和length都不变
+    * STRINGIFY_INVALID_LAZY_VALUE, 按需解析的数组、对象展开失败，buf和length都不变
+* Others     : 
+    * 先用StringifiedLength计算长度，所以不会写出缓冲区
+    * 有两种情况仍会申请内存：嵌套超过WALK_INIT_SIZE层时遍历用的栈从默认分配器申请；
+    * 还没有展开的按需解析子树在这里展开，从所在的文档中申请
+*******************************************************************************/
+int StringifyInto(const CJSONValue *v, char *buf, size_t cap, size_t *length)
+{
+    size_t len;
+    int ret;
+    assert(NULL != v);
+    assert(NULL != buf || cap == 0);
+    if((ret = StringifiedValueLength(v, &len)) != STRINGIFY_OK)
+        return ret;
+    if(length)
+        *length = len;
+    if(len > cap)
+        return STRINGIFY_BUFFER_TOO_SMALL;
+    StringifyExact(v, buf, len);
+    if(cap > len)
+        buf[len] = '\0';
+    return STRINGIFY_OK;
+}
+
+/*******************************************************************************
+* Function   : GetType
+* Description: 获取Json的某个节点值的类型
+* Input      :
+    * v, 一个Json节点
+* Output     :
+* Return     : JSON节点的类型
+* Others     : 
+*******************************************************************************/
+CJSONType GetType(const CJSONValue *v)
+{
+    assert(NULL != v);
+    return v->type;
+}
+
+/*******************************************************************************
+* Function   : GetBoolean
+* Description: 将JSON节点作为布尔类型获得其值
+* Input      :
+    * v, 一个Json节点
+* Output     :
+* Return     : TYPE_FALSE; TYPE_TRUE
+* Others     : 
+*******************************************************************************/
+int GetBoolean(const CJSONValue *v)
+{
+    assert(NULL != v && (v->type == TYPE_TRUE || v->type == TYPE_FALSE));
+    return v->type;
+}
+
+/*******************************************************************************
+* Function   : SetBoolean
+* Description: 将JSON节点作为布尔类型设置其值
+* Input      :
+    * v, 一个Json节点
+    * b, 要设置的值
+* Output     : 
+* Return     : 
+* Others     : 
+*******************************************************************************/
+void SetBoolean(CJSONValue *v, int b)
+{
+    FreeValue(v);
+    v->type = b;
+}
+
+/*******************************************************************************
+* Function   : GetNumber
+* Description: 获取Json的某个数值型节点值的数值
+* Input      :
+    * v, 一个Json节点
+* Output     :
+* Return     : JSON节点的数值
+* Others     : 
+*******************************************************************************/
+double GetNumber(const CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_NUMBER);
+    return v->u.n;
+}
+
+/*******************************************************************************
+* Function   : SetNumber
+* Description: 设置JSON节点为数值类型
+* Input      :
+    * v, 一个Json节点
+    * n, 要设置的数值
+* Output     :
+* Return     : 
+* Others     : n是inf或nan时生成JSON会返回STRINGIFY_INVALID_NUMBER
+*******************************************************************************/
+void SetNumber(CJSONValue *v, double n)
+{
+    FreeValue(v);
+    v->u.n = n;
+    v->type = TYPE_NUMBER;
+}
+
+/*******************************************************************************
+* Function   : GetString
+* Description: 获得JSON节点的字符串值
+* Input      :
+    * v, 一个Json节点
+* Output     : 
+* Return     : 字符串指针
+* Others     : 短字符串存放在节点内部，节点被移动(如数组扩展)或修改后指针失效
+*******************************************************************************/
+const char *GetString(const CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_STRING);
+    return STRING_PTR(v);
+}
+
+/*******************************************************************************
+* Function   : GetStringLength
+* Description: 获取JSON字符串节点的字符串长度
+* Input      : 
+    * v, 一个Json节点
+* Output     : 
+* Return     : 字符串长度
+* Others     : 
+*******************************************************************************/
+size_t GetStringLength(const CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_STRING);
+    return STRING_LEN(v);
+}
+
+/*******************************************************************************
+* Function   : SetString
+* Description: 设置string类型节点的值
+* Input      :
+    * s, 字符串值
+    * len, 字符串长度
+* Output     :
+    * v, Json的string节点
+* Return     : 
+* Others     : 
+    * 不超过SHORT_STRING_MAX字节的字符串直接存放在节点内，不申请内存
+    * s不能指向v自身的字符串
+    * v不能是文档中的节点：字符串从默认分配器申请，FreeDocument不会释放它
+*******************************************************************************/
+void SetString(CJSONValue *v, const char *s, size_t len)
+{
+    assert(v != NULL && (s != NULL || len == 0) && !(v->flags & VALUE_FLAG_DOCUMENT));
+    FreeValue(v);
+    StringInit(v, NULL, s, len);
+    v->type = TYPE_STRING;
+}
+
+/*******************************************************************************
+* Function   : GetArraySize
+* Description: 获取当前层数组元素个数
+* Input      :
+    * v, 当前层数组的起始指针
+* Output     :
+* Return     : 
+* Others     : 按需解析的数组展开失败时返回0，和空数组无法区分，用MaterializeValue检查
+*******************************************************************************/
+size_t GetArraySize(const CJSONValue *v)
+{
+    assert(NULL != v && v->type == TYPE_ARRAY);
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return 0;
+    return v->u.a.size;
+}
+
+/*******************************************************************************
+* Function   : GetArrayElement
+* Description: 获取当前层数组的第index个元素
+* Input      :
+    * v, 当前层数组的起始指针
+    * index, 元素的顺序
+* Output     :
+    * v, Json的string节点
+* Return     : 
+* Others     : 按需解析的数组展开失败时返回NULL
+*******************************************************************************/
+CJSONValue *GetArrayElement(const CJSONValue *v, size_t index)
+{
+    assert(NULL != v && v->type == TYPE_ARRAY);
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return NULL;
+    assert(index < v->u.a.size);
+    return &v->u.a.e[index];
+}
+
+/*******************************************************************************
+* Function   : GetObjectSize
+* Description: 获取当前JSON对象的元素个数
+* Input      :
+    * v, 当前层对象
+* Output     :
+* Return     : JSON对象元素个数
+* Others     : 按需解析的对象展开失败时返回0，和空对象无法区分，用MaterializeValue检查
+*******************************************************************************/
+size_t GetObjectSize(const CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_OBJECT);
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return 0;
+    return v->u.o.size;
+}
+
+/*******************************************************************************
+* Function   : GetObjectKey
+* Description: 获取对象的第index个元素的键
+* Input      :
+    * v, 当前层数组的起始指针
+    * index, 元素的顺序
+* Output     : 
+* Return     : 键指针
+* Others     : 按需解析的对象展开失败时返回NULL
+*******************************************************************************/
+const char *GetObjectKey(const CJSONValue *v, size_t index)
+{
+    assert(v != NULL && v->type == TYPE_OBJECT);
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return NULL;
+    assert(index < v->u.o.size);
+    return KEY_PTR(&v->u.o.m[index]);
+}
+
+/*******************************************************************************
+* Function   : GetObjectKeyLength
+* Description: 获取对象的第index个元素的键长度
+* Input      :
+    * v, 当前层数组的起始指针
+    * index, 元素的顺序
+* Output     :
+* Return     : 键长度
+* Others     : 按需解析的对象展开失败时返回0
+*******************************************************************************/
+size_t GetObjectKeyLength(const CJSONValue *v, size_t index)
+{
+    assert(v != NULL && v->type == TYPE_OBJECT);
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return 0;
+    assert(index < v->u.o.size);
+    return KEY_LEN(&v->u.o.m[index]);
+}
+
+/*******************************************************************************
+* Function   : GetObjectValue
+* Description: 获取对象的第index个元素
+* Input      :
+    * v, 当前层数组的起始指针
+    * index, 元素的顺序
+* Output     :
+* Return     : 对象的第index个元素
+* Others     : 按需解析的对象展开失败时返回NULL
+*******************************************************************************/
+CJSONValue *GetObjectValue(const CJSONValue *v, size_t index)
+{
+    assert(v != NULL && v->type == TYPE_OBJECT);
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return NULL;
+    assert(index < v->u.o.size);
+    return &v->u.o.m[index].v;
+}
+
+/*******************************************************************************
+* Function   : FindObjectIndex
+* Description: 在对象中按键查找成员
+    * 成员个数少于OBJECT_INDEX_THRESHOLD时顺序比较
+    * 否则第一次查找时建立哈希索引，之后的查找都是O(1)
+* Input      :
+    * v, 对象节点
+    * key, 键
+    * klen, 键长度
+* Output     :
+* Return     : 成员的下标，有重复键时返回第一个，找不到返回KEY_NOT_EXIST
+* Others     : 
+    * 按需解析的对象展开失败时也返回KEY_NOT_EXIST，用MaterializeValue区分
+    * 建立索引会修改v，多线程共享同一棵树时需先在一个线程中查找一次
+    * 在文档中解析的大对象在解析时就已经建立了索引
+*******************************************************************************/
+size_t FindObjectIndex(CJSONValue *v, const char *key, size_t klen)
+{
+    size_t i;
+    assert(v != NULL && v->type == TYPE_OBJECT && (key != NULL || klen == 0));
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return KEY_NOT_EXIST;
+    if(v->u.o.index == NULL && v->u.o.size >= OBJECT_INDEX_THRESHOLD){
+        size_t bytes = ObjectIndexBytes(v->u.o.size);
+        v->u.o.index = (CJSONObjectIndex *)MALLOC(&defaultAllocator, bytes);
+        v->u.o.index->allocator = defaultAllocator;
+        ObjectIndexFill(v->u.o.index, bytes, v->u.o.m, v->u.o.size);
+    }
+    if(v->u.o.index != NULL)
+        return ObjectIndexFind(v->u.o.index, v->u.o.m, key, klen);
+    for(i = 0; i < v->u.o.size; i++)
+        if(KEY_LEN(&v->u.o.m[i]) == klen && memcmp(KEY_PTR(&v->u.o.m[i]), key, klen) == 0)
+            return i;
+    return KEY_NOT_EXIST;
+}
+
+/*******************************************************************************
+* Function   : FindObjectValue
+* Description: 在对象中按键查找值
+* Input      :
+    * v, 对象节点
+    * key, 键
+    * klen, 键长度
+* Output     :
+* Return     : 键对应的值，找不到返回NULL
+* Others     : 同FindObjectIndex
+*******************************************************************************/
+CJSONValue *FindObjectValue(CJSONValue *v, const char *key, size_t klen)
+{
+    size_t index = FindObjectIndex(v, key, klen);
+    return index != KEY_NOT_EXIST ? &v->u.o.m[index].v : NULL;
+}
+
+/*******************************************************************************
+* Function   : SetArray
+* Description: 设置JSON节点为空数组，预留capacity个元素的空间
+* Input      :
+    * v, 一个Json节点
+    * capacity, 预留的元素个数，可以为0
+* Output     :
+* Return     : 
+* Others     : 元素数组从默认分配器申请，v不能是文档中的节点，同SetString
+*******************************************************************************/
+void SetArray(CJSONValue *v, size_t capacity)
+{
+    assert(v != NULL && !(v->flags & VALUE_FLAG_DOCUMENT));
+    FreeValue(v);
+    v->type = TYPE_ARRAY;
+    v->u.a.size = 0;
+    v->u.a.capacity = capacity;
+    v->u.a.e = (capacity > 0) ? (CJSONValue *)MALLOC(&defaultAllocator, capacity * sizeof(CJSONValue)) : NULL;
+}
+
+/*******************************************************************************
+* Function   : GetArrayCapacity
+* Description: 获取数组的容量，元素个数不超过容量时追加元素不需要重新分配内存
+* Input      :
+    * v, 数组节点
+* Output     :
+* Return     : 容量
+* Others     : 解析出的数组容量和元素个数相等，按需解析的数组展开失败时返回0
+*******************************************************************************/
+size_t GetArrayCapacity(const CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_ARRAY);
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return 0;
+    return v->u.a.capacity;
+}
+
+/*******************************************************************************
+* Function   : ReserveArray
+* Description: 把数组的容量扩展到至少capacity
+* Input      :
+    * v, 数组节点
+    * capacity, 需要的容量
+* Output     :
+* Return     : 
+* Others     : 
+    * 修改数组的函数都不能用于文档中的节点，文档中的内存不能单独扩展、释放
+    * 容量变化后，之前取得的元素指针失效
+*******************************************************************************/
+void ReserveArray(CJSONValue *v, size_t capacity)
+{
+    assert(v != NULL && v->type == TYPE_ARRAY && !(v->flags & VALUE_FLAG_DOCUMENT));
+    if(capacity > v->u.a.capacity){
+        v->u.a.e = (CJSONValue *)REALLOC(&defaultAllocator, v->u.a.e, capacity * sizeof(CJSONValue));
+        v->u.a.capacity = capacity;
+    }
+}
+
+/*******************************************************************************
+* Function   : ShrinkArray
+* Description: 把数组的容量缩小到元素个数，释放多余的内存
+* Input      :
+    * v, 数组节点
+* Output     :
+* Return     : 
+* Others     : 同ReserveArray
+*******************************************************************************/
+void ShrinkArray(CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_ARRAY && !(v->flags & VALUE_FLAG_DOCUMENT));
+    if(v->u.a.capacity > v->u.a.size){
+        if(v->u.a.size > 0)
+            v->u.a.e = (CJSONValue *)REALLOC(&defaultAllocator, v->u.a.e, v->u.a.size * sizeof(CJSONValue));
+        else{
+            FREE(&defaultAllocator, v->u.a.e);
+            v->u.a.e = NULL;
+        }
+        v->u.a.capacity = v->u.a.size;
+    }
+}
+
+/*******************************************************************************
+* Function   : ClearArray
+* Description: 释放数组的所有元素，容量不变
+* Input      :
+    * v, 数组节点
+* Output     :
+* Return     : 
+* Others     : 同ReserveArray
+*******************************************************************************/
+void ClearArray(CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_ARRAY && !(v->flags & VALUE_FLAG_DOCUMENT));
+    EraseArrayElement(v, 0, v->u.a.size);
+}
+
+/*******************************************************************************
+* Function   : PushBackArrayElement
+* Description: 在数组末尾追加一个元素
+    * 容量不够时按1.5倍扩展，连续追加n个元素总共只需要O(log n)次重新分配
+* Input      :
+    * v, 数组节点
+* Output     :
+* Return     : 新元素，为null，由调用方设置它的值
+* Others     : 同ReserveArray
+*******************************************************************************/
+CJSONValue *PushBackArrayElement(CJSONValue *v)
+{
+    CJSONValue *e;
+    assert(v != NULL && v->type == TYPE_ARRAY && !(v->flags & VALUE_FLAG_DOCUMENT));
+    if(v->u.a.size == v->u.a.capacity)
+        ReserveArray(v, ContainerGrow(v->u.a.capacity));
+    e = &v->u.a.e[v->u.a.size++];
+    INIT_VALUE_NULL(e);
+    return e;
+}
+
+/*******************************************************************************
+* Function   : PopBackArrayElement
+* Description: 释放并删除数组的最后一个元素
+* Input      :
+    * v, 非空的数组节点
+* Output     :
+* Return     : 
+* Others     : 同ReserveArray
+*******************************************************************************/
+void PopBackArrayElement(CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_ARRAY && v->u.a.size > 0 && !(v->flags & VALUE_FLAG_DOCUMENT));
+    FreeValue(&v->u.a.e[--v->u.a.size]);
+}
+
+/*******************************************************************************
+* Function   : InsertArrayElement
+* Description: 在数组的index位置插入一个元素，之后的元素后移
+* Input      :
+    * v, 数组节点
+    * index, 插入的位置，等于元素个数时追加到末尾
+* Output     :
+* Return     : 新元素，为null，由调用方设置它的值
+* Others     : 同ReserveArray
+*******************************************************************************/
+CJSONValue *InsertArrayElement(CJSONValue *v, size_t index)
+{
+    CJSONValue *e;
+    assert(v != NULL && v->type == TYPE_ARRAY && !(v->flags & VALUE_FLAG_DOCUMENT) && index <= v->u.a.size);
+    if(v->u.a.size == v->u.a.capacity)
+        ReserveArray(v, ContainerGrow(v->u.a.capacity));
+    e = &v->u.a.e[index];
+    memmove(e + 1, e, (v->u.a.size - index) * sizeof(CJSONValue));
+    v->u.a.size++;
+    INIT_VALUE_NULL(e);
+    return e;
+}
+
+/*******************************************************************************
+* Function   : EraseArrayElement
+* Description: 释放并删除数组从index开始的count个元素，之后的元素前移，容量不变
+* Input      :
+    * v, 数组节点
+    * index, 第一个删除的元素
+    * count, 删除的个数
+* Output     :
+* Return     : 
+* Others     : 同ReserveArray
+*******************************************************************************/
+void EraseArrayElement(CJSONValue *v, size_t index, size_t count)
+{
+    size_t i;
+    assert(v != NULL && v->type == TYPE_ARRAY && !(v->flags & VALUE_FLAG_DOCUMENT));
+    assert(index <= v->u.a.size && count <= v->u.a.size - index);
+    for(i = index; i < index + count; i++)
+        FreeValue(&v->u.a.e[i]);
+    if(count > 0){
+        memmove(v->u.a.e + index, v->u.a.e + index + count, (v->u.a.size - index - count) * sizeof(CJSONValue));
+        v->u.a.size -= count;
+    }
+}
+
+/*******************************************************************************
+* Function   : SetObject
+* Description: 设置JSON节点为空对象，预留capacity个成员的空间
+* Input      :
+    * v, 一个Json节点
+    * capacity, 预留的成员个数，可以为0
+* Output     :
+* Return     : 
+* Others     : 成员数组、键从默认分配器申请，v不能是文档中的节点，同SetString
+*******************************************************************************/
+void SetObject(CJSONValue *v, size_t capacity)
+{
+    assert(v != NULL && !(v->flags & VALUE_FLAG_DOCUMENT));
+    FreeValue(v);
+    v->type = TYPE_OBJECT;
+    v->u.o.size = 0;
+    v->u.o.capacity = capacity;
+    v->u.o.index = NULL;
+    v->u.o.m = (capacity > 0) ? (CJSONMember *)MALLOC(&defaultAllocator, capacity * sizeof(CJSONMember)) : NULL;
+}
+
+/*******************************************************************************
+* Function   : GetObjectCapacity
+* Description: 获取对象的容量
+* Input      :
+    * v, 对象节点
+* Output     :
+* Return     : 容量
+* Others     : 解析出的对象容量和成员个数相等，按需解析的对象展开失败时返回0
+*******************************************************************************/
+size_t GetObjectCapacity(const CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_OBJECT);
+    MATERIALIZE(v);
+    if(VALUE_ERROR(v) != PARSE_OK)
+        return 0;
+    return v->u.o.capacity;
+}
+
+/*******************************************************************************
+* Function   : ReserveObject
+* Description: 把对象的容量扩展到至少capacity
+* Input      :
+    * v, 对象节点
+    * capacity, 需要的容量
+* Output     :
+* Return     : 
+* Others     : 
+    * 修改对象的函数都不能用于文档中的节点
+    * 容量变化后，之前取得的成员值的指针失效
+*******************************************************************************/
+void ReserveObject(CJSONValue *v, size_t capacity)
+{
+    assert(v != NULL && v->type == TYPE_OBJECT && !(v->flags & VALUE_FLAG_DOCUMENT));
+    if(capacity > v->u.o.capacity){
+        //索引记录的是成员的下标，成员数组移动后仍然有效
+        v->u.o.m = (CJSONMember *)REALLOC(&defaultAllocator, v->u.o.m, capacity * sizeof(CJSONMember));
+        v->u.o.capacity = capacity;
+    }
+}
+
+/*******************************************************************************
+* Function   : ShrinkObject
+* Description: 把对象的容量缩小到成员个数，释放多余的内存
+* Input      :
+    * v, 对象节点
+* Output     :
+* Return     : 
+* Others     : 同ReserveObject
+*******************************************************************************/
+void ShrinkObject(CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_OBJECT && !(v->flags & VALUE_FLAG_DOCUMENT));
+    if(v->u.o.capacity > v->u.o.size){
+        if(v->u.o.size > 0)
+            v->u.o.m = (CJSONMember *)REALLOC(&defaultAllocator, v->u.o.m, v->u.o.size * sizeof(CJSONMember));
+        else{
+            FREE(&defaultAllocator, v->u.o.m);
+            v->u.o.m = NULL;
+        }
+        v->u.o.capacity = v->u.o.size;
+    }
+}
+
+/*******************************************************************************
+* Function   : ClearObject
+* Description: 释放对象的所有成员，容量不变
+* Input      :
+    * v, 对象节点
+* Output     :
+* Return     : 
+* Others     : 同ReserveObject
+*******************************************************************************/
+void ClearObject(CJSONValue *v)
+{
+    assert(v != NULL && v->type == TYPE_OBJECT && !(v->flags & VALUE_FLAG_DOCUMENT));
+    while(v->u.o.size > 0)
+        RemoveObjectValue(v, v->u.o.size - 1);
+}
+
+/*******************************************************************************
+* Function   : SetObjectValue
+* Description: 取得对象中键对应的值，没有这个键时在末尾追加一个成员
+    * 容量不够时按1.5倍扩展；已经建立的哈希索引在追加时同步更新，负载过高时丢弃，
+    * 下一次查找时按新的大小重建，所以逐个追加n个成员总共是O(n)的
+* Input      :
+    * v, 对象节点
+    * key, 键，会被复制
+    * klen, 键长度
+* Output     :
+* Return     : 键对应的值，新追加的成员的值为null，由调用方设置
+* Others     : 同ReserveObject
+*******************************************************************************/
+CJSONValue *SetObjectValue(CJSONValue *v, const char *key, size_t klen)
+{
+    CJSONObjectIndex *index;
+    CJSONMember *m;
+    size_t i, j;
+    assert(v != NULL && v->type == TYPE_OBJECT && !(v->flags & VALUE_FLAG_DOCUMENT));
+    if((i = FindObjectIndex(v, key, klen)) != KEY_NOT_EXIST)
+        return &v->u.o.m[i].v;
+    if(v->u.o.size == v->u.o.capacity)
+        ReserveObject(v, ContainerGrow(v->u.o.capacity));
+    i = v->u.o.size++;
+    m = &v->u.o.m[i];
+    INIT_VALUE_NULL(&m->v);
+    KeyInit(m, NULL, key, klen);
+    if((index = v->u.o.index) != NULL){
+        //负载不超过1/2时直接插入，键已经确认不存在
+        if(v->u.o.size * 2 <= index->mask + 1){
+            for(j = HashKey(key, klen) & index->mask; index->slots[j] != 0; j = (j + 1) & index->mask)
+                ;
+            index->slots[j] = i + 1;
+        }
+        else{
+            FREE(&index->allocator, index);
+            v->u.o.index = NULL;
+        }
+    }
+    return &m->v;
+}
+
+/*******************************************************************************
+* Function   : RemoveObjectValue
+* Description: 释放并删除对象的第index个成员，之后的成员前移，容量不变
+* Input      :
+    * v, 对象节点
+    * index, 成员的下标
+* Output     :
+* Return     : 
+* Others     : 
+    * 同ReserveObject
+    * 成员的下标改变，哈希索引被丢弃，下一次查找时重建
+*******************************************************************************/
+void RemoveObjectValue(CJSONValue *v, size_t index)
+{
+    CJSONMember *m;
+    assert(v != NULL && v->type == TYPE_OBJECT && !(v->flags & VALUE_FLAG_DOCUMENT));
+    assert(index < v->u.o.size);
+    m = &v->u.o.m[index];
+    if(KEY_TAG(m) == KEY_TAG_OWNED)
+        FREE(&defaultAllocator, m->key.p.k);
+    FreeValue(&m->v);
+    memmove(m, m + 1, (v->u.o.size - index - 1) * sizeof(CJSONMember));
+    v->u.o.size--;
+    if(v->u.o.index != NULL){
+        FREE(&v->u.o.index->allocator, v->u.o.index);
+        v->u.o.index = NULL;
+    }
+}
+
+/*******************************************************************************
+* Function   : MoveValue
+* Description: 把src的值转移给dst，src变为null，O(1)，不复制任何内容
+* Input      :
+    * dst, 目标节点，原来的值先被释放
+    * src, 源节点
+* Output     :
+* Return     : 
+* Others     : 
+    * src在dst的子树中也可以，dst不能在src的子树中
+    * 内容在文档中的字符串、数组、对象转移后仍然属于文档；null、布尔、数值、短字符串
+    * 不持有内存，VALUE_FLAG_DOCUMENT留在dst、src原来的位置上，文档中的位置仍然不能用SetString等
+    * src持有文档中的内容时无法知道它原来是不是文档中的位置，转移后的null仍带着标志，
+    * 不在文档中时用INIT_VALUE_NULL重新初始化后才能放入从分配器申请的内存
+    * dst是文档中的节点时，src只能是文档中的节点或者不持有内存的值，否则FreeDocument时泄漏
+*******************************************************************************/
+void MoveValue(CJSONValue *dst, CJSONValue *src)
+{
+    CJSONValue tmp;
+    assert(dst != NULL && src != NULL && dst != src);
+    assert(!(dst->flags & VALUE_FLAG_DOCUMENT) || !OWNS_MEMORY(src));
+    //先取走src再释放dst，src在dst的子树中时不会被一起释放
+    tmp = *src;
+    src->type = TYPE_NULL;
+    src->flags &= VALUE_FLAG_DOCUMENT;
+    FreeValue(dst);
+    if(!DOCUMENT_MEMORY(&tmp))
+        tmp.flags = (tmp.flags & ~VALUE_FLAG_DOCUMENT) | (dst->flags & VALUE_FLAG_DOCUMENT);
+    *dst = tmp;
+}
+
+/*******************************************************************************
+* Function   : SwapValue
+* Description: 交换两个节点的值，O(1)
+* Input      :
+    * a, b, 两个节点
+* Output     :
+* Return     : 
+* Others     : 
+    * a、b不能一个在另一个的子树中
+    * 一个是文档中的节点时，另一个不能持有从分配器申请的内存，同MoveValue
+    * 不持有内存的值交换后，VALUE_FLAG_DOCUMENT留在原来的位置上，同MoveValue
+*******************************************************************************/
+void SwapValue(CJSONValue *a, CJSONValue *b)
+{
+    CJSONValue tmp;
+    unsigned int adoc, bdoc;
+    assert(a != NULL && b != NULL);
+    assert(!(a->flags & VALUE_FLAG_DOCUMENT) || !OWNS_MEMORY(b));
+    assert(!(b->flags & VALUE_FLAG_DOCUMENT) || !OWNS_MEMORY(a));
+    if(a == b)
+        return;
+    adoc = a->flags & VALUE_FLAG_DOCUMENT;
+    bdoc = b->flags & VALUE_FLAG_DOCUMENT;
+    tmp = *a;
+    *a = *b;
+    *b = tmp;
+    if(!DOCUMENT_MEMORY(a))
+        a->flags = (a->flags & ~VALUE_FLAG_DOCUMENT) | adoc;
+    if(!DOCUMENT_MEMORY(b))
+        b->flags = (b->flags & ~VALUE_FLAG_DOCUMENT) | bdoc;
+}
+
+/*******************************************************************************
+* Function   : CopyValue
+* Description: 深拷贝src到dst
+    * 不经过生成、解析：每一层先整体复制元素数组，再逐个替换其中的字符串、数组和对象
+    * 每个数组、对象、字符串只申请一次恰好大小的内存，不会反复扩展
+* Input      :
+    * dst, 目标节点，原来的值先被释放
+    * src, 源节点
+* Output     :
+* Return     : 
+* Others     : 
+    * 副本从默认分配器申请，和src是否在文档中、是否原位解析无关，可以用修改节点树的函数修改
+    * dst不能是文档中的节点，这时用CopyValueInDocument
+    * src在dst的子树中也可以
+    * src中还没有展开的子树在副本中展开，展开的结果暂存在src的文档中
+    * 对象的哈希索引不复制，查找时重建
+*******************************************************************************/
+void CopyValue(CJSONValue *dst, const CJSONValue *src)
+{
+    CJSONValue tmp;
+    assert(dst != NULL && src != NULL);
+    CopyTree(&tmp, src, NULL, NULL);
+    MoveValue(dst, &tmp);
+}
+
+/*******************************************************************************
+* Function   : CopyValueInDocument
+* Description: 把src深拷贝到文档中，用于把子树从一个文档移植到另一个文档
+    * 先遍历一遍算出副本需要的总字节数，只从文档中申请一次，再在这块内存中依次切分
+* Input      :
+    * doc, 副本所在的文档
+    * dst, 目标节点，原来的值先被释放
+    * src, 源节点
+* Output     :
+* Return     : 
+* Others     : 
+    * 副本带有VALUE_FLAG_DOCUMENT，随doc一起释放，不能用修改节点树的函数修改
+    * 大对象同时建立哈希索引，和ParseInDocument一样
+    * 计算大小时src中按需解析的子树会先展开
+    * src在dst的子树中也可以
+*******************************************************************************/
+void CopyValueInDocument(CJSONDocument *doc, CJSONValue *dst, const CJSONValue *src)
+{
+    CJSONValue tmp;
+    char *block;
+    assert(doc != NULL && dst != NULL && src != NULL);
+    block = (char *)DocumentAlloc(doc, CopySize(src));
+    CopyTree(&tmp, src, doc, block);
+    MoveValue(dst, &tmp);
+}
+
+/*******************************************************************************
+* Function   : FreeValue
+* Description: 释放以v为根节点的树的内存
+* Input      :
+    * v, Json的节点
+* Output     : 
+* Return     : 
+* Others     : 
+*******************************************************************************/
+void FreeValue(CJSONValue *v)
+{
+    FreeValueWithAllocator(v, &defaultAllocator);
+}
+
+/*******************************************************************************
+* Function   : FreeValueWithAllocator
+* Description: 释放以v为根节点的树的内存，内存交还给allocator
+    * 先释放子节点再释放数组、对象本身，用显式栈代替递归，很深的树也不会耗尽C的调用栈
+* Input      :
+    * v, Json的节点
+    * allocator, 解析或构造该树时使用的分配器
+* Output     : 
+* Return     : 
+* Others     : 
+    * 文档中的节点保留VALUE_FLAG_DOCUMENT，之后仍然不能用SetString等放入从分配器申请的内存
+*******************************************************************************/
+void FreeValueWithAllocator(CJSONValue *v, const CJSONAllocator *allocator)
+{
+    CJSONWalk w;
+    CJSONWalkFrame *f;
+    CJSONMember *m;
+    assert(v != NULL && allocator != NULL);
+    WalkInit(&w, allocator);
+    for(;;){
+        //文档中的节点由文档统一释放
+        if(!(v->type >= TYPE_STRING && (v->flags & VALUE_FLAG_DOCUMENT))){
+            switch(v->type){
+                case TYPE_STRING:
+                    if(!(v->flags & (VALUE_FLAG_BORROWED | VALUE_FLAG_SHORT)))
+                        FREE(allocator, v->u.s.s);
+                    break;
+                case TYPE_ARRAY:
+                    if(v->u.a.size > 0){
+                        WalkPush(&w, v);
+                        v = &v->u.a.e[0];
+                        continue;
+                    }
+                    FREE(allocator, v->u.a.e);
+                    break;
+                case TYPE_OBJECT:
+                    if(v->u.o.size > 0){
+                        WalkPush(&w, v);
+                        m = &v->u.o.m[0];
+                        if(KEY_TAG(m) == KEY_TAG_OWNED)
+                            FREE(allocator, m->key.p.k);
+                        v = &m->v;
+                        continue;
+                    }
+                    FREE(allocator, v->u.o.m);
+                    if(v->u.o.index != NULL)
+                        FREE(&v->u.o.index->allocator, v->u.o.index);
+                    break;
+                default:
+                    break;
+            }
+        }
+        //避免重复释放；文档中的节点释放后仍然在文档中
+        v->type = TYPE_NULL;
+        v->flags &= VALUE_FLAG_DOCUMENT;
+        //回到所在的数组、对象，子节点都释放完后再释放它自己
+        for(;;){
+            if(w.depth == 0){
+                WalkFree(&w);
+                return;
+            }
+            f = &w.frames[w.depth - 1];
+            f->i++;
+            v = f->v;
+            if(v->type == TYPE_ARRAY){
+                if(f->i < v->u.a.size){
+                    v = &v->u.a.e[f->i];
+                    break;
+                }
+                FREE(allocator, v->u.a.e);
+            }
+            else{
+                if(f->i < v->u.o.size){
+                    m = &v->u.o.m[f->i];
+                    if(KEY_TAG(m) == KEY_TAG_OWNED)
+                        FREE(allocator, m->key.p.k);
+                    v = &m->v;
+                    break;
+                }
+                FREE(allocator, v->u.o.m);
+                if(v->u.o.index != NULL)
+                    FREE(&v->u.o.index->allocator, v->u.o.index);
+            }
+            v->type = TYPE_NULL;
+            v->flags &= VALUE_FLAG_DOCUMENT;
+            w.depth--;
+        }
+    }
+}
+
+/*******************************************************************************
+* Function   : InitTape
+* Description: 初始化一个空磁带，第一次解析时才申请内存
+* Input      :
+    * tape, 磁带
+* Output     :
+* Return     : 
+* Others     : 磁带记录下当前的默认分配器，之后SetAllocator不影响该磁带
+*******************************************************************************/
+void InitTape(CJSONTape *tape)
+{
+    InitTapeWithAllocator(tape, &defaultAllocator);
+}
+
+/*******************************************************************************
+* Function   : InitTapeWithAllocator
+* Description: 初始化一个空磁带，磁带和字符串区从allocator申请
+* Input      :
+    * tape, 磁带
+    * allocator, 分配器，磁带中保存一份拷贝
+* Output     :
+* Return     : 
+* Others     : 
+*******************************************************************************/
+void InitTapeWithAllocator(CJSONTape *tape, const CJSONAllocator *allocator)
+{
+    assert(NULL != tape && NULL != allocator);
+    tape->words = NULL;
+    tape->size = tape->capacity = 0;
+    tape->strings = NULL;
+    tape->slen = tape->scapacity = 0;
+    tape->open = 0;
+    tape->allocator = *allocator;
+}
+
+/*******************************************************************************
+* Function   : FreeTape
+* Description: 释放磁带和字符串区
+* Input      :
+    * tape, 磁带
+* Output     :
+* Return     : 
+* Others     : 释放后可以直接用于下一次ParseTape
+*******************************************************************************/
+void FreeTape(CJSONTape *tape)
+{
+    assert(NULL != tape);
+    FREE(&tape->allocator, tape->words);
+    FREE(&tape->allocator, tape->strings);
+    tape->words = NULL;
+    tape->size = tape->capacity = 0;
+    tape->strings = NULL;
+    tape->slen = tape->scapacity = 0;
+}
+
+/*******************************************************************************
+* Function   : ParseTape
+* Description: 把JSON解析为磁带
+    * 整个文档只有磁带和字符串区两块连续的内存，遍历时顺序访问，不需要追指针
+    * 磁带的内存在多次解析之间复用，同一个磁带反复解析时不再申请内存
+* Input      :
+    * tape, 磁带
+    * json, 一个待解析的Json格式字符串
+* Output     :
+    * tape, 解析结果，根节点的下标是0
+* Return     : 同Parse
+* Others     : 
+    * 解析失败时磁带为空
+    * 磁带是只读的，需要修改时使用Parse得到的节点树
+*******************************************************************************/
+int ParseTape(CJSONTape *tape, const char *json)
+{
+    CJSONContext c;
+    CJSONHandler handler = tapeHandler;
+    int ret;
+    assert(NULL != tape && NULL != json);
+    tape->size = tape->slen = tape->open = 0;
+    handler.user = tape;
+    c.json = json;
+    c.end = json + strlen(json);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = &tape->allocator;
+    c.doc = NULL;
+    c.vflags = 0;
+    c.pflags = 0;
+    c.handler = &handler;
+    if((ret = ParseText(&c)) != PARSE_OK)
+        tape->size = tape->slen = 0;
+    assert(c.top == 0);
+    FREE(c.allocator, c.stack);
+    return ret;
+}
+
+/*******************************************************************************
+* Function   : GetTapeType
+* Description: 获取磁带中下标为i的值的类型
+* Input      :
+    * tape, 磁带
+    * i, 值的下标
+* Output     :
+* Return     : 值的类型
+* Others     : 
+*******************************************************************************/
+CJSONType GetTapeType(const CJSONTape *tape, size_t i)
+{
+    assert(NULL != tape && i < tape->size);
+    switch(TAPE_TAG(tape->words[i])){
+        case 'n' : return TYPE_NULL;
+        case 'f' : return TYPE_FALSE;
+        case 't' : return TYPE_TRUE;
+        case 'd' : return TYPE_NUMBER;
+        case '\"': return TYPE_STRING;
+        case '[' : return TYPE_ARRAY;
+        default  : assert(TAPE_TAG(tape->words[i]) == '{'); return TYPE_OBJECT;
+    }
+}
+
+/*******************************************************************************
+* Function   : GetTapeBoolean
+* Description: 获取磁带中布尔值的值
+* Input      :
+    * tape, 磁带
+    * i, 值的下标
+* Output     :
+* Return     : true返回1，false返回0
+* Others     : 
+*******************************************************************************/
+int GetTapeBoolean(const CJSONTape *tape, size_t i)
+{
+    assert(NULL != tape && i < tape->size);
+    assert(TAPE_TAG(tape->words[i]) == 't' || TAPE_TAG(tape->words[i]) == 'f');
+    return TAPE_TAG(tape->words[i]) == 't';
+}
+
+/*******************************************************************************
+* Function   : GetTapeNumber
+* Description: 获取磁带中数值的值
+* Input      :
+    * tape, 磁带
+    * i, 值的下标
+* Output     :
+* Return     : 数值
+* Others     : 
+*******************************************************************************/
+double GetTapeNumber(const CJSONTape *tape, size_t i)
+{
+    double n;
+    assert(NULL != tape && i + 1 < tape->size && TAPE_TAG(tape->words[i]) == 'd');
+    memcpy(&n, &tape->words[i + 1], sizeof(n));
+    return n;
+}
+
+/*******************************************************************************
+* Function   : GetTapeString
+* Description: 获取磁带中字符串的内容
+* Input      :
+    * tape, 磁带
+    * i, 值的下标
+* Output     :
+* Return     : 字符串区中的字符串，以'\0'结尾，磁带再次解析或释放后失效
+* Others     : 
+*******************************************************************************/
+const char *GetTapeString(const CJSONTape *tape, size_t i)
+{
+    assert(NULL != tape && i + 1 < tape->size && TAPE_TAG(tape->words[i]) == '\"');
+    return tape->strings + TAPE_PAYLOAD(tape->words[i]);
+}
+
+/*******************************************************************************
+* Function   : GetTapeStringLength
+* Description: 获取磁带中字符串的长度
+* Input      :
+    * tape, 磁带
+    * i, 值的下标
+* Output     :
+* Return     : 字符串长度
+* Others     : 
+*******************************************************************************/
+size_t GetTapeStringLength(const CJSONTape *tape, size_t i)
+{
+    assert(NULL != tape && i + 1 < tape->size && TAPE_TAG(tape->words[i]) == '\"');
+    return (size_t)tape->words[i + 1];
+}
+
+/*******************************************************************************
+* Function   : GetTapeArraySize
+* Description: 获取磁带中数组的元素个数
+* Input      :
+    * tape, 磁带
+    * i, 数组的下标
+* Output     :
+* Return     : 元素个数
+* Others     : 开始字记录了结束字的位置，结束字记录了元素个数，O(1)
+*******************************************************************************/
+size_t GetTapeArraySize(const CJSONTape *tape, size_t i)
+{
+    assert(NULL != tape && i < tape->size && TAPE_TAG(tape->words[i]) == '[');
+    return TAPE_PAYLOAD(tape->words[TAPE_PAYLOAD(tape->words[i]) - 1]);
+}
+
+/*******************************************************************************
+* Function   : GetTapeArrayElement
+* Description: 获取磁带中数组的第index个元素
+* Input      :
+    * tape, 磁带
+    * i, 数组的下标
+    * index, 元素的顺序
+* Output     :
+* Return     : 元素的下标
+* Others     : 
+    * 前面的每个元素都是O(1)跳过，总的代价是O(index)
+    * 顺序遍历所有元素时用GetTapeNext从i+1开始逐个前进
+*******************************************************************************/
+size_t GetTapeArrayElement(const CJSONTape *tape, size_t i, size_t index)
+{
+    size_t e;
+    assert(index < GetTapeArraySize(tape, i));
+    for(e = i + 1; index > 0; index--)
+        e = GetTapeNext(tape, e);
+    return e;
+}
+
+/*******************************************************************************
+* Function   : GetTapeObjectSize
+* Description: 获取磁带中对象的成员个数
+* Input      :
+    * tape, 磁带
+    * i, 对象的下标
+* Output     :
+* Return     : 成员个数
+* Others     : 
+*******************************************************************************/
+size_t GetTapeObjectSize(const CJSONTape *tape, size_t i)
+{
+    assert(NULL != tape && i < tape->size && TAPE_TAG(tape->words[i]) == '{');
+    return TAPE_PAYLOAD(tape->words[TAPE_PAYLOAD(tape->words[i]) - 1]);
+}
+
+/*******************************************************************************
+* Function   : GetTapeObjectKey
+* Description: 获取磁带中对象的第index个成员的键
+* Input      :
+    * tape, 磁带
+    * i, 对象的下标
+    * index, 成员的顺序
+* Output     :
+* Return     : 键，以'\0'结尾
+* Others     : 同GetTapeArrayElement，代价是O(index)
+*******************************************************************************/
+const char *GetTapeObjectKey(const CJSONTape *tape, size_t i, size_t index)
+{
+    return GetTapeString(tape, GetTapeObjectValue(tape, i, index) - 2);
+}
+
+/*******************************************************************************
+* Function   : GetTapeObjectKeyLength
+* Description: 获取磁带中对象的第index个成员的键长度
+* Input      :
+    * tape, 磁带
+    * i, 对象的下标
+    * index, 成员的顺序
+* Output     :
+* Return     : 键长度
+* Others     : 同GetTapeArrayElement，代价是O(index)
+*******************************************************************************/
+size_t GetTapeObjectKeyLength(const CJSONTape *tape, size_t i, size_t index)
+{
+    return GetTapeStringLength(tape, GetTapeObjectValue(tape, i, index) - 2);
+}
+
+/*******************************************************************************
+* Function   : GetTapeObjectValue
+* Description: 获取磁带中对象的第index个成员的值
+* Input      :
+    * tape, 磁带
+    * i, 对象的下标
+    * index, 成员的顺序
+* Output     :
+* Return     : 值的下标，键在它之前的2个字
+* Others     : 同GetTapeArrayElement，代价是O(index)
+*******************************************************************************/
+size_t GetTapeObjectValue(const CJSONTape *tape, size_t i, size_t index)
+{
+    size_t e;
+    assert(index < GetTapeObjectSize(tape, i));
+    //每个成员是2个字的键加上值
+    for(e = i + 3; index > 0; index--)
+        e = GetTapeNext(tape, e) + 2;
+    return e;
+}
+
+/*******************************************************************************
+* Function   : FindTapeObjectValue
+* Description: 在磁带中的对象中按键查找值
+* Input      :
+    * tape, 磁带
+    * i, 对象的下标
+    * key, 键
+    * klen, 键长度
+* Output     :
+* Return     : 值的下标，有重复键时返回第一个，找不到返回KEY_NOT_EXIST
+* Others     : 顺序比较，键都在字符串区中，跳过值是O(1)
+*******************************************************************************/
+size_t FindTapeObjectValue(const CJSONTape *tape, size_t i, const char *key, size_t klen)
+{
+    size_t e, end;
+    assert(NULL != tape && i < tape->size && TAPE_TAG(tape->words[i]) == '{');
+    assert(NULL != key || klen == 0);
+    end = TAPE_PAYLOAD(tape->words[i]) - 1;
+    for(e = i + 1; e < end; e = GetTapeNext(tape, e + 2))
+        if((size_t)tape->words[e + 1] == klen && memcmp(tape->strings + TAPE_PAYLOAD(tape->words[e]), key, klen) == 0)
+            return e + 2;
+    return KEY_NOT_EXIST;
+}
+
+/*******************************************************************************
+* Function   : GetTapeNext
+* Description: 获取磁带中紧跟在值i之后的下标
+    * 数组、对象直接跳到结束字之后，整个子树O(1)跳过
+    * i是数组的元素时得到下一个元素，是对象的值时得到下一个成员的键
+* Input      :
+    * tape, 磁带
+    * i, 值的下标
+* Output     :
+* Return     : 下一个值的下标，i是最后一个元素时得到所在数组或对象的结束字
+* Others     : 
+*******************************************************************************/
+size_t GetTapeNext(const CJSONTape *tape, size_t i)
+{
+    unsigned long long w;
+    assert(NULL != tape && i < tape->size);
+    w = tape->words[i];
+    switch(TAPE_TAG(w)){
+        case '[' :
+        case '{' : return TAPE_PAYLOAD(w);
+        case 'd' :
+        case '\"': return i + 2;
+        default  : return i + 1;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseRoot
+* Description: Parse和ParseInDocument的公共部分，c需要由调用方初始化
+    * 语法分析产生的事件交给DOM处理函数，处理函数把节点压入c的栈中
+    * 数组、对象结束时从栈上弹出元素组装成节点再压回去，最后栈上只剩根节点
+* Input      :
+    * c, Json内容
+* Output     :
+    * v, Json节点
+* Return     : 同Parse
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int ParseRoot(CJSONContext *c, CJSONValue *v)
+{
+    CJSONHandler dom = domHandler;
+    int ret;
+    dom.user = c;
+    c->handler = &dom;
+    INIT_VALUE_NULL(v);
+    ret = ParseText(c);
+    if(ret == PARSE_OK || ret == PARSE_ROOT_NOT_SINGULAR)
+        memcpy(v, ContextPop(c, sizeof(CJSONValue)), sizeof(CJSONValue));
+    else{
+        //出错时栈上是还没组装完的节点(对象的键也以字符串节点的形式存放)，全部释放
+        while(c->top > 0)
+            FreeValueWithAllocator((CJSONValue *)ContextPop(c, sizeof(CJSONValue)), c->allocator);
+    }
+    //加断言，保证所有数据都被弹出
+    assert(c->top == 0);
+    FREE(c->allocator, c->stack);
+    return ret;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : LazyScan
+* Description: 按需解析的结构扫描，按出现顺序给数组、对象编号，记录对应的结束位置
+    * 每次用ScanBlock处理64字节，只逐个处理字符串之外的括号
+    * 数值、literal、逗号、冒号都留给展开时检查
+* Input      :
+    * c, Json内容，栈用来存放还没有结束的数组、对象的序号
+* Output     :
+    * entries, 结构索引，从c->allocator申请，调用方释放
+    * count, 数组、对象的个数
+* Return     : 
+    * PARSE_OK, 括号都匹配
+    * PARSE_MISS_QUOTATION_MARK, 字符串没有结束
+    * PARSE_MISS_COMMA_OR_SQUARE_BRACKET/PARSE_MISS_COMMA_OR_CURLY_BRACKET, 数组、对象没有正确结束
+* Others     : 
+    * 所有数组、对象之外多出来的']'、'}'忽略，由ParseText报告PARSE_ROOT_NOT_SINGULAR或PARSE_INVALID_VALUE
+    * 字符串之外的'\\'不合法，这里同样当作转义处理，展开时一定会在它之前或它那里报错
+-----------------------------------------------------------------------------*/
+static int LazyScan(CJSONContext *c, CJSONLazyEntry **entries, size_t *count)
+{
+    const char *json = c->json, *p = c->json, *end = c->end, *block;
+    char tail[64];
+    CJSONLazyEntry *e = NULL;
+    size_t n = 0, capacity = 0, k;
+    CJSONScanState st = { 0, 0 };
+    uint64_t bits, comma;
+    unsigned int i;
+    int ret = PARSE_OK;
+    for(; p < end; p += 64){
+        block = p;
+        if(end - p < 64){
+            //最后不足64字节的部分补上空白
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, end - p);
+            block = tail;
+        }
+        for(bits = ScanBlock(block, &st, &comma); bits != 0; bits &= bits - 1){
+            char ch;
+            i = CTZ64(bits);
+            ch = block[i];
+            if(ch == '[' || ch == '{'){
+                if(c->top >= PARSE_MAX_DEPTH * sizeof(size_t)){
+                    ret = PARSE_DEPTH_EXCEEDED;
+                    goto out;
+                }
+                if(n == capacity){
+                    capacity = (capacity == 0) ? 64 : capacity + (capacity >> 1);
+                    e = (CJSONLazyEntry *)REALLOC(c->allocator, e, capacity * sizeof(CJSONLazyEntry));
+                }
+                //结束之前close暂时记录开始的位置
+                e[n].close = (size_t)(p - json) + i;
+                *(size_t *)ContextPush(c, sizeof(size_t)) = n++;
+            }
+            else if(c->top > 0){
+                k = *(size_t *)ContextPop(c, sizeof(size_t));
+                if(json[e[k].close] != ch - 2){
+                    ret = (json[e[k].close] == '[') ? PARSE_MISS_COMMA_OR_SQUARE_BRACKET : PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                    goto out;
+                }
+                e[k].close = (size_t)(p - json) + i;
+                e[k].next = n;
+            }
+        }
+    }
+    if(st.instring)
+        ret = PARSE_MISS_QUOTATION_MARK;
+    else if(c->top > 0){
+        k = *(size_t *)ContextPop(c, sizeof(size_t));
+        ret = (json[e[k].close] == '[') ? PARSE_MISS_COMMA_OR_SQUARE_BRACKET : PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    }
+out:
+    c->top = 0;
+    *entries = e;
+    *count = n;
+    return ret;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ScanBlock
+* Description: 结构扫描的一个64字节块，找出字符串之外的括号和逗号
+    * 被'\\'转义的字符不是真正的引号，'\\'很少出现，逐个处理
+    * 真正的引号位图做前缀异或之后，开始引号到结束引号之前的位都是1，就是字符串内部
+    * 跨块时带上上一块结尾的转义和字符串状态
+* Input      :
+    * p, 64字节
+    * st, 上一块结束时的状态
+* Output     :
+    * st, 这一块结束时的状态
+    * comma, 字符串之外的','的位图
+* Return     : 字符串之外的'['、']'、'{'、'}'的位图，第i位对应p[i]
+* Others     : 
+-----------------------------------------------------------------------------*/
+static uint64_t ScanBlock(const char *p, CJSONScanState *st, uint64_t *comma)
+{
+    uint64_t quote, slash, bits, escaped = st->escaped;
+    unsigned int i;
+    bits = StructuralMasks(p, &quote, &slash, comma);
+    st->escaped = 0;
+    slash &= ~escaped;
+    while(slash != 0){
+        i = CTZ64(slash);
+        if(i == 63)
+            st->escaped = 1;
+        else{
+            escaped |= (uint64_t)1 << (i + 1);
+            slash &= ~((uint64_t)1 << (i + 1));
+        }
+        slash &= slash - 1;
+    }
+    quote &= ~escaped;
+    quote ^= quote << 1;
+    quote ^= quote << 2;
+    quote ^= quote << 4;
+    quote ^= quote << 8;
+    quote ^= quote << 16;
+    quote ^= quote << 32;
+    quote ^= st->instring;
+    st->instring = (quote >> 63) ? ~(uint64_t)0 : 0;
+    *comma &= ~quote;
+    return bits & ~quote;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : StructuralMasks
+* Description: 得到64字节中引号、'\\'、逗号、括号的位图，第i位对应p[i]
+* Input      :
+    * p, 64字节
+* Output     :
+    * quote, '"'的位图
+    * slash, '\\'的位图
+    * comma, ','的位图
+* Return     : '['、']'、'{'、'}'的位图
+* Others     : '['、'{'和0x20按位或之后都是'{'，']'、'}'都是'}'
+-----------------------------------------------------------------------------*/
+#if defined(CJSON_SIMD_AVX2)
+static uint64_t StructuralMasks(const char *p, uint64_t *quote, uint64_t *slash, uint64_t *comma)
+{
+    const __m256i q = _mm256_set1_epi8('\"'), s = _mm256_set1_epi8('\\'), d = _mm256_set1_epi8(',');
+    const __m256i lower = _mm256_set1_epi8(0x20), open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}');
+    uint64_t qm = 0, sm = 0, dm = 0, bm = 0;
+    int i;
+    for(i = 0; i < 64; i += 32){
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i y = _mm256_or_si256(x, lower);
+        qm |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, q)) << i;
+        sm |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, s)) << i;
+        dm |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, d)) << i;
+        bm |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(y, open), _mm256_cmpeq_epi8(y, close))) << i;
+    }
+    *quote = qm;
+    *slash = sm;
+    *comma = dm;
+    return bm;
+}
+#elif defined(CJSON_SIMD_SSE2)
+static uint64_t StructuralMasks(const char *p, uint64_t *quote, uint64_t *slash, uint64_t *comma)
+{
+    const __m128i q = _mm_set1_epi8('\"'), s = _mm_set1_epi8('\\'), d = _mm_set1_epi8(',');
+    const __m128i lower = _mm_set1_epi8(0x20), open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}');
+    uint64_t qm = 0, sm = 0, dm = 0, bm = 0;
+    int i;
+    for(i = 0; i < 64; i += 16){
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i y = _mm_or_si128(x, lower);
+        qm |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, q)) << i;
+        sm |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, s)) << i;
+        dm |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, d)) << i;
+        bm |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(y, open), _mm_cmpeq_epi8(y, close))) << i;
+    }
+    *quote = qm;
+    *slash = sm;
+    *comma = dm;
+    return bm;
+}
+#else
+static uint64_t StructuralMasks(const char *p, uint64_t *quote, uint64_t *slash, uint64_t *comma)
+{
+    uint64_t qm = 0, sm = 0, dm = 0, bm = 0;
+    int i;
+    for(i = 0; i < 64; i++){
+        char y = p[i] | 0x20;
+        qm |= (uint64_t)(p[i] == '\"') << i;
+        sm |= (uint64_t)(p[i] == '\\') << i;
+        dm |= (uint64_t)(p[i] == ',') << i;
+        bm |= (uint64_t)(y == '{' || y == '}') << i;
+    }
+    *quote = qm;
+    *slash = sm;
+    *comma = dm;
+    return bm;
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseDeferred
+* Description: 按需解析时遇到数组、对象，只压入一个未展开的节点，直接跳到它的结束位置之后
+* Input      :
+    * c, Json内容，c->json指向'['或'{'
+* Output     :
+* Return     : PARSE_OK
+* Others     : 结构扫描保证了c->ordinal就是这个数组、对象的序号
+-----------------------------------------------------------------------------*/
+static int ParseDeferred(CJSONContext *c)
+{
+    const CJSONLazyEntry *e = &c->lazy->entries[c->ordinal];
+    CJSONValue *v = (CJSONValue *)ContextPush(c, sizeof(CJSONValue));
+    assert(c->lazy->json + e->close < c->end && c->lazy->json[e->close] == *c->json + 2);
+    v->type = (*c->json == '[') ? TYPE_ARRAY : TYPE_OBJECT;
+    v->flags = c->vflags | VALUE_FLAG_LAZY;
+    v->u.l.lazy = c->lazy;
+    v->u.l.json = c->json;
+    v->u.l.index = c->ordinal;
+    c->json = c->lazy->json + e->close + 1;
+    c->ordinal = e->next;
+    return PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : LazyMaterialize
+* Description: 展开一个按需解析的数组、对象，只解析这一层，嵌套的数组、对象仍然延后
+* Input      :
+    * v, 未展开的节点
+* Output     :
+    * v, 展开后的数组、对象，出错时为空的数组、对象，错误码记在标志中，见VALUE_ERROR
+* Return     : 同Parse
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int LazyMaterialize(CJSONValue *v)
+{
+    CJSONLazy *lazy = v->u.l.lazy;
+    CJSONHandler dom = domHandler;
+    CJSONContext c;
+    int ret;
+    dom.user = &c;
+    c.json = v->u.l.json;
+    c.end = lazy->json + lazy->entries[v->u.l.index].close + 1;
+    //每次展开的子树通常都很小，复用文档的解析栈，避免反复申请和扩展
+    c.stack = lazy->doc->stack;
+    c.size = lazy->doc->ssize;
+    c.top = 0;
+    c.allocator = &lazy->doc->allocator;
+    c.doc = lazy->doc;
+    c.vflags = VALUE_FLAG_DOCUMENT;
+    c.pflags = PARSE_FLAG_LAZY | PARSE_FLAG_EXPAND;
+    c.handler = &dom;
+    c.lazy = lazy;
+    c.ordinal = v->u.l.index + 1;
+    ret = ParseValue(&c, 0);
+    if(ret == PARSE_OK){
+        assert(c.json == c.end);
+        memcpy(v, ContextPop(&c, sizeof(CJSONValue)), sizeof(CJSONValue));
+    }
+    else{
+        //栈上的节点都在文档中，不需要逐个释放
+        c.top = 0;
+        v->flags = VALUE_FLAG_DOCUMENT | ((unsigned int)ret << VALUE_ERROR_SHIFT);
+        if(v->type == TYPE_ARRAY){
+            v->u.a.e = NULL;
+            v->u.a.size = v->u.a.capacity = 0;
+        }
+        else{
+            v->u.o.m = NULL;
+            v->u.o.size = v->u.o.capacity = 0;
+            v->u.o.index = NULL;
+        }
+    }
+    assert(c.top == 0);
+    lazy->doc->stack = c.stack;
+    lazy->doc->ssize = c.size;
+    return ret;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParallelSplit
+* Description: 并行解析的结构扫描，在根数组第一层元素之间的','处切分
+    * 用ScanBlock得到字符串之外的括号和逗号，只需要统计嵌套深度
+    * 第k个切分点是第k/parts处之后的第一个第一层','
+* Input      :
+    * json, 指向根数组的'['
+    * end, 输入的结尾
+    * parts, 最多切成的段数
+* Output     :
+    * cuts, 每一段的结尾：前面是切分处的','，最后一段是根数组的']'
+* Return     : 段数，根数组没有以']'结束时返回0
+* Others     : 第一层之内不检查括号是否匹配，各段解析时会发现语法错误
+-----------------------------------------------------------------------------*/
+static size_t ParallelSplit(const char *json, const char *end, const char **cuts, size_t parts)
+{
+    const char *p, *block, *target;
+    char tail[64];
+    CJSONScanState st = { 0, 0 };
+    uint64_t bits, comma;
+    size_t depth = 0, n = 0, len = (size_t)(end - json);
+    unsigned int i;
+    target = json + len / parts;
+    for(p = json; p < end; p += 64){
+        block = p;
+        if(end - p < 64){
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, end - p);
+            block = tail;
+        }
+        bits = ScanBlock(block, &st, &comma);
+        //还没有到下一个切分点时不需要看逗号
+        if(p + 64 <= target)
+            comma = 0;
+        for(bits |= comma; bits != 0; bits &= bits - 1){
+            char ch;
+            i = CTZ64(bits);
+            ch = block[i];
+            if(ch == ','){
+                if(depth == 1 && p + i >= target){
+                    cuts[n++] = p + i;
+                    target = (n + 1 < parts) ? json + len / parts * (n + 1) : end;
+                }
+            }
+            else if(ch == '[' || ch == '{')
+                depth++;
+            else if(--depth == 0){
+                //根数组必须以']'结束，各段只检查自己的内容
+                if(ch != ']')
+                    return 0;
+                cuts[n++] = p + i;
+                return n;
+            }
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseSlice
+* Description: 解析并行解析中的一段：用','分隔的若干个值，元素留在栈上
+* Input      :
+    * s, 一段输入
+* Output     :
+    * s, s->size为元素个数
+* Return     : 同Parse，段中不是合法的元素序列时返回PARSE_MISS_COMMA_OR_SQUARE_BRACKET等
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int ParseSlice(CJSONParallelSlice *s)
+{
+    CJSONContext *c = &s->c;
+    int ret;
+    ParseWhiteSpace(c);
+    for(;;){
+        if((ret = ParseValue(c, 1)) != PARSE_OK)
+            return ret;
+        s->size++;
+        ParseWhiteSpace(c);
+        if(c->json == c->end)
+            return PARSE_OK;
+        if(*c->json != ',')
+            return PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        c->json++;
+        ParseWhiteSpace(c);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : LinesParseBatch
+* Description: 解析NDJSON的一批输入，每个非空行的结果追加到w->results
+    * 每行用ScanNewline找到结尾，以[行首, '\n')为输入解析一个JSON文本
+    * 节点分配在w->doc中，解析栈在各行、各批之间复用
+* Input      :
+    * w, 工作者
+    * batch, 批序号
+* Output     :
+    * w, results/count为各行的结果，lines为这一批的行数
+* Return     : 
+* Others     : JSON字符串中不能出现未转义的'\n'，所以每个'\n'都是行的边界
+-----------------------------------------------------------------------------*/
+static void LinesParseBatch(CJSONLineWorker *w, size_t batch)
+{
+    const char *p = w->pool->json + w->pool->cuts[batch];
+    const char *end = w->pool->json + w->pool->cuts[batch + 1];
+    const char *eol;
+    CJSONContext *c = &w->c;
+    CJSONLineResult *r;
+    ClearDocument(&w->doc);
+    w->count = w->lines = 0;
+    for(; p < end; w->lines++){
+        eol = ScanNewline(p, end);
+        c->json = p;
+        c->end = eol;
+        //最后一行可能没有'\n'，这时eol就是end，不能再越过它
+        p = (eol < end) ? eol + 1 : end;
+        //只有空白的行不产生结果
+        ParseWhiteSpace(c);
+        if(c->json == eol)
+            continue;
+        if(w->count == w->capacity){
+            w->capacity = (w->capacity == 0) ? 64 : w->capacity + (w->capacity >> 1);
+            w->results = (CJSONLineResult *)REALLOC(&w->doc.allocator, w->results, w->capacity * sizeof(CJSONLineResult));
+        }
+        r = &w->results[w->count++];
+        r->line = w->lines;
+        INIT_VALUE_NULL(&r->v);
+        r->ret = ParseText(c);
+        if(r->ret == PARSE_OK)
+            memcpy(&r->v, ContextPop(c, sizeof(CJSONValue)), sizeof(CJSONValue));
+        else
+            c->top = 0;     //栈上未完成的节点都在文档中，不需要逐个释放
+    }
+}
+
+#if !defined(CJSON_NO_THREADS)
+/*-----------------------------------------------------------------------------
+* Function   : ParallelWorker
+* Description: 并行解析的线程入口
+-----------------------------------------------------------------------------*/
+THREAD_FUNC(ParallelWorker)
+{
+    CJSONParallelSlice *s = (CJSONParallelSlice *)arg;
+    s->ret = ParseSlice(s);
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : LinesWorker
+* Description: NDJSON批量解析的工作线程入口
+    * 依次解析自己负责的各批，每解析完一批就等待调用线程交付后再解析下一批
+    * 调用线程设置stop后退出
+-----------------------------------------------------------------------------*/
+THREAD_FUNC(LinesWorker)
+{
+    CJSONLineWorker *w = (CJSONLineWorker *)arg;
+    CJSONLinePool *pool = w->pool;
+    size_t batch;
+    int stop;
+    for(batch = w->index; batch < pool->batches; batch += pool->size){
+        MUTEX_LOCK(&pool->lock);
+        while(w->ready && !pool->stop)
+            COND_WAIT(&pool->cond, &pool->lock);
+        stop = pool->stop;
+        MUTEX_UNLOCK(&pool->lock);
+        if(stop)
+            break;
+        LinesParseBatch(w, batch);
+        MUTEX_LOCK(&pool->lock);
+        w->ready = 1;
+        COND_BROADCAST(&pool->cond);
+        MUTEX_UNLOCK(&pool->lock);
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ThreadCreate/ThreadJoin
+* Description: 创建执行func(arg)的线程、等待它结束
+* Return     : ThreadCreate成功返回1，失败返回0
+-----------------------------------------------------------------------------*/
+static int ThreadCreate(CJSONThread *thread, CJSONThreadFunc func, void *arg)
+{
+#if defined(_WIN32)
+    *thread = (HANDLE)_beginthreadex(NULL, 0, func, arg, 0, NULL);
+    return *thread != 0;
+#else
+    return pthread_create(thread, NULL, func, arg) == 0;
+#endif
+}
+
+static void ThreadJoin(CJSONThread thread)
+{
+#if defined(_WIN32)
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseText
+* Description: 解析完整的JSON文本，事件交给c->handler处理
+* Input      :
+    * c, Json内容
+* Output     :
+* Return     : 同Parse
+* Others     : JSON文本的语法描述如下
+
+JSON-text = ws value ws
+-----------------------------------------------------------------------------*/
+static int ParseText(CJSONContext *c)
+{
+    int ret;
+    STATS_PARSE_BEGIN(c);
+    ParseWhiteSpace(c);
+    if((ret = ParseValue(c, 0)) == PARSE_OK){
+        //Json文本应该有3部分：`ws value ws`
+        //需要对三个部分都进行解析，解析空白，然后检查Json文本是否完结
+        ParseWhiteSpace(c);
+        if(c->json != c->end)
+            ret = PARSE_ROOT_NOT_SINGULAR;
+    }
+    STATS_PARSE_END(c);
+    return ret;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseWhiteSpace
+* Description: 解析字符串中的空格，如果发现空格、制表符等字符串指针后移
+* Input      :
+    * c, Json内容
+* Output     :
+* Return     : 
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void ParseWhiteSpace(CJSONContext *c)
+{
+    const char *p = c->json, *end = c->end;
+    while(p < end && ISWHITESPACE(*p))
+        p++;
+    c->json = p;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseLiteral
+* Description: 按照固定字符串解析literal，产生null或boolean事件
+* Input      :
+    * c, Json内容
+    * literal, 用于对比的固定字符串
+    * type, 节点类型
+* Output     :
+* Return     : 
+    * PARSE_OK, 解析成功
+    * PARSE_INVALID_VALUE, 解析得到非法值
+    * PARSE_TERMINATED, 处理函数中止了解析
+* Others     : JSON的null、false、true的语法描述如下
+
+JSON-text = ws value ws
+ws = *(%x20 / %x09 / %x0A / %x0D)
+value = null / false / true
+null = "null"
+false = "false"
+true = "true" 
+-----------------------------------------------------------------------------*/
+static int ParseLiteral(CJSONContext *c, const char *literal, CJSONType type)
+{
+    //在C中，数组长度、索引值最好使用size_t，而不是int或unsigned
+    size_t i;
+    EXPECT(c, literal[0]);
+    for(i=0; literal[i+1]; i++)
+        if(PEEK(c->json + i, c->end) != literal[i+1])
+            return PARSE_INVALID_VALUE;
+    c->json += i;
+    if(type == TYPE_NULL)
+        HANDLE(c, null);
+    else
+        HANDLE_ARGS(c, boolean, type == TYPE_TRUE);
+    return PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseNumberRaw
+* Description: 解析数值类型
+    * 校验语法的同时把最多19位有效数字累加到尾数w，记录十进制指数q，值为w*10^q
+    * w不超过2^53且|q|<=22时，w和10^|q|都能精确表示成double，一次乘除法就是正确舍入的结果
+    * 否则用Eisel-Lemire算法(DecimalToBinary)查表计算
+    * 超过19位有效数字时尾数被截断，真实值在w*10^q和(w+1)*10^q之间，
+      两者转换结果相同即为答案，否则用大整数比较(DecimalToBinarySlow)决定舍入方向
+    * 不依赖strtod，因此不受locale影响，也不需要再扫描一遍
+* Input      :
+    * c, Json内容
+* Output     :
+    * n, 解析得到的数值
+* Return     : 
+    * PARSE_OK, 解析成功
+    * PARSE_INVALID_VALUE, 解析得到非法值
+    * PARSE_NUMBER_TOO_BIG, 数值超出double的范围
+* Others     : JSON数值类型的语法描述如下
+
+number = [ "-" ] int [ frac ] [ exp ]
+int = "0" / digit1-9 *digit
+frac = "." 1*digit
+exp = ("e" / "E") ["-" / "+"] 1*digit
+-----------------------------------------------------------------------------*/
+static int ParseNumberRaw(CJSONContext *c, double *n)
+{
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *p = c->json, *end = c->end;
+    const char *mantissaEnd;
+    uint64_t w = 0;          //尾数
+    int digits = 0;          //已累加的有效数字位数
+    int truncated = 0;       //是否有被丢弃的非0数字
+    int q = 0;               //十进制指数
+    int e = 0;               //书写的指数部分
+    int negative = 0;
+    uint64_t bits;
+    double d;
+
+    if(PEEK(p, end) == '-'){
+        negative = 1;
+        p++;
+    }
+    if(PEEK(p, end) == '0')
+        p++;
+    else{
+        if(!ISDIGIT1TO9(PEEK(p, end)))
+            return PARSE_INVALID_VALUE;
+        for(; ISDIGIT(PEEK(p, end)); p++){
+            if(digits < NUMBER_MAX_DIGITS){
+                w = w * 10 + (*p - '0');
+                digits++;
+            }
+            else{
+                //整数部分丢弃的数字用指数补上
+                truncated |= (*p != '0');
+                q++;
+            }
+        }
+    }
+    if(PEEK(p, end) == '.'){
+        p++;
+        if(!ISDIGIT(PEEK(p, end)))
+            return PARSE_INVALID_VALUE;
+        for(; ISDIGIT(PEEK(p, end)); p++){
+            if(digits < NUMBER_MAX_DIGITS){
+                w = w * 10 + (*p - '0');
+                //小数部分开头的0不是有效数字
+                digits += (w != 0);
+                q--;
+            }
+            else
+                truncated |= (*p != '0');
+        }
+    }
+    mantissaEnd = p;
+    if(PEEK(p, end) == 'e' || PEEK(p, end) == 'E'){
+        int expNegative = 0;
+        p++;
+        if(PEEK(p, end) == '+' || PEEK(p, end) == '-')
+            expNegative = (*p++ == '-');
+        if(!ISDIGIT(PEEK(p, end)))
+            return PARSE_INVALID_VALUE;
+        for(; ISDIGIT(PEEK(p, end)); p++)
+            if(e < 100000)   //足以让结果溢出或下溢，再大也没有区别，只需防止int溢出
+                e = e * 10 + (*p - '0');
+        if(expNegative)
+            e = -e;
+        q += e;
+    }
+    //前面这些就是按照数值的语法描述对其进行语法校验！
+    //这部分是JSON解析的一个重点：如何将语法描述翻译成代码
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if(!truncated && w <= ((uint64_t)1 << 53) && q >= -22 && q <= 22){
+        d = (double)w;
+        d = (q < 0) ? d / pow10[-q] : d * pow10[q];
+        *n = negative ? -d : d;
+        c->json = p;
+        return PARSE_OK;
+    }
+#endif
+    bits = DecimalToBinary(w, q);
+    if(truncated && DecimalToBinary(w + 1, q) != bits)
+        bits = DecimalToBinarySlow(c->json + negative, mantissaEnd, e, bits);
+
+    //检查数值是否过大！
+    if((bits >> 52) == 0x7FF)
+        return PARSE_NUMBER_TOO_BIG;
+
+    memcpy(&d, &bits, sizeof(d));
+    *n = negative ? -d : d;
+    c->json = p;
+    return PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseNumber
+* Description: 
+    * ParseNumberRaw 校验并转换数值
+    * ParseNumber    在ParseNumberRaw的基础上产生number事件
+* Input      :
+    * c, Json内容
+* Output     :
+* Return     : 
+    * 同ParseNumberRaw
+    * PARSE_TERMINATED, 处理函数中止了解析
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int ParseNumber(CJSONContext *c)
+{
+    double n;
+    int ret;
+    if((ret = ParseNumberRaw(c, &n)) != PARSE_OK)
+        return ret;
+    HANDLE_ARGS(c, number, n);
+    return PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : Multiply64
+* Description: 64位乘64位得到128位乘积
+* Input      :
+    * a, b, 乘数
+* Output     :
+    * hi, 乘积的高64位
+* Return     : 乘积的低64位
+* Others     : 
+-----------------------------------------------------------------------------*/
+static uint64_t Multiply64(uint64_t a, uint64_t b, uint64_t *hi)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, hi);
+#else
+    uint64_t aLo = (uint32_t)a, aHi = a >> 32, bLo = (uint32_t)b, bHi = b >> 32;
+    uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return (mid << 32) | (uint32_t)ll;
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : DecimalToBinary
+* Description: Eisel-Lemire算法，把w*10^q正确舍入成double
+    * 把w规格化到最高位为1，乘以查表得到的规格化后的5^q，取乘积的高位作为尾数
+    * 2^q的部分只影响二进制指数，由q*log2(10)估算(152170+65536)/65536≈log2(10)
+    * 对于19位以内的w，128位精度的5^q足以得到正确舍入的结果(Mushtak & Lemire, 2022)
+* Input      :
+    * w, 尾数，不超过19位十进制数
+    * q, 十进制指数
+* Output     :
+* Return     : 结果double的位模式(不含符号位)，上溢时为无穷大
+* Others     : 
+-----------------------------------------------------------------------------*/
+static uint64_t DecimalToBinary(uint64_t w, int q)
+{
+    uint64_t lo, hi, mantissa, secondHi;
+    const unsigned long long *pow5;
+    int lz, upperbit, power2;
+
+    if(w == 0 || q < POW5_TABLE_MIN)
+        return 0;
+    if(q > POW5_TABLE_MAX)
+        return (uint64_t)0x7FF << 52;
+
+    //规格化w
+    for(lz = 0; !(w & ((uint64_t)1 << 63)); lz++)
+        w <<= 1;
+    pow5 = &pow5Table[2 * (q - POW5_TABLE_MIN)];
+    lo = Multiply64(w, pow5[0], &hi);
+    //只需要高55位(尾数53位+1位舍入+1位可能的进位)，低位全为1时才需要用表的低64位修正
+    if((hi & 0x1FF) == 0x1FF){
+        Multiply64(w, pow5[1], &secondHi);
+        lo += secondHi;
+        if(secondHi > lo)
+            hi++;
+    }
+    upperbit = (int)(hi >> 63);
+    mantissa = hi >> (upperbit + 9);
+    power2 = (int)((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz + 1023;
+
+    //非规格化数
+    if(power2 <= 0){
+        if(-power2 + 1 >= 64)
+            return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        //舍入后可能进位成最小的规格化数
+        power2 = (mantissa < ((uint64_t)1 << 52)) ? 0 : 1;
+        return (mantissa & (((uint64_t)1 << 52) - 1)) | ((uint64_t)power2 << 52);
+    }
+    //正好在两个double中间时向偶数舍入，只有w*5^q能精确表示的q才可能出现这种情况
+    if(lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1){
+        if((mantissa << (upperbit + 9)) == hi)
+            mantissa &= ~(uint64_t)1;
+    }
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if(mantissa >= ((uint64_t)2 << 52)){
+        mantissa = (uint64_t)1 << 52;
+        power2++;
+    }
+    mantissa &= ~((uint64_t)1 << 52);
+    if(power2 >= 0x7FF)
+        return (uint64_t)0x7FF << 52;
+    return mantissa | ((uint64_t)power2 << 52);
+}
+
+/*
+慢速路径使用的大整数，32位一个字，低位在前
+*/
+typedef struct{
+    uint32_t d[BIGINT_LIMBS];
+    size_t n;
+}BigInt;
+
+//b = b * m + a
+static void BigIntMulAdd(BigInt *b, uint32_t m, uint32_t a)
+{
+    size_t i;
+    uint64_t carry = a;
+    for(i = 0; i < b->n; i++){
+        carry += (uint64_t)b->d[i] * m;
+        b->d[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if(carry != 0){
+        assert(b->n < BIGINT_LIMBS);
+        b->d[b->n++] = (uint32_t)carry;
+    }
+}
+
+//b = b * 5^n
+static void BigIntMulPow5(BigInt *b, int n)
+{
+    static const uint32_t pow5[] = { 1, 5, 25, 125, 625, 3125, 15625, 78125, 390625,
+        1953125, 9765625, 48828125, 244140625, 1220703125 };
+    for(; n >= 13; n -= 13)
+        BigIntMulAdd(b, pow5[13], 0);
+    if(n > 0)
+        BigIntMulAdd(b, pow5[n], 0);
+}
+
+//b = b * 2^n
+static void BigIntShiftLeft(BigInt *b, int n)
+{
+    size_t words = (size_t)n / 32, i;
+    int bits = n % 32;
+    if(b->n == 0)
+        return;
+    assert(b->n + words + 1 <= BIGINT_LIMBS);
+    if(bits != 0){
+        uint32_t carry = 0;
+        for(i = 0; i < b->n; i++){
+            uint32_t t = b->d[i];
+            b->d[i] = (t << bits) | carry;
+            carry = t >> (32 - bits);
+        }
+        if(carry != 0)
+            b->d[b->n++] = carry;
+    }
+    if(words != 0){
+        memmove(b->d + words, b->d, b->n * sizeof(uint32_t));
+        memset(b->d, 0, words * sizeof(uint32_t));
+        b->n += words;
+    }
+}
+
+static int BigIntCompare(const BigInt *a, const BigInt *b)
+{
+    size_t i;
+    if(a->n != b->n)
+        return a->n < b->n ? -1 : 1;
+    for(i = a->n; i > 0; i--)
+        if(a->d[i - 1] != b->d[i - 1])
+            return a->d[i - 1] < b->d[i - 1] ? -1 : 1;
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : DecimalToBinarySlow
+* Description: 尾数被截断、快速算法无法确定舍入方向时，用大整数精确比较
+    * 正确结果只可能是lower或者比lower大一个ulp的数
+    * 设lower = M*2^E，两者的中点为(2M+1)*2^(E-1)，把十进制值D = A*10^q与中点比较即可
+    * 为了避免分数，两边分别乘上5的幂和2的幂，变成两个大整数的比较
+* Input      :
+    * p, 尾数的第一个字符
+    * end, 尾数之后的字符('e'、'E'或数字结尾)
+    * e, 书写的指数部分
+    * lower, 截断后的尾数转换得到的结果(向下的候选值)
+* Output     :
+* Return     : 正确舍入的结果的位模式
+* Others     : 
+-----------------------------------------------------------------------------*/
+static uint64_t DecimalToBinarySlow(const char *p, const char *end, int e, uint64_t lower)
+{
+    BigInt left, right;
+    uint64_t mantissa = lower & (((uint64_t)1 << 52) - 1), half;
+    int power2 = (int)(lower >> 52), q = e, digits = 0, fraction = 0, sticky = 0, shift, cmp;
+
+    //A = 有效数字组成的整数，D = A * 10^q
+    left.n = 0;
+    for(; p < end; p++){
+        if(*p == '.'){
+            fraction = 1;
+            continue;
+        }
+        if(digits < NUMBER_MAX_BIG_DIGITS){
+            BigIntMulAdd(&left, 10, (uint32_t)(*p - '0'));
+            digits += (left.n != 0);
+            q -= fraction;
+        }
+        else{
+            sticky |= (*p != '0');
+            q += !fraction;
+        }
+    }
+
+    //lower = M * 2^E，中点 = (2M+1) * 2^(E-1)
+    if(power2 == 0)
+        power2 = 1;
+    else
+        mantissa |= (uint64_t)1 << 52;
+    power2 -= 1075;
+    half = 2 * mantissa + 1;
+    right.d[0] = (uint32_t)half;
+    right.d[1] = (uint32_t)(half >> 32);
+    right.n = right.d[1] ? 2 : 1;
+
+    //比较 A * 5^q * 2^q 和 (2M+1) * 2^(E-1)
+    if(q >= 0)
+        BigIntMulPow5(&left, q);
+    else
+        BigIntMulPow5(&right, -q);
+    shift = q - (power2 - 1);
+    if(shift > 0)
+        BigIntShiftLeft(&left, shift);
+    else
+        BigIntShiftLeft(&right, -shift);
+
+    cmp = BigIntCompare(&left, &right);
+    //正好落在中点上时，向偶数舍入
+    if(cmp > 0 || (cmp == 0 && (sticky || (mantissa & 1))))
+        return lower + 1;
+    return lower;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseStringRaw
+* Description: 解析字符串
+    * 先备份栈顶，然后把解析到的字符串压栈
+    * 最后计算出长度并一次性将所有字符弹出，再设置至值里面即可
+    * 用ScanStringRun成块找到不需要处理的字符，一次性压栈，只对转义字符逐个处理
+    * 没有转义字符的字符串直接返回指向输入的指针，不经过栈
+* Input      :
+    * c, Json内容
+    * len, 
+* Output     :
+    * str, 解析出来的字符串，不以'\0'结尾，只在下一次压栈之前有效
+* Return     : 
+    * PARSE_OK, 解析成功
+    * PARSE_MISS_QUOTATION_MARK, 没有遇到结束"
+* Others     : 
+
+string = quotation-mark *char quotation-mark
+char = unescaped /
+   escape (
+      %x22 /                ; "  quotation mark   U+0022
+      %x5C /                ; \  reverse solidus  U+005C
+      %x2F /                ; /  solidus          U+002F
+      %x62 /                ; b  backspace        U+0008
+      %x66 /                ; f  form feed        U+000C
+      %x6E /                ; n  line feed        U+000A
+      %x72 /                ; r  carriage return  U+000D
+      %x74 /                ; t  tab              U+0009
+      %x75 4HEXDIG )        ; uXXXX               U+XXXX
+escape = %x5C               ; \
+quotation-mark = %x22       ; "
+unescaped = %x20-21 / %x23-5B / %x5D-10FFFF
+-----------------------------------------------------------------------------*/
+static int ParseStringRaw(CJSONContext *c, const char **str, size_t *len)
+{
+    size_t head = c->top;      //先备份栈顶
+    const char *p, *q, *end = c->end;
+    char buf[4];
+    size_t n;
+    unsigned int high = 0;     //是否出现过非ASCII字节
+    int ret;
+
+    if(c->pflags & PARSE_FLAG_INSITU)
+        return ParseStringInsitu(c, str, len);
+    EXPECT(c, '\"');
+    p = c->json;
+    q = ScanStringRun(p, end, &high);
+    if(q < end && *q == '\"'){
+        if(PARSE_VALIDATE_UTF8 && high && !ValidateUtf8(p, q - p))
+            return PARSE_INVALID_UTF8;
+        *str = p;
+        *len = q - p;
+        c->json = q + 1;
+        return PARSE_OK;
+    }
+    for(;;){
+        char ch;
+        //一次性压入不需要处理的一段字符
+        if(q != p){
+            PUTS(c, p, q - p);
+            p = q;
+        }
+        if(p == end){
+            c->top = head;
+            return PARSE_MISS_QUOTATION_MARK;
+        }
+        ch = *p++;
+        switch(ch){
+            case '\"':
+                *len = c->top - head;
+                *str = ContextPop(c, *len);
+                if(PARSE_VALIDATE_UTF8 && high && !ValidateUtf8(*str, *len))
+                    return PARSE_INVALID_UTF8;
+                c->json = p;
+                return PARSE_OK;
+            //解析转义字符
+            case '\\':
+                if((ret = ParseEscape(&p, end, buf, &n)) != PARSE_OK){
+                    c->top = head;
+                    return ret;
+                }
+                PUTS(c, buf, n);
+                q = ScanStringRun(p, end, &high);
+                break;
+            default:
+                //ScanStringRun只会停在'"'、'\\'和小于0x20的字符上，剩下的都是不合法字符
+                assert((unsigned char)ch < 0x20);
+                c->top = head;
+                return PARSE_INVALID_STRING_CHAR;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseStringInsitu
+* Description: 原位解析字符串
+    * 解码结果写回输入缓冲区，写入位置永远不超过读取位置，所以不会覆盖未读的内容
+    * 结尾的'"'改写为'\0'，得到的字符串可以直接被节点引用
+* Input      :
+    * c, Json内容，c->json指向可修改的缓冲区
+* Output     :
+    * str, 缓冲区中解码后的字符串，以'\0'结尾
+    * len, 字符串长度
+* Return     : 同ParseStringRaw
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int ParseStringInsitu(CJSONContext *c, const char **str, size_t *len)
+{
+    char *p, *q, *dst;
+    const char *end = c->end;
+    size_t n;
+    unsigned int high = 0;
+    int ret;
+
+    EXPECT(c, '\"');
+    p = (char *)c->json;
+    q = (char *)ScanStringRun(p, end, &high);
+    //没有转义字符时不需要移动
+    dst = q;
+    *str = p;
+    for(;;){
+        char ch;
+        p = q;
+        if(p == end)
+            return PARSE_MISS_QUOTATION_MARK;
+        ch = *p++;
+        switch(ch){
+            case '\"':
+                *dst = '\0';
+                *len = dst - *str;
+                if(PARSE_VALIDATE_UTF8 && high && !ValidateUtf8(*str, *len))
+                    return PARSE_INVALID_UTF8;
+                c->json = p;
+                return PARSE_OK;
+            case '\\':
+                {
+                    const char *e = p;
+                    if((ret = ParseEscape(&e, end, dst, &n)) != PARSE_OK)
+                        return ret;
+                    p = (char *)e;
+                    dst += n;
+                    break;
+                }
+            default:
+                assert((unsigned char)ch < 0x20);
+                return PARSE_INVALID_STRING_CHAR;
+        }
+        //把下一段不需要处理的字符前移到dst
+        q = (char *)ScanStringRun(p, end, &high);
+        memmove(dst, p, q - p);
+        dst += q - p;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseEscape
+* Description: 解析一个转义序列
+* Input      :
+    * pp, 指向'\\'之后的字符
+* Output     :
+    * pp, 指向转义序列之后的字符
+    * buf, 转义得到的字节，\uXXXX编码为UTF-8，最多4字节
+    * n, 转义得到的字节数，不会超过转义序列本身的长度
+* Return     : 
+    * PARSE_OK, 解析成功
+    * PARSE_INVALID_STRING_ESCAPE, 不合法的转义字符
+    * PARSE_INVALID_UNICODE_HEX, \u之后不是4位十六进制数
+    * PARSE_INVALID_UNICODE_SURROGATE, 代理项不成对
+* Others     : 
+    * U+10000以上的字符用代理对表示：\uD8xx-\uDBxx之后必须紧跟\uDCxx-\uDFxx
+    * 所有的输入都读完之后才写buf，原位解析时buf可以和输入重叠
+-----------------------------------------------------------------------------*/
+static int ParseEscape(const char **pp, const char *end, char *buf, size_t *n)
+{
+    unsigned int u, low;
+    *n = 1;
+    if(*pp == end)
+        return PARSE_INVALID_STRING_ESCAPE;
+    switch(*(*pp)++){
+        case 'u' :
+            if(!ParseHex4(pp, end, &u))
+                return PARSE_INVALID_UNICODE_HEX;
+            if(u >= 0xDC00 && u <= 0xDFFF)
+                return PARSE_INVALID_UNICODE_SURROGATE;
+            if(u >= 0xD800 && u <= 0xDBFF){
+                if(end - *pp < 2 || (*pp)[0] != '\\' || (*pp)[1] != 'u')
+                    return PARSE_INVALID_UNICODE_SURROGATE;
+                *pp += 2;
+                if(!ParseHex4(pp, end, &low))
+                    return PARSE_INVALID_UNICODE_HEX;
+                if(low < 0xDC00 || low > 0xDFFF)
+                    return PARSE_INVALID_UNICODE_SURROGATE;
+                u = 0x10000 + (((u - 0xD800) << 10) | (low - 0xDC00));
+            }
+            *n = EncodeUtf8(buf, u);
+            return PARSE_OK;
+        case '\"': *buf = '\"'; return PARSE_OK;
+        case '\\': *buf = '\\'; return PARSE_OK;
+        case '/' : *buf = '/';  return PARSE_OK;
+        case 'b' : *buf = '\b'; return PARSE_OK;
+        case 'f' : *buf = '\f'; return PARSE_OK;
+        case 'n' : *buf = '\n'; return PARSE_OK;
+        case 'r' : *buf = '\r'; return PARSE_OK;
+        case 't' : *buf = '\t'; return PARSE_OK;
+        default  : return PARSE_INVALID_STRING_ESCAPE;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseHex4
+* Description: 解析\u之后的4位十六进制数
+* Input      :
+    * pp, 指向第一位十六进制数
+    * end, 输入的结尾
+* Output     :
+    * pp, 指向4位十六进制数之后
+    * u, 解析出的码元
+* Return     : 成功返回1，不足4位或者有非十六进制字符返回0
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int ParseHex4(const char **pp, const char *end, unsigned int *u)
+{
+    const char *p = *pp;
+    int i;
+    if(end - p < 4)
+        return 0;
+    *u = 0;
+    for(i = 0; i < 4; i++){
+        char ch = p[i];
+        *u <<= 4;
+        if(ISDIGIT(ch))
+            *u |= ch - '0';
+        else if(ch >= 'A' && ch <= 'F')
+            *u |= ch - 'A' + 10;
+        else if(ch >= 'a' && ch <= 'f')
+            *u |= ch - 'a' + 10;
+        else
+            return 0;
+    }
+    *pp = p + 4;
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : EncodeUtf8
+* Description: 把码点u编码为UTF-8
+* Input      :
+    * u, 码点，不超过0x10FFFF
+* Output     :
+    * buf, 编码结果，1到4字节
+* Return     : 编码的字节数
+* Others     : 
+-----------------------------------------------------------------------------*/
+static size_t EncodeUtf8(char *buf, unsigned int u)
+{
+    if(u <= 0x7F){
+        buf[0] = (char)u;
+        return 1;
+    }
+    if(u <= 0x7FF){
+        buf[0] = (char)(0xC0 | (u >> 6));
+        buf[1] = (char)(0x80 | (u & 0x3F));
+        return 2;
+    }
+    if(u <= 0xFFFF){
+        buf[0] = (char)(0xE0 | (u >> 12));
+        buf[1] = (char)(0x80 | ((u >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (u & 0x3F));
+        return 3;
+    }
+    assert(u <= 0x10FFFF);
+    buf[0] = (char)(0xF0 | (u >> 18));
+    buf[1] = (char)(0x80 | ((u >> 12) & 0x3F));
+    buf[2] = (char)(0x80 | ((u >> 6) & 0x3F));
+    buf[3] = (char)(0x80 | (u & 0x3F));
+    return 4;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ValidateUtf8
+* Description: 检查s是否是合法的UTF-8
+    * 用SIMD一次检查16(SSE2)或32(AVX2)字节是否全是ASCII，是就直接跳过
+    * 遇到非ASCII字节再逐个序列检查，拒绝过长编码、代理项和超过U+10FFFF的码点
+* Input      :
+    * s, 字符串
+    * len, 字符串长度
+* Output     :
+* Return     : 合法返回1，否则返回0
+* Others     : 
+    * 只读取[s, s + len)中的字节
+    * 解码\uXXXX得到的总是合法的UTF-8，并且以首字节开头，所以检查解码后的字符串和检查原文等价
+
+    首字节        第2字节    第3字节    第4字节
+    00..7F
+    C2..DF        80..BF
+    E0            A0..BF     80..BF
+    E1..EC        80..BF     80..BF
+    ED            80..9F     80..BF
+    EE..EF        80..BF     80..BF
+    F0            90..BF     80..BF     80..BF
+    F1..F3        80..BF     80..BF     80..BF
+    F4            80..8F     80..BF     80..BF
+-----------------------------------------------------------------------------*/
+static int ValidateUtf8(const char *s, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)s, *end = p + len;
+    unsigned char lo, hi;
+    size_t n;
+    while(p < end){
+        //跳过ASCII
+#if defined(CJSON_SIMD_AVX2)
+        while(end - p >= 32 && _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)p)) == 0)
+            p += 32;
+#elif defined(CJSON_SIMD_SSE2)
+        while(end - p >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p)) == 0)
+            p += 16;
+#endif
+        //不足一个SIMD块的部分每次检查8字节
+        while(end - p >= 8){
+            uint64_t w;
+            memcpy(&w, p, 8);
+            if(w & 0x8080808080808080ULL)
+                break;
+            p += 8;
+        }
+        while(p < end && *p < 0x80)
+            p++;
+        if(p == end)
+            break;
+        //第2字节的范围取决于首字节，之后的字节都是80..BF
+        lo = 0x80;
+        hi = 0xBF;
+        if(*p >= 0xC2 && *p <= 0xDF)
+            n = 1;
+        else if(*p >= 0xE0 && *p <= 0xEF){
+            n = 2;
+            if(*p == 0xE0)
+                lo = 0xA0;
+            else if(*p == 0xED)
+                hi = 0x9F;
+        }
+        else if(*p >= 0xF0 && *p <= 0xF4){
+            n = 3;
+            if(*p == 0xF0)
+                lo = 0x90;
+            else if(*p == 0xF4)
+                hi = 0x8F;
+        }
+        else
+            return 0;
+        if((size_t)(end - p) <= n || p[1] < lo || p[1] > hi)
+            return 0;
+        if(n >= 2 && (p[2] & 0xC0) != 0x80)
+            return 0;
+        if(n == 3 && (p[3] & 0xC0) != 0x80)
+            return 0;
+        p += n + 1;
+    }
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ScanStringRun
+* Description: 从p开始找到第一个需要特殊处理的字符：'"'、'\\'或小于0x20的控制字符
+    * SIMD实现每次读取一个对齐的块，对齐的读取不会跨越页边界
+    * 只读取包含[p, end)中字节的块，最后一块中end之后的字节不参与判断，所以输入不需要额外的填充
+* Input      :
+    * p, 字符串中的位置
+    * end, 输入的结尾
+* Output     :
+    * high, 扫描过的字节中有大于0x7F的字节时置为非0，没有时不改变
+* Return     : 第一个需要特殊处理的字符的位置，没有找到时返回end
+* Others     : 
+    * high顺便记录是否出现了非ASCII字节，全是ASCII的字符串不需要再检查UTF-8
+    * SIMD实现按块记录，可能把同一块中p之前、返回位置之后的字节也算进去，只会多检查一次
+-----------------------------------------------------------------------------*/
+#if defined(CJSON_SIMD_AVX2)
+NO_SANITIZE_ADDRESS
+static const char *ScanStringRun(const char *p, const char *end, unsigned int *high)
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i slash = _mm256_set1_epi8('\\');
+    const __m256i space = _mm256_set1_epi8(0x1F);
+    const char *base = (const char *)((uintptr_t)p & ~(uintptr_t)31);
+    unsigned int mask;
+    __m256i x;
+    if(p >= end)
+        return end;
+    x = _mm256_load_si256((const __m256i *)base);
+    *high |= (unsigned int)_mm256_movemask_epi8(x);
+    //x <= 0x1F 等价于 max(x, 0x1F) == 0x1F
+    mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+        _mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, slash)), _mm256_cmpeq_epi8(_mm256_max_epu8(x, space), space)));
+    //忽略p之前的字节
+    mask &= ~0u << (p - base);
+    for(;;){
+        if(end - base <= 32){
+            //忽略end之后的字节
+            if(end - base < 32)
+                mask &= (1u << (end - base)) - 1;
+            return (mask != 0) ? base + CTZ(mask) : end;
+        }
+        if(mask != 0)
+            return base + CTZ(mask);
+        base += 32;
+        x = _mm256_load_si256((const __m256i *)base);
+        *high |= (unsigned int)_mm256_movemask_epi8(x);
+        mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+            _mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, slash)), _mm256_cmpeq_epi8(_mm256_max_epu8(x, space), space)));
+    }
+}
+#elif defined(CJSON_SIMD_SSE2)
+NO_SANITIZE_ADDRESS
+static const char *ScanStringRun(const char *p, const char *end, unsigned int *high)
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x1F);
+    const char *base = (const char *)((uintptr_t)p & ~(uintptr_t)15);
+    unsigned int mask;
+    __m128i x;
+    if(p >= end)
+        return end;
+    x = _mm_load_si128((const __m128i *)base);
+    *high |= (unsigned int)_mm_movemask_epi8(x);
+    //x <= 0x1F 等价于 max(x, 0x1F) == 0x1F
+    mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+        _mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, slash)), _mm_cmpeq_epi8(_mm_max_epu8(x, space), space)));
+    //忽略p之前的字节
+    mask &= ~0u << (p - base);
+    for(;;){
+        if(end - base <= 16){
+            //忽略end之后的字节
+            mask &= (1u << (end - base)) - 1;
+            return (mask != 0) ? base + CTZ(mask) : end;
+        }
+        if(mask != 0)
+            return base + CTZ(mask);
+        base += 16;
+        x = _mm_load_si128((const __m128i *)base);
+        *high |= (unsigned int)_mm_movemask_epi8(x);
+        mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+            _mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, slash)), _mm_cmpeq_epi8(_mm_max_epu8(x, space), space)));
+    }
+}
+#else
+static const char *ScanStringRun(const char *p, const char *end, unsigned int *high)
+{
+    while(p < end && *p != '\"' && *p != '\\' && (unsigned char)*p >= 0x20)
+        *high |= (unsigned char)*p++ & 0x80;
+    return p;
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+* Function   : ScanNewline
+* Description: 从p开始找到第一个'\n'，用于NDJSON按行切分
+    * 和ScanStringRun一样每次读取一个对齐的块，不会读到输入所在页之外
+* Input      :
+    * p, 开始位置
+    * end, 输入的结尾
+* Output     :
+* Return     : 第一个'\n'的位置，没有找到时返回end
+* Others     : 
+-----------------------------------------------------------------------------*/
+#if defined(CJSON_SIMD_AVX2)
+NO_SANITIZE_ADDRESS
+static const char *ScanNewline(const char *p, const char *end)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const char *base = (const char *)((uintptr_t)p & ~(uintptr_t)31);
+    unsigned int mask;
+    if(p >= end)
+        return end;
+    mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)base), newline));
+    mask &= ~0u << (p - base);
+    for(;;){
+        if(end - base <= 32){
+            if(end - base < 32)
+                mask &= (1u << (end - base)) - 1;
+            return (mask != 0) ? base + CTZ(mask) : end;
+        }
+        if(mask != 0)
+            return base + CTZ(mask);
+        base += 32;
+        mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)base), newline));
+    }
+}
+#elif defined(CJSON_SIMD_SSE2)
+NO_SANITIZE_ADDRESS
+static const char *ScanNewline(const char *p, const char *end)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const char *base = (const char *)((uintptr_t)p & ~(uintptr_t)15);
+    unsigned int mask;
+    if(p >= end)
+        return end;
+    mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)base), newline));
+    mask &= ~0u << (p - base);
+    for(;;){
+        if(end - base <= 16){
+            mask &= (1u << (end - base)) - 1;
+            return (mask != 0) ? base + CTZ(mask) : end;
+        }
+        if(mask != 0)
+            return base + CTZ(mask);
+        base += 16;
+        mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)base), newline));
+    }
+}
+#else
+static const char *ScanNewline(const char *p, const char *end)
+{
+    const char *q = (const char *)memchr(p, '\n', (p < end) ? (size_t)(end - p) : 0);
+    return (q != NULL) ? q : end;
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseString
+* Description: 
+    * ParseStringRaw 主要用于解析普遍的字符串：键值对的键、JSON字符串
+    * ParseString    用于在ParseStringRaw的基础上解析JSON的字符串，产生string事件
+* Input      :
+    * c, Json内容
+* Output     :
+* Return     : 
+    * PARSE_OK, 解析成功
+    * PARSE_MISS_QUOTATION_MARK, 没有遇到结束"
+    * PARSE_TERMINATED, 处理函数中止了解析
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int ParseString(CJSONContext *c)
+{
+    int ret;
+    const char *s;
+    size_t len;
+    if((ret = ParseStringRaw(c, &s, &len)) != PARSE_OK)
+        return ret;
+    HANDLE_ARGS(c, string, s, len);
+    return PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseMemberKey
+* Description: 解析对象成员的键和之后的':'，产生key事件
+* Input      : 
+    * c, Json内容，指向键之前
+* Output     :
+* Return     : 
+    * PARSE_OK, 解析成功，c指向值的开始
+    * PARSE_MISS_KEY, 没找到键
+    * PARSE_MISS_COLON, 没找到`:`
+    * PARSE_TERMINATED, 处理函数中止了解析
+* Others     : 
+
+member = string ws %3A ws value
+-----------------------------------------------------------------------------*/
+static int ParseMemberKey(CJSONContext *c)
+{
+    const char *str;
+    size_t klen;
+    int ret;
+    if(PEEK(c->json, c->end) != '"')
+        return PARSE_MISS_KEY;
+    if((ret = ParseStringRaw(c, &str, &klen)) != PARSE_OK)
+        return ret;
+    HANDLE_ARGS(c, key, str, klen);
+    //键和`:`之间、`:`和值之间都可能有空格
+    ParseWhiteSpace(c);
+    if(PEEK(c->json, c->end) != ':')
+        return PARSE_MISS_COLON;
+    c->json++;
+    ParseWhiteSpace(c);
+    return PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseValue
+* Description: 解析一个值，数组、对象的嵌套用显式的层次栈代替递归
+    * 遇到'['、'{'时记录一层，然后解析它的第一个元素
+    * 一个值解析完之后回到所在的层：遇到','继续解析下一个元素，遇到']'、'}'结束这一层
+    * 层次栈先使用函数内的数组，嵌套更深时才从c->allocator申请
+    * 恶意的"[[[[..."不会耗尽C的调用栈，嵌套层数受PARSE_MAX_DEPTH限制
+* Input      :
+    * c, Json内容
+    * depth, 外面已经有的嵌套层数，并行解析的一段在根数组之内，为1
+* Output     :
+* Return     : 
+    * PARSE_OK, 解析成功
+    * PARSE_INVALID_VALUE, 解析得到非法值
+    * PARSE_EXPECT_VALUE, 解析到结尾了，不能继续解析
+    * PARSE_MISS_COMMA_OR_SQUARE_BRACKET、PARSE_MISS_COMMA_OR_CURLY_BRACKET
+    * PARSE_MISS_KEY、PARSE_MISS_COLON
+    * PARSE_DEPTH_EXCEEDED, 嵌套超过PARSE_MAX_DEPTH层
+    * PARSE_TERMINATED, 处理函数中止了解析
+* Others     : 
+    * 按需解析时数组、对象交给ParseScalar记录位置，PARSE_FLAG_EXPAND时最外层除外
+
+array = %x5B ws [ value *(ws %x2C ws value) ] ws %x5D
+object = %x7B ws [ member *(ws %x2C ws member ) ] ws %x7D
+-----------------------------------------------------------------------------*/
+static int ParseValue(CJSONContext *c, size_t depth)
+{
+    CJSONParserLevel stack[PARSE_LEVEL_INIT_SIZE], *levels = stack, *level;
+    size_t top = 0, capacity = PARSE_LEVEL_INIT_SIZE;
+    int ret;
+    char ch;
+    for(;;){
+        ch = PEEK(c->json, c->end);
+        if((ch == '[' || ch == '{') && (!(c->pflags & PARSE_FLAG_LAZY) || (top == 0 && (c->pflags & PARSE_FLAG_EXPAND)))){
+            if(depth + top >= PARSE_MAX_DEPTH){
+                ret = PARSE_DEPTH_EXCEEDED;
+                goto out;
+            }
+            STATS_MAX(maxDepth, depth + top + 1);
+            c->json++;
+            if(!((ch == '[') ? HANDLED(c, startArray) : HANDLED(c, startObject))){
+                ret = PARSE_TERMINATED;
+                goto out;
+            }
+            ParseWhiteSpace(c);
+            if(PEEK(c->json, c->end) != ch + 2){
+                if(top == capacity){
+                    capacity += capacity >> 1;
+                    if(levels == stack){
+                        levels = (CJSONParserLevel *)MALLOC(c->allocator, capacity * sizeof(CJSONParserLevel));
+                        memcpy(levels, stack, sizeof(stack));
+                    }
+                    else
+                        levels = (CJSONParserLevel *)REALLOC(c->allocator, levels, capacity * sizeof(CJSONParserLevel));
+                }
+                levels[top].type = ch;
+                levels[top].size = 0;
+                top++;
+                //元素交给处理函数，建立节点树时由DOM处理函数暂存在栈上，这一层结束时再组装
+                if(ch == '{' && (ret = ParseMemberKey(c)) != PARSE_OK)
+                    goto out;
+                continue;
+            }
+            //空数组、空对象
+            c->json++;
+            if(!((ch == '[') ? HANDLED_ARGS(c, endArray, 0) : HANDLED_ARGS(c, endObject, 0))){
+                ret = PARSE_TERMINATED;
+                goto out;
+            }
+        }
+        else if((ret = ParseScalar(c)) != PARSE_OK)
+            goto out;
+        //一个值解析完，回到所在的层，直到需要解析下一个元素
+        for(;;){
+            if(top == 0){
+                ret = PARSE_OK;
+                goto out;
+            }
+            level = &levels[top - 1];
+            level->size++;
+            ParseWhiteSpace(c);
+            ch = PEEK(c->json, c->end);
+            if(ch == ','){
+                c->json++;
+                ParseWhiteSpace(c);
+                if(level->type == '{' && (ret = ParseMemberKey(c)) != PARSE_OK)
+                    goto out;
+                break;
+            }
+            if(ch != level->type + 2){
+                ret = (level->type == '[') ? PARSE_MISS_COMMA_OR_SQUARE_BRACKET : PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                goto out;
+            }
+            c->json++;
+            top--;
+            if(!((level->type == '[') ? HANDLED_ARGS(c, endArray, level->size) : HANDLED_ARGS(c, endObject, level->size))){
+                ret = PARSE_TERMINATED;
+                goto out;
+            }
+        }
+    }
+out:
+    if(levels != stack)
+        FREE(c->allocator, levels);
+    return ret;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParseScalar
+* Description: 判断下一个字符是n、t、f、0-9/-、"，选择具体调用哪个解析方法
+* Input      :
+    * c, Json内容
+* Output     :
+* Return     : 
+    * PARSE_OK, 解析成功
+    * PARSE_INVALID_VALUE, 解析得到非法值
+    * PARSE_EXPECT_VALUE, 解析到结尾了，不能继续解析
+* Others     : 数组、对象由ParseValue处理，只有按需解析时的数组、对象会到这里，只记录位置
+-----------------------------------------------------------------------------*/
+static int ParseScalar(CJSONContext *c)
+{
+    if(c->json == c->end)
+        return PARSE_EXPECT_VALUE;
+    //这里return直接跳出，所以不再需要用break！
+    switch(*c->json){
+        case 'n'  : return ParseLiteral(c, "null", TYPE_NULL);
+        case 't'  : return ParseLiteral(c, "true", TYPE_TRUE);
+        case 'f'  : return ParseLiteral(c, "false", TYPE_FALSE);
+        case '0'  :
+        case '1'  :
+        case '2'  :
+        case '3'  :
+        case '4'  :
+        case '5'  :
+        case '6'  :
+        case '7'  :
+        case '8'  :
+        case '9'  :
+        case '-'  : return ParseNumber(c);
+        case '\"' : return ParseString(c);
+        case '['  :
+        case '{'  : return ParseDeferred(c);
+        default   : return PARSE_INVALID_VALUE;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : DomNull等
+* Description: 建立节点树的处理函数，user为CJSONContext
+    * 每个值都以一个CJSONValue压入c的栈，对象的键也以字符串节点的形式压栈
+    * 原位解析时字符串直接引用输入缓冲区，带上VALUE_FLAG_BORROWED
+    * 在文档中解析时每个节点(包括null、数值等)都带上VALUE_FLAG_DOCUMENT
+* Input      :
+* Output     :
+* Return     : 总是返回1
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int DomNull(void *user)
+{
+    CJSONValue *v = (CJSONValue *)ContextPush((CJSONContext *)user, sizeof(CJSONValue));
+    v->type = TYPE_NULL;
+    v->flags = ((CJSONContext *)user)->vflags;
+    STATS_ADD(nodes[TYPE_NULL], 1);
+    return 1;
+}
+
+static int DomBoolean(void *user, int b)
+{
+    CJSONValue *v = (CJSONValue *)ContextPush((CJSONContext *)user, sizeof(CJSONValue));
+    v->type = b ? TYPE_TRUE : TYPE_FALSE;
+    v->flags = ((CJSONContext *)user)->vflags;
+    STATS_ADD(nodes[v->type], 1);
+    return 1;
+}
+
+static int DomNumber(void *user, double n)
+{
+    CJSONValue *v = (CJSONValue *)ContextPush((CJSONContext *)user, sizeof(CJSONValue));
+    v->type = TYPE_NUMBER;
+    v->flags = ((CJSONContext *)user)->vflags;
+    v->u.n = n;
+    STATS_ADD(nodes[TYPE_NUMBER], 1);
+    return 1;
+}
+
+static int DomString(void *user, const char *s, size_t len)
+{
+    STATS_ADD(nodes[TYPE_STRING], 1);
+    return DomPushString((CJSONContext *)user, s, len, SHORT_STRING_MAX);
+}
+
+static int DomKey(void *user, const char *k, size_t klen)
+{
+    STATS_ADD(keys, 1);
+    //键最后放在成员里，成员中短键的空间比节点小
+    return DomPushString((CJSONContext *)user, k, klen, SHORT_KEY_MAX);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : DomPushString
+* Description: DomString、DomKey的公共部分，把字符串或键以字符串节点的形式压栈
+    * 不超过max字节时存放在节点内，带上VALUE_FLAG_SHORT，不申请内存
+* Input      :
+    * c, Json内容; s, 字符串; len, 字节数
+    * max, 存放在节点内的最大长度
+* Output     :
+* Return     : 总是返回1
+* Others     : 原位解析的字符串已经不需要申请内存，仍然直接引用缓冲区
+-----------------------------------------------------------------------------*/
+static int DomPushString(CJSONContext *c, const char *s, size_t len, size_t max)
+{
+    CJSONValue tmp, *v;
+    char *p;
+    unsigned int flags = c->vflags;
+    if(c->pflags & PARSE_FLAG_INSITU){
+        //原位解析的字符串已经在缓冲区中以'\0'结尾，直接引用
+        p = (char *)s;
+        flags |= VALUE_FLAG_BORROWED;
+    }
+    else if(len <= max){
+        //s可能指向栈上刚弹出的内容，先在tmp中复制好再压栈
+        tmp.type = TYPE_STRING;
+        tmp.flags = flags;
+        StringInit(&tmp, NULL, s, len);
+        *(CJSONValue *)ContextPush(c, sizeof(CJSONValue)) = tmp;
+        STATS_ADD(stringBytes, len);
+        return 1;
+    }
+    else{
+        //s可能指向栈上刚弹出的内容，必须先复制再压栈
+        p = ContextStrdup(c, s, len);
+        STATS_ADD(stringBytes, len);
+    }
+    v = (CJSONValue *)ContextPush(c, sizeof(CJSONValue));
+    v->type = TYPE_STRING;
+    v->flags = flags;
+    v->u.s.s = p;
+    v->u.s.len = len;
+    return 1;
+}
+
+static int DomEndArray(void *user, size_t size)
+{
+    CJSONContext *c = (CJSONContext *)user;
+    CJSONValue *e = NULL, *v;
+    if(size > 0){
+        size_t s = size * sizeof(CJSONValue);
+        memcpy(e = (CJSONValue *)ContextAlloc(c, s), ContextPop(c, s), s);
+    }
+    v = (CJSONValue *)ContextPush(c, sizeof(CJSONValue));
+    v->type = TYPE_ARRAY;
+    v->flags = c->vflags;
+    v->u.a.e = e;
+    v->u.a.size = v->u.a.capacity = size;
+    STATS_ADD(nodes[TYPE_ARRAY], 1);
+    return 1;
+}
+
+static int DomEndObject(void *user, size_t size)
+{
+    CJSONContext *c = (CJSONContext *)user;
+    CJSONMember *m = NULL;
+    CJSONObjectIndex *index = NULL;
+    CJSONValue *v;
+    size_t i;
+    if(size > 0){
+        //栈上是键、值交替的2*size个节点
+        const CJSONValue *kv = (const CJSONValue *)ContextPop(c, 2 * size * sizeof(CJSONValue));
+        m = (CJSONMember *)ContextAlloc(c, size * sizeof(CJSONMember));
+        for(i = 0; i < size; i++, kv += 2){
+            m[i].v = kv[1];
+            //DomKey保证栈上的短键放得进成员
+            if(kv[0].flags & VALUE_FLAG_SHORT)
+                KeyInit(&m[i], NULL, kv[0].u.ss, STRING_LEN(&kv[0]));
+            else{
+                m[i].key.p.k = kv[0].u.s.s;
+                m[i].key.p.klen = kv[0].u.s.len;
+                m[i].key.s[SHORT_KEY_MAX] = (char)((kv[0].flags & VALUE_FLAG_BORROWED) ? KEY_TAG_BORROWED : KEY_TAG_OWNED);
+            }
+        }
+        //文档中的节点不会单独释放，大对象的索引在解析时直接从文档中建立
+        if(c->doc != NULL && size >= OBJECT_INDEX_THRESHOLD){
+            size_t s = ObjectIndexBytes(size);
+            index = (CJSONObjectIndex *)DocumentAlloc(c->doc, s);
+            ObjectIndexFill(index, s, m, size);
+        }
+    }
+    v = (CJSONValue *)ContextPush(c, sizeof(CJSONValue));
+    v->type = TYPE_OBJECT;
+    v->flags = c->vflags;
+    v->u.o.m = m;
+    v->u.o.size = v->u.o.capacity = size;
+    v->u.o.index = index;
+    STATS_ADD(nodes[TYPE_OBJECT], 1);
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : TapePush
+* Description: 在磁带末尾追加一个字，空间不足时以1.5倍扩展
+* Input      :
+    * tape, 磁带
+    * w, 字
+* Output     :
+* Return     : 
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void TapePush(CJSONTape *tape, unsigned long long w)
+{
+    if(tape->size == tape->capacity){
+        tape->capacity = (tape->capacity == 0) ? TAPE_INIT_SIZE : tape->capacity + (tape->capacity >> 1);
+        tape->words = (unsigned long long *)REALLOC(&tape->allocator, tape->words, tape->capacity * sizeof(unsigned long long));
+    }
+    tape->words[tape->size++] = w;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : TapeNull等
+* Description: 生成磁带的处理函数，user为CJSONTape
+    * 数组、对象开始时开始字暂时记录外层的开始字下标，把未结束的容器串成一个栈
+    * 结束时从开始字取回外层，再把开始字改写为结束字之后的下标
+* Input      :
+* Output     :
+* Return     : 总是返回1
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int TapeNull(void *user)
+{
+    TapePush((CJSONTape *)user, TAPE_WORD('n', 0));
+    return 1;
+}
+
+static int TapeBoolean(void *user, int b)
+{
+    TapePush((CJSONTape *)user, TAPE_WORD(b ? 't' : 'f', 0));
+    return 1;
+}
+
+static int TapeNumber(void *user, double n)
+{
+    CJSONTape *tape = (CJSONTape *)user;
+    unsigned long long w;
+    memcpy(&w, &n, sizeof(w));
+    TapePush(tape, TAPE_WORD('d', 0));
+    TapePush(tape, w);
+    return 1;
+}
+
+static int TapeString(void *user, const char *s, size_t len)
+{
+    CJSONTape *tape = (CJSONTape *)user;
+    if(tape->slen + len + 1 > tape->scapacity){
+        if(tape->scapacity == 0)
+            tape->scapacity = TAPE_INIT_SIZE;
+        while(tape->slen + len + 1 > tape->scapacity)
+            tape->scapacity += tape->scapacity >> 1;
+        tape->strings = (char *)REALLOC(&tape->allocator, tape->strings, tape->scapacity);
+    }
+    TapePush(tape, TAPE_WORD('\"', tape->slen));
+    TapePush(tape, (unsigned long long)len);
+    memcpy(tape->strings + tape->slen, s, len);
+    tape->strings[tape->slen + len] = '\0';
+    tape->slen += len + 1;
+    return 1;
+}
+
+static int TapeStart(CJSONTape *tape, char tag)
+{
+    TapePush(tape, TAPE_WORD(tag, tape->open));
+    tape->open = tape->size - 1;
+    return 1;
+}
+
+static int TapeEnd(CJSONTape *tape, char tag, size_t size)
+{
+    size_t start = tape->open;
+    tape->open = TAPE_PAYLOAD(tape->words[start]);
+    TapePush(tape, TAPE_WORD(tag, size));
+    tape->words[start] = TAPE_WORD(TAPE_TAG(tape->words[start]), tape->size);
+    return 1;
+}
+
+static int TapeStartObject(void *user)
+{
+    return TapeStart((CJSONTape *)user, '{');
+}
+
+static int TapeEndObject(void *user, size_t size)
+{
+    return TapeEnd((CJSONTape *)user, '}', size);
+}
+
+static int TapeStartArray(void *user)
+{
+    return TapeStart((CJSONTape *)user, '[');
+}
+
+static int TapeEndArray(void *user, size_t size)
+{
+    return TapeEnd((CJSONTape *)user, ']', size);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParserConsume
+* Description: 增量解析器的状态机，从当前状态开始消费[s, end)中的所有字节
+    * 每个状态对应递归下降解析中的一个位置，遇到的字符和出错时的错误码与Parse完全相同
+    * 字符串中不需要处理的一段字符、数值的一段字符一次性压栈
+* Input      :
+    * p, 解析器
+    * s, end, 输入块
+* Output     :
+* Return     : 
+    * PARSE_OK, 目前为止的输入都合法
+    * 其他, 同Parse
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int ParserConsume(CJSONParser *p, const char *s, const char *end)
+{
+    CJSONContext *c = &p->c;
+    int ret;
+    while(s < end){
+        char ch = *s;
+        switch(p->state){
+            case PARSER_VALUE:
+                if(ISWHITESPACE(ch)){
+                    s++;
+                    break;
+                }
+                switch(ch){
+                    case 'n' : p->literal = "null"; break;
+                    case 't' : p->literal = "true"; break;
+                    case 'f' : p->literal = "false"; break;
+                    case '0' : case '1' : case '2' : case '3' : case '4' :
+                    case '5' : case '6' : case '7' : case '8' : case '9' :
+                    case '-' :
+                        p->head = c->top;
+                        p->state = PARSER_NUMBER;
+                        continue;
+                    case '\"':
+                        s++;
+                        p->head = c->top;
+                        p->key = 0;
+                        p->state = PARSER_STRING;
+                        continue;
+                    case '[':
+                    case '{':
+                        if(p->depth >= PARSE_MAX_DEPTH)
+                            return PARSE_DEPTH_EXCEEDED;
+                        s++;
+                        if(ch == '[')
+                            HANDLE(c, startArray);
+                        else
+                            HANDLE(c, startObject);
+                        if(p->depth == p->capacity){
+                            p->capacity = p->capacity ? p->capacity + (p->capacity >> 1) : PARSER_LEVEL_INIT_SIZE;
+                            p->levels = (CJSONParserLevel *)REALLOC(&p->allocator, p->levels, p->capacity * sizeof(CJSONParserLevel));
+                        }
+                        p->levels[p->depth].type = ch;
+                        p->levels[p->depth].size = 0;
+                        p->depth++;
+                        STATS_MAX(maxDepth, p->depth);
+                        p->state = (ch == '[') ? PARSER_ARRAY_FIRST : PARSER_OBJECT_FIRST;
+                        continue;
+                    case '\0': return PARSE_EXPECT_VALUE;
+                    default  : return PARSE_INVALID_VALUE;
+                }
+                s++;
+                p->index = 1;
+                p->state = PARSER_LITERAL;
+                break;
+            case PARSER_LITERAL:
+                if(ch != p->literal[p->index])
+                    return PARSE_INVALID_VALUE;
+                s++;
+                if(p->literal[++p->index] == '\0'){
+                    if(p->literal[0] == 'n')
+                        HANDLE(c, null);
+                    else
+                        HANDLE_ARGS(c, boolean, p->literal[0] == 't');
+                    ParserEndValue(p);
+                }
+                break;
+            case PARSER_NUMBER:
+                {
+                    //数值中可能出现的字符先全部收集起来，再交给ParseNumberRaw校验
+                    const char *q = s;
+                    while(q < end && (ISDIGIT(*q) || *q == '-' || *q == '+' || *q == '.' || *q == 'e' || *q == 'E'))
+                        q++;
+                    PUTS(c, s, q - s);
+                    s = q;
+                    if(s < end && (ret = ParserEndNumber(p)) != PARSE_OK)
+                        return ret;
+                    break;
+                }
+            case PARSER_STRING:
+                {
+                    const char *q = s;
+                    while(q < end && *q != '\"' && *q != '\\' && (unsigned char)*q >= 0x20)
+                        q++;
+                    PUTS(c, s, q - s);
+                    s = q;
+                    if(s == end)
+                        break;
+                    s++;
+                    switch(*q){
+                        case '\"':
+                            if((ret = ParserEndString(p)) != PARSE_OK)
+                                return ret;
+                            break;
+                        case '\\':
+                            p->state = PARSER_ESCAPE;
+                            p->nescape = 0;
+                            break;
+                        case '\0':
+                            return PARSE_MISS_QUOTATION_MARK;
+                        default:
+                            return PARSE_INVALID_STRING_CHAR;
+                    }
+                    break;
+                }
+            case PARSER_ESCAPE:
+                {
+                    //\uXXXX和代理对可能被输入块的边界打断，先收集完整的转义序列
+                    char buf[4];
+                    const char *e = p->escape;
+                    size_t n;
+                    p->escape[p->nescape++] = *s++;
+                    if(!EscapeComplete(p->escape, p->nescape))
+                        break;
+                    if((ret = ParseEscape(&e, p->escape + p->nescape, buf, &n)) != PARSE_OK)
+                        return ret;
+                    PUTS(c, buf, n);
+                    p->state = PARSER_STRING;
+                    break;
+                }
+            case PARSER_ARRAY_FIRST:
+            case PARSER_OBJECT_FIRST:
+                if(ISWHITESPACE(ch)){
+                    s++;
+                    break;
+                }
+                if(ch == (p->state == PARSER_ARRAY_FIRST ? ']' : '}')){
+                    s++;
+                    p->depth--;
+                    if(ch == ']')
+                        HANDLE_ARGS(c, endArray, 0);
+                    else
+                        HANDLE_ARGS(c, endObject, 0);
+                    ParserEndValue(p);
+                }
+                else
+                    p->state = (p->state == PARSER_ARRAY_FIRST) ? PARSER_VALUE : PARSER_KEY;
+                break;
+            case PARSER_KEY:
+                if(ISWHITESPACE(ch)){
+                    s++;
+                    break;
+                }
+                if(ch != '\"')
+                    return PARSE_MISS_KEY;
+                s++;
+                p->head = c->top;
+                p->key = 1;
+                p->state = PARSER_STRING;
+                break;
+            case PARSER_COLON:
+                if(ISWHITESPACE(ch)){
+                    s++;
+                    break;
+                }
+                if(ch != ':')
+                    return PARSE_MISS_COLON;
+                s++;
+                p->state = PARSER_VALUE;
+                break;
+            case PARSER_AFTER_VALUE:
+                if(ISWHITESPACE(ch)){
+                    s++;
+                    break;
+                }
+                if(p->depth == 0){
+                    //根节点之后只能是文本结束
+                    if(ch != '\0')
+                        return PARSE_ROOT_NOT_SINGULAR;
+                    s++;
+                    break;
+                }
+                if(ch == ','){
+                    s++;
+                    p->state = (p->levels[p->depth - 1].type == '[') ? PARSER_VALUE : PARSER_KEY;
+                    break;
+                }
+                if(ch == (p->levels[p->depth - 1].type == '[' ? ']' : '}')){
+                    size_t size = p->levels[--p->depth].size;
+                    s++;
+                    if(ch == ']')
+                        HANDLE_ARGS(c, endArray, size);
+                    else
+                        HANDLE_ARGS(c, endObject, size);
+                    ParserEndValue(p);
+                    break;
+                }
+                return ParserAfterValueError(p);
+        }
+    }
+    return PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParserEndValue
+* Description: 一个值解析完成，计入所在的数组或对象
+-----------------------------------------------------------------------------*/
+static void ParserEndValue(CJSONParser *p)
+{
+    if(p->depth > 0)
+        p->levels[p->depth - 1].size++;
+    p->state = PARSER_AFTER_VALUE;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParserEndNumber
+* Description: 遇到数值之后的第一个字符，校验并转换收集到的数值
+    * ParseNumberRaw没有用完收集到的字符时，剩下的字符就是值之后的非法字符
+-----------------------------------------------------------------------------*/
+static int ParserEndNumber(CJSONParser *p)
+{
+    CJSONContext *c = &p->c;
+    size_t len;
+    double n;
+    int ret, rest;
+    len = c->top - p->head;
+    c->json = (const char *)ContextPop(c, len);
+    c->end = c->json + len;
+    ret = ParseNumberRaw(c, &n);
+    //处理函数可能压栈，覆盖收集到的字符，先记下是否有剩余
+    rest = (c->json != c->end);
+    if(ret != PARSE_OK)
+        return ret;
+    HANDLE_ARGS(c, number, n);
+    ParserEndValue(p);
+    return rest ? ParserAfterValueError(p) : PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParserEndString
+* Description: 遇到结束的'"'，把栈上收集到的字符串作为键或字符串交给处理函数
+-----------------------------------------------------------------------------*/
+static int ParserEndString(CJSONParser *p)
+{
+    CJSONContext *c = &p->c;
+    size_t len = c->top - p->head;
+    const char *str = (const char *)ContextPop(c, len);
+    if(PARSE_VALIDATE_UTF8 && !ValidateUtf8(str, len))
+        return PARSE_INVALID_UTF8;
+    if(p->key){
+        HANDLE_ARGS(c, key, str, len);
+        p->state = PARSER_COLON;
+        return PARSE_OK;
+    }
+    HANDLE_ARGS(c, string, str, len);
+    ParserEndValue(p);
+    return PARSE_OK;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : EscapeComplete
+* Description: 增量解析时判断'\\'之后收到的n个字符是否已经是一个完整的转义序列
+    * 出现不合法的字符时也认为完整，交给ParseEscape返回对应的错误码
+    * \uD800-\uDBFF之后还要等待低代理项"\uXXXX"
+-----------------------------------------------------------------------------*/
+static int EscapeComplete(const char *escape, size_t n)
+{
+    const char *e = escape + 1;
+    unsigned int u;
+    char ch = escape[n - 1];
+    if(escape[0] != 'u' || n == 11)
+        return 1;
+    if(n == 1)
+        return 0;
+    if(n <= 5 || n >= 8){
+        if(!ISHEX(ch))
+            return 1;
+        if(n != 5)
+            return 0;
+        ParseHex4(&e, escape + 5, &u);
+        return u < 0xD800 || u > 0xDBFF;
+    }
+    return (n == 6) ? ch != '\\' : ch != 'u';
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParserAfterValueError
+* Description: 值之后出现了不合法的字符时，返回和Parse相同的错误码
+-----------------------------------------------------------------------------*/
+static int ParserAfterValueError(const CJSONParser *p)
+{
+    if(p->depth == 0)
+        return PARSE_ROOT_NOT_SINGULAR;
+    return (p->levels[p->depth - 1].type == '[') ? PARSE_MISS_COMMA_OR_SQUARE_BRACKET : PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ParserClear
+* Description: 回到初始状态，释放栈上未完成的节点，保留栈和层次栈的内存
+-----------------------------------------------------------------------------*/
+static void ParserClear(CJSONParser *p)
+{
+    CJSONContext *c = &p->c;
+    //未完成的字符串、数值不是节点，先丢弃
+    if(p->state == PARSER_NUMBER || p->state == PARSER_STRING || p->state == PARSER_ESCAPE)
+        c->top = p->head;
+    if(c->handler == &p->dom){
+        while(c->top > 0)
+            FreeValueWithAllocator((CJSONValue *)ContextPop(c, sizeof(CJSONValue)), c->allocator);
+    }
+    c->top = 0;
+    p->state = PARSER_VALUE;
+    p->ret = PARSE_OK;
+    p->depth = 0;
+}
+
+/*
+Grisu2使用的无符号64位浮点数，值为f * 2^e
+*/
+typedef struct{
+    uint64_t f;
+    int e;
+}DiyFp;
+
+static DiyFp DiyFpMultiply(DiyFp a, DiyFp b)
+{
+    DiyFp r;
+    uint64_t hi, lo = Multiply64(a.f, b.f, &hi);
+    r.f = hi + (lo >> 63);   //舍入
+    r.e = a.e + b.e + 64;
+    return r;
+}
+
+static DiyFp DiyFpNormalize(DiyFp a)
+{
+    while(!(a.f & ((uint64_t)1 << 63))){
+        a.f <<= 1;
+        a.e--;
+    }
+    return a;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : CachedPower
+* Description: 查表得到规格化的10^K，使它与w的乘积的二进制指数落在[-60, -32]附近
+* Input      :
+    * e, w的二进制指数
+* Output     :
+    * K, 对应的十进制指数，返回值约等于10^K
+* Return     : 10^K
+* Others     : 表中是10^-348到10^340之间每隔8的幂，四舍五入到64位
+-----------------------------------------------------------------------------*/
+static DiyFp CachedPower(int e, int *K)
+{
+    static const uint64_t cachedPowersF[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+    };
+    static const short cachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874, -847,
+    -821, -794, -768, -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77, -50,
+    -24, 3, 30, 56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747,
+    774, 800, 827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066
+    };
+    DiyFp r;
+    double dk = (-61 - e) * 0.30102999566398114 + 347;  //dk = (-61 - e) * log10(2) + 347
+    int k = (int)dk, index;
+    if(dk - k > 0.0)
+        k++;
+    index = (k >> 3) + 1;
+    *K = -(-348 + index * 8);
+    r.f = cachedPowersF[index];
+    r.e = cachedPowersE[index];
+    return r;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : GrisuRound
+* Description: 在允许的区间内把最后一位数字向真实值靠近
+-----------------------------------------------------------------------------*/
+static void GrisuRound(char *buffer, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw)
+{
+    while(rest < wpw && delta - rest >= tenKappa &&
+        (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)){
+        buffer[len - 1]--;
+        rest += tenKappa;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : DigitGen
+* Description: 从上边界Mp开始逐位生成十进制数字，直到剩余部分落进[Mp-delta, Mp]区间
+* Input      :
+    * W, 待转换的值; Mp, 上边界; delta, 上下边界之差
+* Output     :
+    * buffer, 生成的数字; len, 数字个数; K, 十进制指数的修正
+* Return     : 
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void DigitGen(DiyFp W, DiyFp Mp, uint64_t delta, char *buffer, int *len, int *K)
+{
+    static const uint64_t pow10[] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+        1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+        100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+        1000000000000000000ULL, 10000000000000000000ULL
+    };
+    int shift = -Mp.e;
+    uint64_t one = (uint64_t)1 << shift;
+    uint64_t wpw = Mp.f - W.f;
+    uint32_t p1 = (uint32_t)(Mp.f >> shift);   //整数部分
+    uint64_t p2 = Mp.f & (one - 1);            //小数部分
+    int kappa = 1;
+
+    while(kappa < 10 && p1 >= pow10[kappa])
+        kappa++;
+    *len = 0;
+    //整数部分
+    while(kappa > 0){
+        uint32_t divisor = (uint32_t)pow10[kappa - 1];   //整数部分不超过32位，用32位除法
+        uint32_t d = p1 / divisor;
+        uint64_t rest;
+        p1 %= divisor;
+        if(d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        kappa--;
+        rest = ((uint64_t)p1 << shift) + p2;
+        if(rest <= delta){
+            *K += kappa;
+            GrisuRound(buffer, *len, delta, rest, pow10[kappa] << shift, wpw);
+            return;
+        }
+    }
+    //小数部分
+    for(;;){
+        char d;
+        p2 *= 10;
+        delta *= 10;
+        d = (char)(p2 >> shift);
+        if(d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        p2 &= one - 1;
+        kappa--;
+        if(p2 < delta){
+            *K += kappa;
+            GrisuRound(buffer, *len, delta, p2, one, -kappa < 20 ? wpw * pow10[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : Grisu2
+* Description: Grisu2算法把正的有限double转换成尽量短的十进制数字串
+    * 结果为buffer[0, len) * 10^K，再解析回来一定得到原来的double
+    * 取double两侧相邻值的中点作为边界，只在边界内生成数字，因此大多数情况下就是最短表示
+* Input      :
+    * value, 大于0的有限double
+* Output     :
+    * buffer, 十进制数字(最多17位); len, 数字个数; K, 十进制指数
+* Return     : 
+* Others     : 参考Florian Loitsch, Printing Floating-Point Numbers Quickly and Accurately with Integers
+-----------------------------------------------------------------------------*/
+static void Grisu2(double value, char *buffer, int *len, int *K)
+{
+    DiyFp v, plus, minus, cached, W, Wp, Wm;
+    uint64_t bits;
+    int biased;
+
+    memcpy(&bits, &value, sizeof(bits));
+    biased = (int)(bits >> 52);
+    v.f = bits & (((uint64_t)1 << 52) - 1);
+    if(biased != 0){
+        v.f |= (uint64_t)1 << 52;
+        v.e = biased - 1075;
+    }
+    else
+        v.e = -1074;
+
+    //上下边界是与相邻double的中点
+    plus.f = (v.f << 1) + 1;
+    plus.e = v.e - 1;
+    plus = DiyFpNormalize(plus);
+    if(v.f == ((uint64_t)1 << 52)){
+        //2的整数次幂下方的间隔只有上方的一半
+        minus.f = (v.f << 2) - 1;
+        minus.e = v.e - 2;
+    }
+    else{
+        minus.f = (v.f << 1) - 1;
+        minus.e = v.e - 1;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    cached = CachedPower(plus.e, K);
+    W = DiyFpMultiply(DiyFpNormalize(v), cached);
+    Wp = DiyFpMultiply(plus, cached);
+    Wm = DiyFpMultiply(minus, cached);
+    //乘法有1ulp的误差，收窄区间保证结果仍在边界内
+    Wm.f++;
+    Wp.f--;
+    DigitGen(W, Wp, Wp.f - Wm.f, buffer, len, K);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : FormatInteger
+* Description: 把非负整数写成十进制，返回写入的字符数
+-----------------------------------------------------------------------------*/
+static int FormatInteger(char *buffer, uint64_t n)
+{
+    char temp[20];
+    int len = 0, i;
+    do{
+        temp[len++] = (char)('0' + n % 10);
+        n /= 10;
+    }while(n != 0);
+    for(i = 0; i < len; i++)
+        buffer[i] = temp[len - 1 - i];
+    return len;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : FormatNumber
+* Description: 把double写成能精确解析回原值的最短十进制字符串
+    * 绝对值小于2^53的整数直接按整数输出
+    * 其余用Grisu2生成数字，输出格式和%.17g相同：十进制指数在[-4, 17)之内用小数形式，
+      否则用科学计数法，指数至少两位，如1.23e-20、1e+100
+    * 不经过sprintf，因此没有格式串解析的开销，也不受locale影响
+* Input      :
+    * d, double
+* Output     :
+    * buffer, 至少32字节，结果不以'\0'结尾
+* Return     : 写入的字符数，d是inf或nan时返回0，什么也不写
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int FormatNumber(char *buffer, double d)
+{
+    char digits[20];
+    char *p = buffer;
+    int len, K, kk, i;
+    uint64_t bits;
+
+    memcpy(&bits, &d, sizeof(bits));
+    //指数位全为1：inf、nan，交给Grisu2会得到看起来正常的有限数
+    if(((bits >> 52) & 0x7FF) == 0x7FF)
+        return 0;
+    if(bits >> 63){
+        *p++ = '-';
+        d = -d;
+    }
+    if(d < 9007199254740992.0 && d == (double)(uint64_t)d)
+        return (int)(p - buffer) + FormatInteger(p, (uint64_t)d);
+
+    Grisu2(d, digits, &len, &K);
+    kk = len + K;   //小数点的位置，值为0.digits * 10^kk
+    if(kk >= -3 && kk <= 17){
+        if(kk <= 0){
+            //0.00ddd
+            *p++ = '0';
+            *p++ = '.';
+            for(i = kk; i < 0; i++)
+                *p++ = '0';
+            memcpy(p, digits, len);
+            p += len;
+        }
+        else if(kk < len){
+            //dd.ddd
+            memcpy(p, digits, kk);
+            p += kk;
+            *p++ = '.';
+            memcpy(p, digits + kk, len - kk);
+            p += len - kk;
+        }
+        else{
+            //ddd00
+            memcpy(p, digits, len);
+            p += len;
+            for(i = len; i < kk; i++)
+                *p++ = '0';
+        }
+    }
+    else{
+        //d.ddde+XX
+        *p++ = digits[0];
+        if(len > 1){
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        *p++ = 'e';
+        kk--;
+        if(kk < 0){
+            *p++ = '-';
+            kk = -kk;
+        }
+        else
+            *p++ = '+';
+        if(kk < 10)
+            *p++ = '0';
+        p += FormatInteger(p, (uint64_t)kk);
+    }
+    return (int)(p - buffer);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : StringifyValue
+* Description: 从根节点开始深度优先遍历树的每个节点，生成JSON字符串
+    * 用显式栈记录所在的数组、对象和下一个元素，代替递归，很深的树也不会耗尽C的调用栈
+* Input      :
+    * v, JSON结构根节点
+* Output     :
+    * c, 生成的JSON字符串
+* Return     : 
+    * STRINGIFY_OK, 生成成功
+    * STRINGIFY_INVALID_NUMBER, 有inf或nan，c中是生成了一部分的内容
+    * STRINGIFY_INVALID_LAZY_VALUE, 按需解析的数组、对象展开失败，c中是生成了一部分的内容
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int StringifyValue(CJSONContext *c, const CJSONValue *v)
+{
+    CJSONWalk w;
+    CJSONWalkFrame *f;
+    STATS_STRINGIFY_BEGIN(c);
+    //StringifyExact的上下文没有分配器，只在嵌套很深时用到默认分配器
+    WalkInit(&w, (c->allocator != NULL) ? c->allocator : &defaultAllocator);
+    for(;;){
+        switch(v->type){
+            case TYPE_NULL : OUTS(c, "null", 4); break;
+            case TYPE_FALSE : OUTS(c, "false", 5); break;
+            case TYPE_TRUE : OUTS(c, "true", 4); break;
+            case TYPE_NUMBER : 
+                {
+                    //先格式化到局部缓冲区，栈上只占用实际的长度，StringifyInto依赖这一点
+                    char buffer[32];
+                    int length = FormatNumber(buffer, v->u.n);
+                    if(length == 0){
+                        WalkFree(&w);
+                        return STRINGIFY_INVALID_NUMBER;
+                    }
+                    OUTS(c, buffer, length);
+                    break;
+                }
+            case TYPE_STRING : StringifyString(c, STRING_PTR(v), STRING_LEN(v)); break;
+            case TYPE_ARRAY : 
+                MATERIALIZE(v);
+                if(VALUE_ERROR(v) != PARSE_OK){
+                    WalkFree(&w);
+                    return STRINGIFY_INVALID_LAZY_VALUE;
+                }
+                if(v->u.a.size == 0){
+                    OUTS(c, "[]", 2);
+                    break;
+                }
+                OUTC(c, '[');
+                WalkPush(&w, v);
+                v = &v->u.a.e[0];
+                continue;
+            case TYPE_OBJECT :
+                MATERIALIZE(v);
+                if(VALUE_ERROR(v) != PARSE_OK){
+                    WalkFree(&w);
+                    return STRINGIFY_INVALID_LAZY_VALUE;
+                }
+                if(v->u.o.size == 0){
+                    OUTS(c, "{}", 2);
+                    break;
+                }
+                OUTC(c, '{');
+                WalkPush(&w, v);
+                StringifyString(c, KEY_PTR(&v->u.o.m[0]), KEY_LEN(&v->u.o.m[0]));
+                OUTC(c, ':');
+                v = &v->u.o.m[0].v;
+                continue;
+        }
+        //一个值生成完，回到所在的数组、对象，直到找到下一个元素
+        for(;;){
+            if(w.depth == 0){
+                WalkFree(&w);
+                STATS_STRINGIFY_END(c);
+                return STRINGIFY_OK;
+            }
+            f = &w.frames[w.depth - 1];
+            f->i++;
+            if(f->v->type == TYPE_ARRAY){
+                if(f->i < f->v->u.a.size){
+                    OUTC(c, ',');
+                    v = &f->v->u.a.e[f->i];
+                    break;
+                }
+                OUTC(c, ']');
+            }
+            else{
+                if(f->i < f->v->u.o.size){
+                    //`,`、键、`:`
+                    OUTC(c, ',');
+                    StringifyString(c, KEY_PTR(&f->v->u.o.m[f->i]), KEY_LEN(&f->v->u.o.m[f->i]));
+                    OUTC(c, ':');
+                    v = &f->v->u.o.m[f->i].v;
+                    break;
+                }
+                OUTC(c, '}');
+            }
+            w.depth--;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : StringifyString
+* Description: 生成带引号的JSON字符串，'"'、'\\'和控制字符需要转义
+    * 用ScanStringRun找到下一个需要转义的字符，之前不需要转义的一段整块拷贝
+    * 没有转义字符的长字符串只需要一次扫描和一次拷贝
+* Input      :
+    * c, Json内容
+    * s, 字符串
+    * len, 字符串长度
+* Output     :
+* Return     : 
+* Others     : 
+    * '/'不需要转义，原样输出
+    * \b、\f、\n、\r、\t用简写，其他控制字符输出为\u00XX
+-----------------------------------------------------------------------------*/
+static void StringifyString(CJSONContext *c, const char *s, size_t len)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    const char *p = s, *end = s + len, *q;
+    char buf[6], *d;
+    size_t n;
+    unsigned int high = 0;     //生成时不需要
+    OUTC(c, '"');
+    for(;;){
+        q = ScanStringRun(p, end, &high);
+        OUTS(c, p, q - p);
+        if(q == end)
+            break;
+        //转义后最长6字节，栈上空间足够时直接写入，否则先写到buf再交给OutputWrite
+        d = (c->top + sizeof(buf) < c->size) ? c->stack + c->top : buf;
+        d[0] = '\\';
+        //ScanStringRun只会停在需要转义的字符上
+        d[1] = escapeTable[(unsigned char)*q];
+        n = 2;
+        if(d[1] == 'u'){
+            d[2] = d[3] = '0';
+            d[4] = hex[(unsigned char)*q >> 4];
+            d[5] = hex[(unsigned char)*q & 0xF];
+            n = 6;
+        }
+        if(d == buf)
+            OUTS(c, buf, n);
+        else
+            c->top += n;
+        p = q + 1;
+    }
+    OUTC(c, '"');
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : StringifiedStringLength
+* Description: 计算StringifyString生成的字节数，包括两边的引号
+* Input      :
+    * s, 字符串
+    * len, 字符串长度
+* Output     :
+* Return     : 生成的字节数
+* Others     : 
+-----------------------------------------------------------------------------*/
+static size_t StringifiedStringLength(const char *s, size_t len)
+{
+    const char *p = s, *end = s + len;
+    size_t n = len + 2;
+    unsigned int high = 0;
+    while((p = ScanStringRun(p, end, &high)) != end){
+        switch(*p){
+            case '\"': case '\\': case '\b': case '\f': case '\n': case '\r': case '\t':
+                n += 1;
+                break;
+            default:
+                n += 5;
+        }
+        p++;
+    }
+    return n;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : StringifiedValueLength
+* Description: 计算节点生成的JSON字符串的长度，和StringifyValue的输出一一对应，遍历方式也相同
+* Input      :
+    * v, JSON节点
+* Output     :
+    * length, 生成的字节数
+* Return     : 同StringifyValue
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int StringifiedValueLength(const CJSONValue *v, size_t *length)
+{
+    CJSONWalk w;
+    CJSONWalkFrame *f;
+    size_t len = 0;
+    char buffer[32];
+    int n;
+    WalkInit(&w, &defaultAllocator);
+    for(;;){
+        switch(v->type){
+            case TYPE_NULL : len += 4; break;
+            case TYPE_FALSE : len += 5; break;
+            case TYPE_TRUE : len += 4; break;
+            case TYPE_NUMBER :
+                if((n = FormatNumber(buffer, v->u.n)) == 0){
+                    WalkFree(&w);
+                    return STRINGIFY_INVALID_NUMBER;
+                }
+                len += (size_t)n;
+                break;
+            case TYPE_STRING : len += StringifiedStringLength(STRING_PTR(v), STRING_LEN(v)); break;
+            case TYPE_ARRAY :
+                MATERIALIZE(v);
+                if(VALUE_ERROR(v) != PARSE_OK){
+                    WalkFree(&w);
+                    return STRINGIFY_INVALID_LAZY_VALUE;
+                }
+                if(v->u.a.size == 0){
+                    len += 2;
+                    break;
+                }
+                //[]，元素之间的`,`
+                len += v->u.a.size + 1;
+                WalkPush(&w, v);
+                v = &v->u.a.e[0];
+                continue;
+            case TYPE_OBJECT :
+                MATERIALIZE(v);
+                if(VALUE_ERROR(v) != PARSE_OK){
+                    WalkFree(&w);
+                    return STRINGIFY_INVALID_LAZY_VALUE;
+                }
+                if(v->u.o.size == 0){
+                    len += 2;
+                    break;
+                }
+                //{}，成员之间的`,`，每个成员的键和`:`
+                len += v->u.o.size + 1 + StringifiedStringLength(KEY_PTR(&v->u.o.m[0]), KEY_LEN(&v->u.o.m[0])) + 1;
+                WalkPush(&w, v);
+                v = &v->u.o.m[0].v;
+                continue;
+        }
+        for(;;){
+            if(w.depth == 0){
+                WalkFree(&w);
+                *length = len;
+                return STRINGIFY_OK;
+            }
+            f = &w.frames[w.depth - 1];
+            f->i++;
+            if(f->v->type == TYPE_ARRAY && f->i < f->v->u.a.size){
+                v = &f->v->u.a.e[f->i];
+                break;
+            }
+            if(f->v->type == TYPE_OBJECT && f->i < f->v->u.o.size){
+                len += StringifiedStringLength(KEY_PTR(&f->v->u.o.m[f->i]), KEY_LEN(&f->v->u.o.m[f->i])) + 1;
+                v = &f->v->u.o.m[f->i].v;
+                break;
+            }
+            w.depth--;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : StringifyExact
+* Description: 把v生成到buf中，len是StringifiedValueLength算出的精确长度
+* Input      :
+    * v, JSON节点
+    * buf, 至少len字节的缓冲区
+    * len, 生成的字节数
+* Output     :
+    * buf, 生成的JSON字符串，不补'\0'
+* Return     : 
+* Others     : 
+    * 栈的容量比len多1时ContextPush永远不会扩展，所以不需要分配器
+-----------------------------------------------------------------------------*/
+static void StringifyExact(const CJSONValue *v, char *buf, size_t len)
+{
+    CJSONContext c;
+    c.allocator = NULL;
+    c.stack = buf;
+    c.size = len + 1;
+    c.top = 0;
+    c.write = NULL;
+    StringifyValue(&c, v);
+    assert(c.top == len);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : WalkInit/WalkPush/WalkFree
+* Description: 非递归遍历节点树的显式栈
+    * WalkPush进入数组或对象v，从第0个元素开始
+    * 嵌套不超过WALK_INIT_SIZE层时只使用内嵌的数组，不申请内存
+* Input      :
+    * w, 显式栈; allocator, 嵌套更深时使用的分配器; v, 有元素的数组或对象
+* Output     :
+* Return     : 
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void WalkInit(CJSONWalk *w, const CJSONAllocator *allocator)
+{
+    w->frames = w->stack;
+    w->depth = 0;
+    w->capacity = WALK_INIT_SIZE;
+    w->allocator = allocator;
+}
+
+static void WalkPush(CJSONWalk *w, const CJSONValue *v)
+{
+    if(w->depth == w->capacity){
+        w->capacity += w->capacity >> 1;
+        if(w->frames == w->stack){
+            w->frames = (CJSONWalkFrame *)MALLOC(w->allocator, w->capacity * sizeof(CJSONWalkFrame));
+            memcpy(w->frames, w->stack, sizeof(w->stack));
+        }
+        else
+            w->frames = (CJSONWalkFrame *)REALLOC(w->allocator, w->frames, w->capacity * sizeof(CJSONWalkFrame));
+    }
+    w->frames[w->depth].v = (CJSONValue *)v;
+    w->frames[w->depth].i = 0;
+    w->depth++;
+}
+
+static void WalkFree(CJSONWalk *w)
+{
+    if(w->frames != w->stack)
+        FREE(w->allocator, w->frames);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : CopyAlloc
+* Description: 为副本申请size字节，*block不为NULL时从*block中顺序切分
 * Input      :
-    * c, Json内容
+    * block, 在文档中复制时预先申请的整块内存，否则*block或者block本身为NULL
+    * size, 字节数
 * Output     :
-    * v, Json节点
-* Return     : 
-    * PARSE_OK, 解析成功
-    * PARSE_MISS_QUOTATION_MARK, 没有遇到结束"
+    * block, 切分后的剩余部分
+* Return     : 申请到的内存，从block切分时按DOCUMENT_ALIGN对齐
 * Others     : 
 -----------------------------------------------------------------------------*/
-static int ParseString(CJSONContext *c, CJSONValue *v)
+static void *CopyAlloc(char **block, size_t size)
 {
-    int ret;
-    char *s;
-    size_t len;
-    if((ret = ParseStringRaw(c, &s, &len)) == PARSE_OK)
-        SetString(v, s, len);
+    void *ret;
+    if(block == NULL || *block == NULL)
+        return MALLOC(&defaultAllocator, size);
+    ret = *block;
+    *block += DOCUMENT_ROUND(size);
     return ret;
 }
 
 /*-----------------------------------------------------------------------------
-* Function   : ParseArray
-* Description: 解析JSON数组
-* Input      : 
-    * c, Json内容
-    * v, Json节点
+* Function   : CopySize
+* Description: 计算CopyValueInDocument复制src需要的总字节数，和CopyTree的切分方式一致
+* Input      :
+    * src, 源节点
 * Output     :
-* Return     : 
-    * PARSE_OK, 解析成功
-    * PARSE_MISS_COMMA_OR_SQUARE_BRACKET
-* Others     : 
-
-array = %x5B ws [ value *(ws %x2C ws value) ] ws %x5D
+* Return     : 字节数，每一块都按DOCUMENT_ALIGN对齐
+* Others     : 按需解析的子树在这里展开
 -----------------------------------------------------------------------------*/
-static int ParseArray(CJSONContext *c, CJSONValue *v)
+static size_t CopySize(const CJSONValue *src)
 {
-    size_t size = 0;   //测试过程中遇到过因为未将size初始化导致错误！
-    size_t i = 0;
-    int ret;
-    EXPECT(c, '[');
-    ParseWhiteSpace(c);
-    if(*c->json == ']'){
-        c->json++;
-        v->type = TYPE_ARRAY;
-        v->u.a.size = 0;
-        v->u.a.e = NULL;
-        return PARSE_OK;
-    }
+    CJSONWalk w;
+    CJSONWalkFrame *f;
+    const CJSONValue *v = src;
+    size_t total = 0;
+    WalkInit(&w, &defaultAllocator);
     for(;;){
-        //在循环中建立一个临时值，然后调用ParseValue把元素解析到这个临时值
-        //然后把临时值压栈，当遇到]，把栈内的元素弹出，分配内存，生成数组值
-        CJSONValue e;
-        INIT_VALUE_NULL(&e);
-        if((ret = ParseValue(c, &e)) != PARSE_OK)
-            break;
-        //把e的内容压入栈
-        memcpy(ContextPush(c, sizeof(CJSONValue)), &e, sizeof(CJSONValue));
-        size++;
-        ParseWhiteSpace(c);
-        if(*c->json == ','){
-            c->json++;
-            ParseWhiteSpace(c);
+        MATERIALIZE(v);
+        //短字符串、短键存放在节点、成员内部，不占用额外的内存
+        if(v->type == TYPE_STRING){
+            if(STRING_LEN(v) > SHORT_STRING_MAX)
+                total += DOCUMENT_ROUND(STRING_LEN(v) + 1);
         }
-        else if(*c->json == ']'){
-            c->json++;
-            v->type = TYPE_ARRAY;
-            v->u.a.size = size;
-            size *= sizeof(CJSONValue);
-            memcpy(v->u.a.e = (CJSONValue *)malloc(size), ContextPop(c, size), size);
-            return PARSE_OK;
+        else if(v->type == TYPE_ARRAY && v->u.a.size > 0){
+            total += DOCUMENT_ROUND(v->u.a.size * sizeof(CJSONValue));
+            WalkPush(&w, v);
+            v = &v->u.a.e[0];
+            continue;
         }
-        else{
-            ret = PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
-            break;
+        else if(v->type == TYPE_OBJECT && v->u.o.size > 0){
+            total += DOCUMENT_ROUND(v->u.o.size * sizeof(CJSONMember));
+            if(v->u.o.size >= OBJECT_INDEX_THRESHOLD)
+                total += DOCUMENT_ROUND(ObjectIndexBytes(v->u.o.size));
+            if(KEY_LEN(&v->u.o.m[0]) > SHORT_KEY_MAX)
+                total += DOCUMENT_ROUND(KEY_LEN(&v->u.o.m[0]) + 1);
+            WalkPush(&w, v);
+            v = &v->u.o.m[0].v;
+            continue;
+        }
+        //回到所在的数组、对象，找到下一个元素
+        for(v = NULL; v == NULL && w.depth > 0; ){
+            f = &w.frames[w.depth - 1];
+            f->i++;
+            if(f->v->type == TYPE_ARRAY && f->i < f->v->u.a.size)
+                v = &f->v->u.a.e[f->i];
+            else if(f->v->type == TYPE_OBJECT && f->i < f->v->u.o.size){
+                if(KEY_LEN(&f->v->u.o.m[f->i]) > SHORT_KEY_MAX)
+                    total += DOCUMENT_ROUND(KEY_LEN(&f->v->u.o.m[f->i]) + 1);
+                v = &f->v->u.o.m[f->i].v;
+            }
+            else
+                w.depth--;
         }
+        if(v == NULL)
+            break;
     }
-    for(i = 0; i < size; i++)
-        FreeValue((CJSONValue *)ContextPop(c, sizeof(CJSONValue)));
-    return ret;
+    WalkFree(&w);
+    return total;
 }
 
 /*-----------------------------------------------------------------------------
-* Function   : ParseObject
-* Description: 解析JSON对象
-* Input      : 
-    * c, Json内容
-    * v, Json节点
+* Function   : StringInit
+* Description: 把len字节的字符串复制到字符串节点v中并补'\0'
+    * 不超过SHORT_STRING_MAX时直接存放在节点内，带上VALUE_FLAG_SHORT，否则用CopyAlloc申请
+* Input      :
+    * block, 同CopyAlloc
+    * s, 字符串，不能和v重叠; len, 字节数
 * Output     :
+    * v, type和其它标志位由调用方设置
 * Return     : 
-    * PARSE_OK, 解析成功
-    * PARSE_MISS_KEY, 没找到键
-    * PARSE_MISS_COLON, 没找到`:`
-    * PARSE_MISS_COMMA_OR_CURLY_BRACKET, 没解析到`,`或`}`
 * Others     : 
-
-member = string ws %3A ws value
-object = %x7B ws [ member *(ws %x2C ws member ) ] ws %x7D
 -----------------------------------------------------------------------------*/
-static int ParseObject(CJSONContext *c, CJSONValue *v)
+static void StringInit(CJSONValue *v, char **block, const char *s, size_t len)
 {
-    size_t i;
-    size_t size = 0;
-    CJSONMember m;
-    int ret;
-
-    EXPECT(c, '{');
-    ParseWhiteSpace(c);
-    if(*c->json == '}'){
-        c->json++;
-        v->type = TYPE_OBJECT;
-        v->u.o.m = NULL;
-        v->u.o.size = 0;
-        return PARSE_OK;
-    }
-    m.k = NULL;
-    for(;;){
-        char *str;
-        INIT_VALUE_NULL(&m.v);
-        //解析键
-        if(*c->json != '"'){
-            ret = PARSE_MISS_KEY;
-            break;
-        }
-        if((ret = ParseStringRaw(c, &str, &m.klen)) != PARSE_OK)
-            break;
-        memcpy(m.k = (char *)malloc(m.klen + 1), str, m.klen);
-        m.k[m.klen] = '\0';
-        //键和`:`之间可能有空格
-        ParseWhiteSpace(c);
-        if(*c->json != ':'){
-            ret = PARSE_MISS_COLON;
-            break;
-        }
-        c->json++;
-        //`:`和值之间可能有空格
-        ParseWhiteSpace(c);
-        //解析值
-        if((ret = ParseValue(c, &m.v)) != PARSE_OK)
-            break;
-        memcpy(ContextPush(c, sizeof(CJSONMember)), &m, sizeof(CJSONMember));
-        size++;
-        m.k = NULL;
-        //对象的第一个元素和第二个元素之间可能有空格
-        ParseWhiteSpace(c);
-        if(*c->json == ','){
-            c->json++;
-            ParseWhiteSpace(c);
-        }
-        else if(*c->json == '}'){
-            //解析到'}'说明解析完成，需要统计一共解析出来多少个元素
-            size_t s = sizeof(CJSONMember) * size;
-            c->json++;
-            v->type = TYPE_OBJECT;
-            v->u.o.size = size;
-            //将暂存在栈上的对象的元素拷贝给对象
-            memcpy(v->u.o.m = (CJSONMember *)malloc(s), ContextPop(c, s), s);
-            return PARSE_OK;
-        }
-        else{
-            ret = PARSE_MISS_COMMA_OR_CURLY_BRACKET;
-            break;
-        }
+    char *p;
+    if(len <= SHORT_STRING_MAX){
+        p = v->u.ss;
+        p[SHORT_STRING_MAX] = (char)(SHORT_STRING_MAX - len);
+        v->flags |= VALUE_FLAG_SHORT;
     }
-
-    //弹出并释放栈上的内存
-    free(m.k);
-    for(i = 0; i < size; i++){
-        CJSONMember *m = (CJSONMember *)ContextPop(c, sizeof(CJSONMember));
-        free(m->k);
-        FreeValue(&m->v);
+    else{
+        p = v->u.s.s = (char *)CopyAlloc(block, len + 1);
+        v->u.s.len = len;
+        v->flags &= ~VALUE_FLAG_SHORT;
     }
-    v->type = TYPE_NULL;
-    return ret;
+    if(len > 0)
+        memcpy(p, s, len);
+    p[len] = '\0';
 }
 
 /*-----------------------------------------------------------------------------
-* Function   : ParseValue
-* Description: 判断下一个字符是n、t、f、0-9/-、"、[、{，选择具体调用哪个解析方法
+* Function   : KeyInit
+* Description: 把klen字节的键复制到成员m中并补'\0'
+    * 不超过SHORT_KEY_MAX时直接存放在成员内，否则用CopyAlloc申请，标记为KEY_TAG_OWNED
 * Input      :
-    * c, Json内容
+    * block, 同CopyAlloc
+    * key, 键，不能和m重叠; klen, 字节数
 * Output     :
+    * m, 只改写键，不影响值
 * Return     : 
-    * PARSE_OK, 解析成功
-    * PARSE_INVALID_VALUE, 解析得到非法值
-    * PARSE_EXPECT_VALUE, 解析到结尾了，不能继续解析
 * Others     : 
 -----------------------------------------------------------------------------*/
-static int ParseValue(CJSONContext *c, CJSONValue *v)
+static void KeyInit(CJSONMember *m, char **block, const char *key, size_t klen)
 {
-    //这里return直接跳出，所以不再需要用break！
-    switch(*c->json){
-        case 'n'  : return ParseLiteral(c, v, "null", TYPE_NULL);
-        case 't'  : return ParseLiteral(c, v, "true", TYPE_TRUE);
-        case 'f'  : return ParseLiteral(c, v, "false", TYPE_FALSE);
-        case '0'  :
-        case '1'  :
-        case '2'  :
-        case '3'  :
-        case '4'  :
-        case '5'  :
-        case '6'  :
-        case '7'  :
-        case '8'  :
-        case '9'  :
-        case '-'  : return ParseNumber(c, v);
-        case '\"' : return ParseString(c, v);
-        case '['  : return ParseArray(c, v);
-        case '{'  : return ParseObject(c, v);
-        case '\0' : return PARSE_EXPECT_VALUE;
-        default   : return PARSE_INVALID_VALUE;
+    char *p;
+    if(klen <= SHORT_KEY_MAX){
+        p = m->key.s;
+        p[SHORT_KEY_MAX] = (char)(SHORT_KEY_MAX - klen);
+    }
+    else{
+        p = m->key.p.k = (char *)CopyAlloc(block, klen + 1);
+        m->key.p.klen = klen;
+        m->key.s[SHORT_KEY_MAX] = (char)KEY_TAG_OWNED;
     }
+    if(klen > 0)
+        memcpy(p, key, klen);
+    p[klen] = '\0';
 }
 
 /*-----------------------------------------------------------------------------
-* Function   : StringifyValue
-* Description: 递归从根节点开始广度搜索遍历树的每个节点，生成JSON字符串
+* Function   : CopyTree
+* Description: CopyValue、CopyValueInDocument的公共部分
+    * dst先浅复制src，然后遍历dst：数组、对象整体复制元素数组后进入下一层，
+    * 字符串、键替换成新的副本。dst中还没有替换的指针都指向src，所以只需要遍历dst
 * Input      :
-    * v, JSON结构根节点
+    * src, 源节点
+    * doc, 在文档中复制时为目标文档，否则为NULL
+    * block, 在文档中复制时是CopySize大小的整块内存，否则为NULL
 * Output     :
-    * c, 生成的JSON字符串
+    * dst, 副本，不需要初始化
 * Return     : 
-    * STRINGIFY_OK, 生成成功
 * Others     : 
 -----------------------------------------------------------------------------*/
-static int StringifyValue(CJSONContext *c, const CJSONValue *v)
+static void CopyTree(CJSONValue *dst, const CJSONValue *src, CJSONDocument *doc, char *block)
 {
-    size_t i;
-    switch(v->type){
-        case TYPE_NULL : PUTS(c, "null", 4); break;
-        case TYPE_FALSE : PUTS(c, "false", 5); break;
-        case TYPE_TRUE : PUTS(c, "true", 4); break;
-        case TYPE_NUMBER : 
-            {
-                char *buffer = ContextPush(c, 32);
-                int length = sprintf(buffer, "%.17g", v->u.n);
-                c->top -= (32-length);
-                break;
-            }
-        case TYPE_STRING : 
-            {
-                PUTC(c, '"');
-                PUTS(c, v->u.s.s, v->u.s.len);
-                PUTC(c, '"');
-                break;
+    CJSONWalk w;
+    CJSONWalkFrame *f;
+    CJSONValue *v = dst;
+    CJSONMember *m;
+    unsigned int flags = (doc != NULL) ? VALUE_FLAG_DOCUMENT : 0;
+    size_t bytes;
+    MATERIALIZE(src);
+    *dst = *src;
+    WalkInit(&w, &defaultAllocator);
+    for(;;){
+        //浅复制来的节点可能还没有展开，在副本上展开，内存来自src的文档，src本身不变
+        MATERIALIZE(v);
+        //短字符串、短键随浅复制一起复制完了，标志保留下来；展开失败的错误码也随副本保留
+        v->flags = (v->flags & (VALUE_FLAG_SHORT | VALUE_FLAGS_ERROR)) | flags;
+        if(v->type == TYPE_STRING && !(v->flags & VALUE_FLAG_SHORT))
+            StringInit(v, &block, v->u.s.s, v->u.s.len);
+        else if(v->type == TYPE_ARRAY){
+            v->u.a.capacity = v->u.a.size;
+            if(v->u.a.size > 0){
+                bytes = v->u.a.size * sizeof(CJSONValue);
+                v->u.a.e = (CJSONValue *)memcpy(CopyAlloc(&block, bytes), v->u.a.e, bytes);
+                WalkPush(&w, v);
+                v = &v->u.a.e[0];
+                continue;
             }
-        case TYPE_ARRAY : 
-            {
-                PUTC(c, '[');
-                for(i = 0; i < v->u.a.size; i++){
-                    StringifyValue(c, &v->u.a.e[i]);
-                    if(i != v->u.a.size - 1)
-                        PUTC(c, ',');
+            v->u.a.e = NULL;
+        }
+        else if(v->type == TYPE_OBJECT){
+            v->u.o.capacity = v->u.o.size;
+            v->u.o.index = NULL;
+            if(v->u.o.size > 0){
+                bytes = v->u.o.size * sizeof(CJSONMember);
+                m = v->u.o.m = (CJSONMember *)memcpy(CopyAlloc(&block, bytes), v->u.o.m, bytes);
+                //键还指向src，内容相同，可以直接用来建立索引
+                if(doc != NULL && v->u.o.size >= OBJECT_INDEX_THRESHOLD){
+                    bytes = ObjectIndexBytes(v->u.o.size);
+                    v->u.o.index = (CJSONObjectIndex *)CopyAlloc(&block, bytes);
+                    ObjectIndexFill(v->u.o.index, bytes, m, v->u.o.size);
                 }
-                PUTC(c, ']');
-                break;
+                if(KEY_TAG(m) > SHORT_KEY_MAX)
+                    KeyInit(m, &block, m->key.p.k, m->key.p.klen);
+                WalkPush(&w, v);
+                v = &m->v;
+                continue;
             }
-        case TYPE_OBJECT :
-            {
-                PUTC(c, '{');
-                for(i = 0; i < v->u.o.size; i++){
-                    //键
-                    PUTC(c, '"');
-                    PUTS(c, v->u.o.m[i].k, v->u.o.m[i].klen);
-                    PUTC(c, '"');
-                    //`:`
-                    PUTC(c, ':');
-                    //值
-                    StringifyValue(c, &v->u.o.m[i].v);
-                    //最后一个元素没有`,`
-                    if(i != v->u.o.size - 1)
-                        PUTC(c, ',');
-                }
-                PUTC(c, '}');
-                break;
+            v->u.o.m = NULL;
+        }
+        //回到所在的数组、对象，找到下一个元素
+        for(v = NULL; v == NULL && w.depth > 0; ){
+            f = &w.frames[w.depth - 1];
+            f->i++;
+            if(f->v->type == TYPE_ARRAY && f->i < f->v->u.a.size)
+                v = &f->v->u.a.e[f->i];
+            else if(f->v->type == TYPE_OBJECT && f->i < f->v->u.o.size){
+                m = &f->v->u.o.m[f->i];
+                if(KEY_TAG(m) > SHORT_KEY_MAX)
+                    KeyInit(m, &block, m->key.p.k, m->key.p.klen);
+                v = &m->v;
             }
+            else
+                w.depth--;
+        }
+        if(v == NULL)
+            break;
     }
-    return STRINGIFY_OK;
+    WalkFree(&w);
 }
 
 /*-----------------------------------------------------------------------------
@@ -886,10 +5961,12 @@ static void *ContextPush(CJSONContext *c, size_t size)
         while(c->top + size >= c->size)
             c->size += c->size >> 1;        //c->size * 1.5
         //在堆上扩容
-        c->stack = (char *)realloc(c->stack, c->size);
+        c->stack = (char *)REALLOC(c->allocator, c->stack, c->size);
+        STATS_ADD(stackReallocs, 1);
     }
     ret = c->stack + c->top;
     c->top += size;
+    STATS_PEAK(c);
     return ret;
 }
 
@@ -921,3 +5998,314 @@ static void *ContextPop(CJSONContext *c, size_t size)
     assert(c->top >= size);
     return c->stack + (c->top -= size);
 }
+
+/*-----------------------------------------------------------------------------
+* Function   : OutputFlush
+* Description: 把栈上已经生成的内容交给输出函数，然后清空栈
+* Input      :
+    * c, Json内容
+* Output     :
+* Return     : 
+* Others     : 
+    * 输出函数失败后只清空栈，不再调用输出函数，保证内存不会继续增长
+-----------------------------------------------------------------------------*/
+static void OutputFlush(CJSONContext *c)
+{
+    if(c->top > 0 && c->wret == STRINGIFY_OK && !c->write(c->wuser, c->stack, c->top))
+        c->wret = STRINGIFY_WRITE_ERROR;
+    STATS_ADD(stringifyBytes, c->top);
+    c->top = 0;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : OutputPush
+* Description: 生成JSON时在栈上申请size字节
+    * 没有输出函数时等同于ContextPush
+    * 有输出函数时，空间不足先把已有内容输出，腾出空间后再申请
+* Input      :
+    * c, Json内容
+    * size, 申请的字节数
+* Output     :
+* Return     : 申请到的空间的起始指针
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void *OutputPush(CJSONContext *c, size_t size)
+{
+    if(c->write != NULL && c->top + size >= c->size)
+        OutputFlush(c);
+    return ContextPush(c, size);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : OutputWrite
+* Description: 生成JSON时输出s开始的len字节
+    * 有输出函数且内容比缓冲区还大时，先输出缓冲区，再把s直接交给输出函数，不做拷贝
+* Input      :
+    * c, Json内容
+    * s, 输出的内容
+    * len, 字节数
+* Output     :
+* Return     : 
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void OutputWrite(CJSONContext *c, const char *s, size_t len)
+{
+    if(len == 0)
+        return;
+    if(c->write != NULL && c->top + len >= c->size){
+        OutputFlush(c);
+        if(len >= c->size){
+            if(c->wret == STRINGIFY_OK && !c->write(c->wuser, s, len))
+                c->wret = STRINGIFY_WRITE_ERROR;
+            STATS_ADD(stringifyBytes, len);
+            return;
+        }
+    }
+    memcpy(ContextPush(c, len), s, len);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : FileWrite
+* Description: StringifyToFile的输出函数
+* Input      :
+    * user, FILE指针
+    * buf, 输出的内容
+    * len, 字节数
+* Output     :
+* Return     : 全部写入返回1，否则返回0
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int FileWrite(void *user, const char *buf, size_t len)
+{
+    return fwrite(buf, 1, len, (FILE *)user) == len;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : FdWrite
+* Description: StringifyToFd的输出函数，处理部分写入和EINTR
+* Input      :
+    * user, 指向文件描述符
+    * buf, 输出的内容
+    * len, 字节数
+* Output     :
+* Return     : 全部写入返回1，否则返回0
+* Others     : 
+-----------------------------------------------------------------------------*/
+static int FdWrite(void *user, const char *buf, size_t len)
+{
+    int fd = *(const int *)user;
+    while(len > 0){
+#if defined(_WIN32)
+        int n = _write(fd, buf, (unsigned int)(len > 0x40000000 ? 0x40000000 : len));
+#else
+        ssize_t n = write(fd, buf, len);
+#endif
+        if(n < 0){
+            if(errno == EINTR)
+                continue;
+            return 0;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ContextAlloc
+* Description: 为解析出的节点申请内存，在文档中解析时从文档分配，否则使用分配器
+* Input      :
+    * c, Json内容
+    * size, 申请的字节数
+* Output     :
+* Return     : 申请到的内存
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void *ContextAlloc(CJSONContext *c, size_t size)
+{
+    if(c->doc != NULL)
+        return DocumentAlloc(c->doc, size);
+    return MALLOC(c->allocator, size);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ContextStrdup
+* Description: 复制len字节的字符串并在结尾补'\0'
+* Input      :
+    * c, Json内容
+    * s, 字符串
+    * len, 字符串长度
+* Output     :
+* Return     : 复制出的字符串
+* Others     : 
+-----------------------------------------------------------------------------*/
+static char *ContextStrdup(CJSONContext *c, const char *s, size_t len)
+{
+    char *p = (char *)ContextAlloc(c, len + 1);
+    if(len > 0)
+        memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : DocumentAlloc
+* Description: 从文档的当前块中切分size字节
+    * 当前块不够时申请一个新块作为当前块
+    * 超过DOCUMENT_CHUNK_SIZE的申请单独占用一个块，挂在当前块之后，不影响当前块继续切分
+* Input      :
+    * doc, 文档
+    * size, 申请的字节数
+* Output     :
+* Return     : 申请到的内存，按DOCUMENT_ALIGN对齐
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void *DocumentAlloc(CJSONDocument *doc, size_t size)
+{
+    CJSONChunk *chunk;
+    void *ret;
+    size = (size + DOCUMENT_ALIGN - 1) & ~(DOCUMENT_ALIGN - 1);
+    if((size_t)(doc->end - doc->cur) < size){
+        if(size > DOCUMENT_CHUNK_SIZE && doc->chunks != NULL){
+            chunk = (CJSONChunk *)MALLOC(&doc->allocator, sizeof(CJSONChunk) + size);
+            chunk->size = size;
+            chunk->next = doc->chunks->next;
+            doc->chunks->next = chunk;
+            return chunk + 1;
+        }
+        chunk = (CJSONChunk *)MALLOC(&doc->allocator, sizeof(CJSONChunk) + (size > DOCUMENT_CHUNK_SIZE ? size : DOCUMENT_CHUNK_SIZE));
+        chunk->size = size > DOCUMENT_CHUNK_SIZE ? size : DOCUMENT_CHUNK_SIZE;
+        chunk->next = doc->chunks;
+        doc->chunks = chunk;
+        doc->cur = (char *)(chunk + 1);
+        doc->end = doc->cur + chunk->size;
+    }
+    ret = doc->cur;
+    doc->cur += size;
+    return ret;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : DefaultAlloc/DefaultRealloc/DefaultFree
+* Description: 默认分配器，直接转调C标准库
+-----------------------------------------------------------------------------*/
+static void *DefaultAlloc(void *user, size_t size)
+{
+    (void)user;
+    return malloc(size);
+}
+
+static void *DefaultRealloc(void *user, void *p, size_t size)
+{
+    (void)user;
+    return realloc(p, size);
+}
+
+static void DefaultFree(void *user, void *p)
+{
+    (void)user;
+    free(p);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : HashKey
+* Description: FNV-1a哈希
+* Input      :
+    * key, 键
+    * klen, 键长度
+* Output     :
+* Return     : 哈希值
+* Others     : 
+-----------------------------------------------------------------------------*/
+static size_t HashKey(const char *key, size_t klen)
+{
+    size_t i;
+    unsigned long long h = 14695981039346656037ULL;
+    for(i = 0; i < klen; i++){
+        h ^= (unsigned char)key[i];
+        h *= 1099511628211ULL;
+    }
+    return (size_t)(h ^ (h >> 32));
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ContainerGrow
+* Description: 数组、对象追加元素时容量不够，计算扩展后的容量
+* Input      :
+    * capacity, 当前容量
+* Output     :
+* Return     : 新容量，当前容量的1.5倍，至少CONTAINER_INIT_SIZE
+* Others     : 
+-----------------------------------------------------------------------------*/
+static size_t ContainerGrow(size_t capacity)
+{
+    return (capacity < CONTAINER_INIT_SIZE) ? CONTAINER_INIT_SIZE : capacity + (capacity >> 1);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ObjectIndexBytes
+* Description: 计算size个成员的对象的索引需要的字节数
+* Input      :
+    * size, 成员个数
+* Output     :
+* Return     : 索引的字节数
+* Others     : 
+-----------------------------------------------------------------------------*/
+static size_t ObjectIndexBytes(size_t size)
+{
+    size_t slots = 1;
+    while(slots < size * 2)
+        slots <<= 1;
+    return sizeof(CJSONObjectIndex) + slots * sizeof(size_t);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ObjectIndexFill
+* Description: 把对象的所有成员插入索引，有重复键时只保留第一个
+* Input      :
+    * index, 索引
+    * bytes, ObjectIndexBytes计算出的字节数
+    * m, 成员数组
+    * size, 成员个数
+* Output     :
+* Return     : 
+* Others     : 
+-----------------------------------------------------------------------------*/
+static void ObjectIndexFill(CJSONObjectIndex *index, size_t bytes, const CJSONMember *m, size_t size)
+{
+    size_t i, j;
+    index->mask = (bytes - sizeof(CJSONObjectIndex)) / sizeof(size_t) - 1;
+    memset(index->slots, 0, (index->mask + 1) * sizeof(size_t));
+    for(i = 0; i < size; i++){
+        for(j = HashKey(KEY_PTR(&m[i]), KEY_LEN(&m[i])) & index->mask; index->slots[j] != 0; j = (j + 1) & index->mask){
+            const CJSONMember *e = &m[index->slots[j] - 1];
+            if(KEY_LEN(e) == KEY_LEN(&m[i]) && memcmp(KEY_PTR(e), KEY_PTR(&m[i]), KEY_LEN(e)) == 0)
+                break;
+        }
+        if(index->slots[j] == 0)
+            index->slots[j] = i + 1;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : ObjectIndexFind
+* Description: 在索引中查找键
+* Input      :
+    * index, 索引
+    * m, 成员数组
+    * key, 键
+    * klen, 键长度
+* Output     :
+* Return     : 成员的下标，找不到返回KEY_NOT_EXIST
+* Others     : 
+-----------------------------------------------------------------------------*/
+static size_t ObjectIndexFind(const CJSONObjectIndex *index, const CJSONMember *m, const char *key, size_t klen)
+{
+    size_t j;
+    for(j = HashKey(key, klen) & index->mask; index->slots[j] != 0; j = (j + 1) & index->mask){
+        const CJSONMember *e = &m[index->slots[j] - 1];
+        if(KEY_LEN(e) == klen && memcmp(KEY_PTR(e), key, klen) == 0)
+            return index->slots[j] - 1;
+    }
+    return KEY_NOT_EXIST;
+}
@@ -10,13 +10,21 @@
 #ifndef CJSON_H
 #define CJSON_H
 
+#include <stdio.h>   /* FILE */
 #include "cJsonStruct.h"
 
 //因为需要检查JSON节点的类型，所以需要在创建时对其初始化
-#define INIT_VALUE_NULL(v)   do { (v)->type = TYPE_NULL; } while(0)
+#define INIT_VALUE_NULL(v)   do { (v)->type = TYPE_NULL; (v)->flags = 0; } while(0)
 #define SET_VALUE_NULL(v)    FreeValue(v)
 
+//FindObjectIndex找不到键时的返回值
+#define KEY_NOT_EXIST        ((size_t)-1)
+//StringifiedLength无法生成时的返回值，原因和Stringify的错误码相同
+#define INVALID_LENGTH       ((size_t)-1)
+
 int Parse(CJSONValue *v, const char *json);
+int ParseN(CJSONValue *v, const char *json, size_t len);
+int ParseInsitu(CJSONValue *v, char *json);
 int Stringify(const CJSONValue *v, char **json, size_t *length);
 CJSONType GetType(const CJSONValue *v);
 int GetBoolean(const CJSONValue *v);
@@ -32,6 +40,92 @@ size_t GetObjectSize(const CJSONValue *v);
 const char *GetObjectKey(const CJSONValue *v, size_t index);
 size_t GetObjectKeyLength(const CJSONValue *v, size_t index);
 CJSONValue *GetObjectValue(const CJSONValue *v, size_t index);
+size_t FindObjectIndex(CJSONValue *v, const char *key, size_t klen);
+CJSONValue *FindObjectValue(CJSONValue *v, const char *key, size_t klen);
 void FreeValue(CJSONValue *v);
 
+void SetArray(CJSONValue *v, size_t capacity);
+size_t GetArrayCapacity(const CJSONValue *v);
+void ReserveArray(CJSONValue *v, size_t capacity);
+void ShrinkArray(CJSONValue *v);
+void ClearArray(CJSONValue *v);
+CJSONValue *PushBackArrayElement(CJSONValue *v);
+void PopBackArrayElement(CJSONValue *v);
+CJSONValue *InsertArrayElement(CJSONValue *v, size_t index);
+void EraseArrayElement(CJSONValue *v, size_t index, size_t count);
+void SetObject(CJSONValue *v, size_t capacity);
+size_t GetObjectCapacity(const CJSONValue *v);
+void ReserveObject(CJSONValue *v, size_t capacity);
+void ShrinkObject(CJSONValue *v);
+void ClearObject(CJSONValue *v);
+CJSONValue *SetObjectValue(CJSONValue *v, const char *key, size_t klen);
+void RemoveObjectValue(CJSONValue *v, size_t index);
+void MoveValue(CJSONValue *dst, CJSONValue *src);
+void SwapValue(CJSONValue *a, CJSONValue *b);
+void CopyValue(CJSONValue *dst, const CJSONValue *src);
+void CopyValueInDocument(CJSONDocument *doc, CJSONValue *dst, const CJSONValue *src);
+
+/*
+节点不记录自己是用哪个分配器申请的：SetString、SetArray、PushBackArrayElement、SetObjectValue、
+CopyValue等修改节点树的函数，以及它们内部对旧值的释放，总是使用默认分配器(SetAllocator)。
+用ParseWithAllocator等指定了分配器的树只能读取和用FreeValueWithAllocator整体释放，不能再修改，
+否则树中混有两个分配器的内存；需要修改时用SetAllocator把同一个分配器设为默认分配器
+*/
+void SetAllocator(const CJSONAllocator *allocator);
+const CJSONAllocator *GetAllocator(void);
+int ParseWithAllocator(CJSONValue *v, const char *json, const CJSONAllocator *allocator);
+int StringifyWithAllocator(const CJSONValue *v, char **json, size_t *length, const CJSONAllocator *allocator);
+int StringifyToWriter(const CJSONValue *v, CJSONWriteFunc write, void *user);
+int StringifyToFile(const CJSONValue *v, FILE *fp);
+int StringifyToFd(const CJSONValue *v, int fd);
+size_t StringifiedLength(const CJSONValue *v);
+int StringifyInto(const CJSONValue *v, char *buf, size_t cap, size_t *length);
+void FreeValueWithAllocator(CJSONValue *v, const CJSONAllocator *allocator);
+
+void InitDocument(CJSONDocument *doc);
+void InitDocumentWithAllocator(CJSONDocument *doc, const CJSONAllocator *allocator);
+void ClearDocument(CJSONDocument *doc);
+void FreeDocument(CJSONDocument *doc);
+int ParseInDocument(CJSONDocument *doc, CJSONValue *v, const char *json);
+/*
+按需解析的树在第一次访问时展开，GetArraySize等只读的访问函数、生成JSON也会修改节点，
+多个线程同时读取同一棵按需解析的树是不安全的，共享前先用MaterializeValue展开
+*/
+int ParseLazyInDocument(CJSONDocument *doc, CJSONValue *v, const char *json);
+int MaterializeValue(CJSONValue *v);
+int ParseParallelInDocument(CJSONDocument *doc, CJSONValue *v, const char *json, size_t threads);
+int ParseLines(const char *json, size_t len, size_t threads, CJSONLineFunc callback, void *user);
+
+int ParseWithHandler(const char *json, const CJSONHandler *handler);
+
+void InitTape(CJSONTape *tape);
+void InitTapeWithAllocator(CJSONTape *tape, const CJSONAllocator *allocator);
+void FreeTape(CJSONTape *tape);
+int ParseTape(CJSONTape *tape, const char *json);
+CJSONType GetTapeType(const CJSONTape *tape, size_t i);
+int GetTapeBoolean(const CJSONTape *tape, size_t i);
+double GetTapeNumber(const CJSONTape *tape, size_t i);
+const char *GetTapeString(const CJSONTape *tape, size_t i);
+size_t GetTapeStringLength(const CJSONTape *tape, size_t i);
+size_t GetTapeArraySize(const CJSONTape *tape, size_t i);
+size_t GetTapeArrayElement(const CJSONTape *tape, size_t i, size_t index);
+size_t GetTapeObjectSize(const CJSONTape *tape, size_t i);
+const char *GetTapeObjectKey(const CJSONTape *tape, size_t i, size_t index);
+size_t GetTapeObjectKeyLength(const CJSONTape *tape, size_t i, size_t index);
+size_t GetTapeObjectValue(const CJSONTape *tape, size_t i, size_t index);
+size_t FindTapeObjectValue(const CJSONTape *tape, size_t i, const char *key, size_t klen);
+size_t GetTapeNext(const CJSONTape *tape, size_t i);
+
+CJSONParser *ParserCreate(void);
+void ParserSetHandler(CJSONParser *p, const CJSONHandler *handler);
+int ParserFeed(CJSONParser *p, const char *buf, size_t len);
+int ParserFinish(CJSONParser *p, CJSONValue *v);
+int ParserParse(CJSONParser *p, CJSONValue *v, const char *json, size_t len);
+void ParserReset(CJSONParser *p);
+void ParserShrink(CJSONParser *p, size_t size);
+void ParserDestroy(CJSONParser *p);
+
+void GetStats(CJSONStats *stats);
+void ResetStats(void);
+
 #endif
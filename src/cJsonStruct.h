@@ -23,31 +23,183 @@ typedef enum{
 
 typedef struct CJSONValue CJSONValue;
 typedef struct CJSONMember CJSONMember;
+typedef struct CJSONChunk CJSONChunk;
+typedef struct CJSONObjectIndex CJSONObjectIndex;
+//按需解析时输入的结构索引，内部结构不公开，和节点一起从文档中分配
+typedef struct CJSONLazy CJSONLazy;
+//增量解析器，内部结构不公开，通过ParserCreate/ParserDestroy创建和销毁
+typedef struct CJSONParser CJSONParser;
+
+//节点标志位，记录节点持有的内存该如何释放
+enum {
+    VALUE_FLAG_DOCUMENT = 0x1,          //节点的内存属于某个CJSONDocument，FreeValue不释放，释放后仍保留该标志
+    VALUE_FLAG_BORROWED = 0x2,          //字符串指向调用方的缓冲区(原位解析)，FreeValue不释放
+    VALUE_FLAG_LAZY = 0x8,              //数组或对象还没有展开，u.l记录它在输入中的位置，第一次访问时再解析
+    VALUE_FLAG_SHORT = 0x10             //短字符串直接存放在节点的u.ss中，没有单独申请内存
+};
+//按需解析的数组、对象展开失败时，错误码记在flags的这一位及以上，节点成为空的数组、对象
+#define VALUE_ERROR_SHIFT 8
+
+/*
+短字符串：内容连同结尾的'\0'直接存放在节点或成员里，最后一个字节记录最大长度减去实际长度，
+长度达到最大值时这个字节正好是0，兼做结尾的'\0'。64位平台上字符串最长31字节、键最长23字节
+*/
+#define SHORT_STRING_SIZE (4 * sizeof(size_t))
+#define SHORT_STRING_MAX  (SHORT_STRING_SIZE - 1)
+#define SHORT_KEY_SIZE    (3 * sizeof(size_t))
+#define SHORT_KEY_MAX     (SHORT_KEY_SIZE - 1)
+
+//解析选项
+enum {
+    PARSE_FLAG_INSITU = 0x1,            //原位解析：字符串直接在输入缓冲区中解码，节点引用缓冲区
+    PARSE_FLAG_LAZY = 0x2,              //按需解析：嵌套的数组、对象只记录位置，不递归解析
+    PARSE_FLAG_EXPAND = 0x4             //和PARSE_FLAG_LAZY一起使用：最外层的数组、对象直接解析，用于展开按需解析的节点
+};
 
 //JSON的数据结构
 struct CJSONValue{
     CJSONType type;
+    unsigned int flags;    //节点标志位，放在type之后的填充空间里，不增加结构体大小
     //一个JSON节点不可能同时为数字和字符串，可以使用union来节省内存
     union{
-        //object
-        struct { CJSONMember *m; size_t size; } o;
-        //array: 第一个元素的指针, 元素的个数
-        struct {CJSONValue *e; size_t  size;} a;
-        //string: 字符串指针, 字符串长度
+        //object: 成员数组, 成员个数, 按键查找用的哈希索引(没有建立时为NULL), 成员数组的容量
+        struct { CJSONMember *m; size_t size; CJSONObjectIndex *index; size_t capacity; } o;
+        //array: 第一个元素的指针, 元素的个数, 元素数组的容量
+        struct {CJSONValue *e; size_t  size; size_t capacity;} a;
+        //string: 字符串指针, 字符串长度；短字符串不在这里，直接读取会得到错误的内容，用GetString、GetStringLength
     	struct{ char *s; size_t len;} s;
+        //带VALUE_FLAG_SHORT的string: 字符串内容
+        char ss[SHORT_STRING_SIZE];
         //number
     	double n;
+        //还没有展开的array、object: 结构索引, 在输入中的起点, 在结构索引中的序号
+        struct { CJSONLazy *lazy; const char *json; size_t index; } l;
     }u;
 };
 
+/*
+对象成员：键的最后一个字节是标记，不超过SHORT_KEY_MAX时是短键，记法同短字符串，
+否则p指向键，标记说明这块内存是否借用调用方的缓冲区。标记属于成员，改写、重新解析值都不影响键
+原来的k、klen字段已经没有了，键用GetObjectKey、GetObjectKeyLength读取
+*/
 struct CJSONMember{
-    char *k;       //键
-    size_t klen;   //键长度
+    union{
+        struct{ char *k; size_t klen; } p;  //键, 键长度
+        char s[SHORT_KEY_SIZE];             //短键的内容
+    }key;
     CJSONValue v;  //值
 };
 
+/*
+内存分配器：cJson内部所有的内存申请、扩展、释放都通过分配器完成
+    * alloc, 申请size字节
+    * realloc, 扩展p为size字节，p为NULL时等同于alloc
+    * free, 释放p，cJson保证不会传入NULL
+    * user, 原样传给上面三个函数，可用于指向内存池、统计信息等
+*/
+typedef struct{
+    void *(*alloc)(void *user, size_t size);
+    void *(*realloc)(void *user, void *p, size_t size);
+    void (*free)(void *user, void *p);
+    void *user;
+}CJSONAllocator;
+
+/*
+文档对象：内部是一个按块分配的bump分配器
+在文档中解析时所有的节点、键、字符串都从块中顺序切分，不再逐个malloc
+释放时直接释放所有的块，和节点个数无关
+*/
+typedef struct{
+    CJSONChunk *chunks;       //块链表，表头是当前正在切分的块
+    char *cur;                //当前块的可用位置
+    char *end;                //当前块的结尾
+    CJSONAllocator allocator; //申请内存块使用的分配器
+    char *stack;              //按需解析展开子树时复用的解析栈，FreeDocument时释放
+    size_t ssize;             //解析栈的容量
+}CJSONDocument;
+
+/*
+磁带(tape)：解析结果的只读扁平表示，所有的值依次存放在一个64位字的数组中
+    * 每个字的高8位是类型标记，低56位是内容，值用它在words中的下标表示，根节点的下标是0
+    * null、true、false占1个字；数值占2个字，第2个字是double的二进制表示
+    * 字符串和键占2个字，第1个字的内容是在strings中的偏移，第2个字是长度，strings中的内容以'\0'结尾
+    * 数组、对象的开始字记录结束字之后的下标，可以O(1)跳过整个子树；结束字记录元素个数
+    * 对象的内容是键、值交替出现
+*/
+typedef struct{
+    unsigned long long *words;   //磁带
+    size_t size;                 //已使用的字数
+    size_t capacity;             //words的容量
+    char *strings;               //字符串区
+    size_t slen;                 //字符串区已使用的字节数
+    size_t scapacity;            //字符串区的容量
+    size_t open;                 //解析时最内层还没有结束的数组或对象的开始字下标
+    CJSONAllocator allocator;    //磁带和字符串区使用的分配器
+}CJSONTape;
+
+/*
+SAX事件处理函数：解析器每识别出一个语法单元就调用对应的回调，不建立节点树
+    * 回调返回非0继续解析，返回0中止解析，解析函数返回PARSE_TERMINATED
+    * 回调为NULL时忽略该事件
+    * string、key收到的字符串只在回调期间有效，不保证以'\0'结尾，需要保留时自行复制
+    * endObject、endArray收到的是该对象的成员个数、该数组的元素个数
+    * user, 原样传给所有回调
+*/
+typedef struct{
+    int (*null)(void *user);
+    int (*boolean)(void *user, int b);
+    int (*number)(void *user, double n);
+    int (*string)(void *user, const char *s, size_t len);
+    int (*startObject)(void *user);
+    int (*key)(void *user, const char *k, size_t klen);
+    int (*endObject)(void *user, size_t size);
+    int (*startArray)(void *user);
+    int (*endArray)(void *user, size_t size);
+    void *user;
+}CJSONHandler;
+
+/*
+流式生成JSON时的输出函数：内部缓冲区写满时，把buf开始的len字节交给它
+    * 返回非0表示写入成功，返回0表示写入失败，生成函数返回STRINGIFY_WRITE_ERROR
+    * user, 原样传给输出函数
+*/
+typedef int (*CJSONWriteFunc)(void *user, const char *buf, size_t len);
+
+/*
+批量解析NDJSON时每一行的回调，按行的顺序在调用ParseLines的线程中调用
+    * line, 行号，从1开始，空行不回调但占用行号
+    * ret, 这一行的解析结果，不是PARSE_OK时v是null
+    * v, 这一行解析出的节点，只在回调期间有效，需要保留时应复制出来
+    * 返回非0继续，返回0时ParseLines停止并返回PARSE_TERMINATED
+*/
+typedef int (*CJSONLineFunc)(void *user, size_t line, int ret, const CJSONValue *v);
+
+/*
+解析、生成的统计信息，编译cJson.c时定义CJSON_STATS才会收集，否则GetStats得到的全是0
+    * 统计按线程累计，并行解析时其他工作线程的解析记在各自的线程上
+    * 节点数只统计建立节点树时的节点，SAX处理函数和磁带不建立节点
+    * 增量解析(ParserFeed/ParserFinish)只统计个数、字节数、节点数和嵌套层数
+    * 周期数在x86上是rdtsc的计数，其他平台是纳秒
+*/
+typedef struct{
+    size_t parses;                      //解析的JSON文本个数
+    size_t parseBytes;                  //解析消耗的输入字节数，出错时算到出错的位置
+    size_t nodes[TYPE_OBJECT + 1];      //建立的各类型节点数，下标是CJSONType，对象的键不算节点
+    size_t keys;                        //建立的对象成员数
+    size_t stringBytes;                 //复制到节点中的字符串和键的字节数，原位解析不复制
+    size_t maxDepth;                    //数组、对象的最大嵌套层数
+    size_t parseStackPeak;              //解析时CJSONContext栈的最大使用量(字节)，可以用来确定STACK_INIT_SIZE
+    size_t stackReallocs;               //ContextPush扩展栈的次数，解析和生成合计
+    unsigned long long parseCycles;     //解析耗费的周期数
+    size_t stringifies;                 //生成的JSON文本个数
+    size_t stringifyBytes;              //生成的字节数
+    size_t stringifyStackPeak;          //生成时栈的最大使用量(字节)，流式生成时不超过输出缓冲区
+    unsigned long long stringifyCycles; //生成耗费的周期数
+}CJSONStats;
+
 typedef struct{
     const char *json;
+    const char *end;          //输入的结尾，解析时所有的边界检查都和它比较，不依赖'\0'
     /*
     解析字符串时，需要把解析的结果先存储在一个临时缓冲区
     最后再用SetString把缓冲区的结果设置进值之中
@@ -58,6 +210,16 @@ typedef struct{
     char *stack;
     size_t size;              //当前堆栈容量
     size_t top;               //栈顶位置，因为会扩展stack 
+    const CJSONAllocator *allocator;  //栈和节点内存使用的分配器
+    CJSONDocument *doc;       //不为NULL时，节点内存从文档中分配
+    unsigned int vflags;      //解析出的节点需要带上的标志位
+    unsigned int pflags;      //解析选项，PARSE_FLAG_*
+    const CJSONHandler *handler;  //语法分析产生的事件交给它处理，建立节点树时是内部的DOM处理函数
+    CJSONWriteFunc write;     //生成JSON时的输出函数，为NULL时结果全部留在栈上
+    void *wuser;              //传给输出函数的user
+    int wret;                 //输出函数是否失败过，失败后不再调用输出函数
+    CJSONLazy *lazy;          //按需解析时的结构索引
+    size_t ordinal;           //按需解析时下一个数组或对象在结构索引中的序号
 }CJSONContext;
 
 //Parse函数的返回值枚举
@@ -77,7 +239,18 @@ enum {
     PARSE_MISS_COMMA_OR_CURLY_BRACKET,
 
     //生成器相关
-    STRINGIFY_OK
+    STRINGIFY_OK = 12,
+
+    //之后增加的返回值只能追加在末尾，不改变已有的值
+    PARSE_TERMINATED,                   //SAX处理函数返回0中止了解析
+    PARSE_INVALID_UNICODE_HEX,          //\u之后不是4位十六进制数
+    PARSE_INVALID_UNICODE_SURROGATE,    //高代理项之后没有低代理项，或者单独出现低代理项
+    PARSE_INVALID_UTF8,                 //字符串中有不合法的UTF-8序列
+    PARSE_DEPTH_EXCEEDED,               //数组、对象嵌套超过PARSE_MAX_DEPTH层
+    STRINGIFY_WRITE_ERROR,              //输出函数返回0，写入失败
+    STRINGIFY_BUFFER_TOO_SMALL,         //调用方提供的缓冲区放不下生成的JSON
+    STRINGIFY_INVALID_NUMBER,           //数值是inf或nan，JSON中没有对应的表示
+    STRINGIFY_INVALID_LAZY_VALUE        //按需解析的数组、对象展开失败，错误码用MaterializeValue得到
 };
 
 #endif
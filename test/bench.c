@@ -0,0 +1,1093 @@
+/*********************************************************************************
+ * Copyright(C), xumenger
+ * FileName     : bench.c
+ * Author       : xumenger
+ * Version      : V1.0.0
+ * Date         : 2017-08-09
+ * Description  :
+     1.cJson的性能测试
+     2.通过SetAllocator安装计数分配器，统计cJson内部的内存分配次数
+     3.bench suite在标准语料上测试吞吐量、内存分配次数和延迟分位数，输出CSV
+**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/cJsonStruct.h"
+#include "../src/cJson.h"
+
+//统计cJson内部alloc/realloc/free的调用次数
+static size_t alloc_count = 0;
+static size_t free_count = 0;
+
+static void *CountingAlloc(void *user, size_t size){
+    alloc_count++;
+    return malloc(size);
+}
+
+static void *CountingRealloc(void *user, void *p, size_t size){
+    alloc_count++;
+    return realloc(p, size);
+}
+
+static void CountingFree(void *user, void *p){
+    free_count++;
+    free(p);
+}
+
+static const CJSONAllocator countingAllocator = { CountingAlloc, CountingRealloc, CountingFree, NULL };
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : GenerateRecords
+* Description: 生成一个由若干小对象组成的数组，大小约为size字节
+-----------------------------------------------------------------------------*/
+static char *GenerateRecords(size_t size){
+    char *json = (char *)malloc(size + 512);
+    size_t len = 0;
+    int i = 0;
+    json[len++] = '[';
+    while(len < size){
+        if(i > 0)
+            json[len++] = ',';
+        len += sprintf(json + len,
+            "{\"id\":%d,\"name\":\"user_%d\",\"email\":\"user_%d@example.com\","
+            "\"score\":%d.%d,\"tags\":[\"alpha\",\"beta\"],\"active\":%s}",
+            i, i, i, i * 7 % 1000, i % 10, (i & 1) ? "true" : "false");
+        i++;
+    }
+    json[len++] = ']';
+    json[len] = '\0';
+    return json;
+}
+
+static void bench_parse_document(){
+    const int iterations = 200;
+    char *json = GenerateRecords(200 * 1024);
+    size_t length = strlen(json);
+    CJSONDocument doc;
+    CJSONValue v;
+    size_t allocs, frees;
+    double start, heap, arena;
+    int i;
+
+    INIT_VALUE_NULL(&v);
+    alloc_count = free_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        Parse(&v, json);
+        FreeValue(&v);
+    }
+    heap = now() - start;
+    allocs = alloc_count;
+    frees = free_count;
+    printf("parse+free (heap)     : %8.2f MB/s, %8.1f allocs/parse, %8.1f frees/parse\n",
+        length * iterations / heap / 1e6, (double)allocs / iterations, (double)frees / iterations);
+
+    InitDocument(&doc);
+    alloc_count = free_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        ParseInDocument(&doc, &v, json);
+        ClearDocument(&doc);
+    }
+    arena = now() - start;
+    allocs = alloc_count;
+    frees = free_count;
+    FreeDocument(&doc);
+    printf("parse+free (document) : %8.2f MB/s, %8.1f allocs/parse, %8.1f frees/parse\n",
+        length * iterations / arena / 1e6, (double)allocs / iterations, (double)frees / iterations);
+    free(json);
+}
+
+static int CountValue(void *user){
+    (*(size_t *)user)++;
+    return 1;
+}
+
+static int CountNumber(void *user, double n){
+    return CountValue(user);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_parse_handler
+* Description: 只统计数值个数的SAX解析，和建立节点树的解析对比
+-----------------------------------------------------------------------------*/
+static void bench_parse_handler(){
+    const int iterations = 200;
+    char *json = GenerateRecords(200 * 1024);
+    size_t length = strlen(json), count = 0;
+    CJSONHandler handler = { NULL, NULL, CountNumber, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    double start, elapsed;
+    int i;
+
+    handler.user = &count;
+    alloc_count = free_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++)
+        ParseWithHandler(json, &handler);
+    elapsed = now() - start;
+    printf("parse (handler)       : %8.2f MB/s, %8.1f allocs/parse, %u numbers\n",
+        length * iterations / elapsed / 1e6, (double)alloc_count / iterations, (unsigned)(count / iterations));
+    free(json);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_parser_feed
+* Description: 把输入切成固定大小的块交给增量解析器，模拟从网络上陆续收到数据
+-----------------------------------------------------------------------------*/
+static void bench_parser_feed(){
+    static const size_t chunks[] = { 64, 1024, 16384 };
+    const int iterations = 200;
+    char *json = GenerateRecords(200 * 1024);
+    size_t length = strlen(json), n, i;
+    CJSONParser *p = ParserCreate();
+    CJSONValue v;
+    double start, elapsed;
+    int k;
+
+    for(n = 0; n < sizeof(chunks) / sizeof(chunks[0]); n++){
+        start = now();
+        for(k = 0; k < iterations; k++){
+            for(i = 0; i < length; i += chunks[n])
+                ParserFeed(p, json + i, (length - i < chunks[n]) ? length - i : chunks[n]);
+            ParserFinish(p, &v);
+            FreeValue(&v);
+        }
+        elapsed = now() - start;
+        printf("parser feed (%5u-byte chunks): %8.2f MB/s\n", (unsigned)chunks[n], length * iterations / elapsed / 1e6);
+    }
+    ParserDestroy(p);
+    free(json);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_find_object_value
+* Description: 对比顺序比较键和FindObjectValue在不同大小对象上的查找耗时
+-----------------------------------------------------------------------------*/
+static void bench_find_object_value(){
+    static const size_t sizes[] = { 4, 16, 64, 256, 1024, 4096 };
+    const size_t lookups = 1 << 20;
+    size_t n, i, j, hit;
+    for(n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++){
+        size_t size = sizes[n];
+        char *json = (char *)malloc(size * 32 + 2);
+        char (*keys)[16] = malloc(size * sizeof(*keys));
+        size_t len = 0;
+        double start, linear, indexed;
+        CJSONValue v;
+        json[len++] = '{';
+        for(i = 0; i < size; i++){
+            sprintf(keys[i], "field_%u", (unsigned)i);
+            len += sprintf(json + len, "%s\"%s\":%u", i ? "," : "", keys[i], (unsigned)i);
+        }
+        json[len++] = '}';
+        json[len] = '\0';
+        INIT_VALUE_NULL(&v);
+        Parse(&v, json);
+
+        hit = 0;
+        start = now();
+        for(i = 0; i < lookups; i++){
+            const char *key = keys[(i * 7919) % size];
+            size_t klen = strlen(key);
+            for(j = 0; j < size; j++)
+                if(GetObjectKeyLength(&v, j) == klen && memcmp(GetObjectKey(&v, j), key, klen) == 0){
+                    hit++;
+                    break;
+                }
+        }
+        linear = now() - start;
+
+        start = now();
+        for(i = 0; i < lookups; i++){
+            const char *key = keys[(i * 7919) % size];
+            if(FindObjectValue(&v, key, strlen(key)) != NULL)
+                hit++;
+        }
+        indexed = now() - start;
+        printf("lookup in %5u members : linear %8.1f ns, FindObjectValue %6.1f ns (%u hits)\n", (unsigned)size,
+            linear / lookups * 1e9, indexed / lookups * 1e9, (unsigned)hit);
+        FreeValue(&v);
+        free(keys);
+        free(json);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : GenerateStrings
+* Description: 生成一个由长字符串组成的数组，模拟日志消息和base64数据，大小约为size字节
+-----------------------------------------------------------------------------*/
+static char *GenerateStrings(size_t size){
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *json = (char *)malloc(size + 4096);
+    size_t len = 0;
+    unsigned int seed = 1;
+    int i = 0, j;
+    json[len++] = '[';
+    while(len < size){
+        if(i > 0)
+            json[len++] = ',';
+        if(i & 1){
+            len += sprintf(json + len, "\"2017-08-09 12:00:%02d INFO request %d handled by worker %d in %d ms, "
+                "client=10.0.%d.%d path=/api/v1/items/%d status=200\"", i % 60, i, i % 16, i % 1000, i % 256, i % 100, i);
+        }
+        else{
+            json[len++] = '"';
+            for(j = 0; j < 1024; j++){
+                seed = seed * 1103515245 + 12345;
+                json[len++] = base64[(seed >> 16) & 63];
+            }
+            json[len++] = '"';
+        }
+        i++;
+    }
+    json[len++] = ']';
+    json[len] = '\0';
+    return json;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_parse_strings
+* Description: 字符串为主的文档的解析吞吐量
+-----------------------------------------------------------------------------*/
+static void bench_parse_strings(){
+    const int iterations = 100;
+    char *json = GenerateStrings(4 * 1024 * 1024);
+    char *copy;
+    size_t length = strlen(json);
+    CJSONDocument doc;
+    CJSONValue v;
+    double start, elapsed;
+    int i;
+
+    INIT_VALUE_NULL(&v);
+    InitDocument(&doc);
+    start = now();
+    for(i = 0; i < iterations; i++){
+        ParseInDocument(&doc, &v, json);
+        ClearDocument(&doc);
+    }
+    elapsed = now() - start;
+    FreeDocument(&doc);
+    printf("parse strings (document): %8.2f MB/s\n", length * iterations / elapsed / 1e6);
+
+    start = now();
+    for(i = 0; i < iterations; i++){
+        Parse(&v, json);
+        FreeValue(&v);
+    }
+    elapsed = now() - start;
+    printf("parse strings (heap)    : %8.2f MB/s\n", length * iterations / elapsed / 1e6);
+
+    //原位解析会改写输入，每次都要先复制一份，复制的时间也计算在内
+    copy = (char *)malloc(length + 1);
+    start = now();
+    for(i = 0; i < iterations; i++){
+        memcpy(copy, json, length + 1);
+        ParseInsitu(&v, copy);
+        FreeValue(&v);
+    }
+    elapsed = now() - start;
+    printf("parse strings (insitu)  : %8.2f MB/s (including input copy)\n", length * iterations / elapsed / 1e6);
+    free(copy);
+    free(json);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_stringify_strings
+* Description: 生成字符串的速度，干净的长字符串和带有需要转义字符的日志行，和memcpy对比
+-----------------------------------------------------------------------------*/
+static void bench_stringify_strings(){
+    const int iterations = 100;
+    char *json[2], *out, *copy;
+    size_t length, len, total;
+    CJSONValue v;
+    double start, elapsed;
+    int i, k;
+
+    json[0] = GenerateStrings(4 * 1024 * 1024);
+    json[1] = (char *)malloc(4 * 1024 * 1024 + 4096);
+    len = 0;
+    json[1][len++] = '[';
+    for(i = 0; len < 4 * 1024 * 1024; i++){
+        if(i > 0)
+            json[1][len++] = ',';
+        len += sprintf(json[1] + len, "\"%d\\tINFO\\t\\\"GET /api/v1/items/%d\\\" status=200 path=C:\\\\logs\\\\%d.txt\\n\"",
+            i, i, i % 100);
+    }
+    json[1][len++] = ']';
+    json[1][len] = '\0';
+
+    for(k = 0; k < 2; k++){
+        INIT_VALUE_NULL(&v);
+        Parse(&v, json[k]);
+        total = 0;
+        start = now();
+        for(i = 0; i < iterations; i++){
+            Stringify(&v, &out, &length);
+            total += length;
+            free(out);
+        }
+        elapsed = now() - start;
+        printf("stringify strings (%s): %8.2f MB/s\n", k == 0 ? "clean  " : "escaped", total / elapsed / 1e6);
+        FreeValue(&v);
+    }
+
+    //相同字节数的memcpy，作为生成速度的上限
+    length = strlen(json[0]);
+    copy = (char *)malloc(length);
+    total = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        memcpy(copy, json[0], length);
+        total += (unsigned char)copy[i];
+    }
+    elapsed = now() - start;
+    printf("stringify strings (memcpy ): %8.2f MB/s (checksum %u)\n", length * (double)iterations / elapsed / 1e6, (unsigned)total);
+    free(copy);
+    free(json[0]);
+    free(json[1]);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : GenerateNumbers
+* Description: 生成一个纯数值数组，大小约为size字节
+    * kind为0时是整数，1时是两位小数(类似监控指标)，2时是17位有效数字的double
+-----------------------------------------------------------------------------*/
+static char *GenerateNumbers(size_t size, int kind){
+    char *json = (char *)malloc(size + 64);
+    size_t len = 0;
+    unsigned int seed = 1;
+    int i = 0;
+    json[len++] = '[';
+    while(len < size){
+        if(i > 0)
+            json[len++] = ',';
+        seed = seed * 1103515245 + 12345;
+        if(kind == 0)
+            len += sprintf(json + len, "%u", seed >> 4);
+        else if(kind == 1)
+            len += sprintf(json + len, "%u.%02u", (seed >> 16) % 10000, seed % 100);
+        else
+            len += sprintf(json + len, "%.17g", (double)seed / 4294967296.0 * 1e6 - 5e5);
+        i++;
+    }
+    json[len++] = ']';
+    json[len] = '\0';
+    return json;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_parse_numbers
+* Description: 纯数值数组的解析吞吐量
+-----------------------------------------------------------------------------*/
+static void bench_parse_numbers(){
+    static const char *names[] = { "integers", "decimals", "doubles " };
+    const int iterations = 50;
+    CJSONDocument doc;
+    CJSONValue v;
+    double start, elapsed;
+    int kind, i;
+
+    INIT_VALUE_NULL(&v);
+    InitDocument(&doc);
+    for(kind = 0; kind < 3; kind++){
+        char *json = GenerateNumbers(4 * 1024 * 1024, kind);
+        size_t length = strlen(json);
+        start = now();
+        for(i = 0; i < iterations; i++){
+            ParseInDocument(&doc, &v, json);
+            ClearDocument(&doc);
+        }
+        elapsed = now() - start;
+        printf("parse numbers (%s): %8.2f MB/s\n", names[kind], length * iterations / elapsed / 1e6);
+        free(json);
+    }
+    FreeDocument(&doc);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_stringify_numbers
+* Description: 纯数值数组的生成吞吐量，按输出的字节数计算
+-----------------------------------------------------------------------------*/
+static void bench_stringify_numbers(){
+    static const char *names[] = { "integers", "decimals", "doubles " };
+    const int iterations = 50;
+    CJSONValue v;
+    double start, elapsed;
+    size_t length, total;
+    char *out;
+    int kind, i;
+
+    for(kind = 0; kind < 3; kind++){
+        char *json = GenerateNumbers(4 * 1024 * 1024, kind);
+        INIT_VALUE_NULL(&v);
+        Parse(&v, json);
+        total = 0;
+        start = now();
+        for(i = 0; i < iterations; i++){
+            Stringify(&v, &out, &length);
+            total += length;
+            free(out);
+        }
+        elapsed = now() - start;
+        printf("stringify numbers (%s): %8.2f MB/s, %u bytes (input %u bytes)\n", names[kind],
+            total / elapsed / 1e6, (unsigned)length, (unsigned)strlen(json));
+        FreeValue(&v);
+        free(json);
+    }
+}
+
+static int DiscardWrite(void *user, const char *buf, size_t len){
+    *(size_t *)user += len;
+    (void)buf;
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_stringify_writer
+* Description: 对比生成完整字符串、流式输出到回调和生成到预先申请好的缓冲区
+    * 流式输出只申请一个固定大小的缓冲区，生成到缓冲区不申请内存
+-----------------------------------------------------------------------------*/
+static void bench_stringify_writer(){
+    const int iterations = 20;
+    char *json = GenerateRecords(8 * 1024 * 1024);
+    CJSONValue v;
+    double start, elapsed;
+    size_t length, total = 0, allocs;
+    char *out;
+    int i;
+
+    INIT_VALUE_NULL(&v);
+    Parse(&v, json);
+    allocs = alloc_count;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        Stringify(&v, &out, &length);
+        total += length;
+        free(out);
+    }
+    elapsed = now() - start;
+    printf("stringify (string)    : %8.2f MB/s, %6.1f allocs/stringify\n",
+        total / elapsed / 1e6, (double)(alloc_count - allocs) / iterations);
+
+    total = 0;
+    allocs = alloc_count;
+    start = now();
+    for(i = 0; i < iterations; i++)
+        StringifyToWriter(&v, DiscardWrite, &total);
+    elapsed = now() - start;
+    printf("stringify (writer)    : %8.2f MB/s, %6.1f allocs/stringify\n",
+        total / elapsed / 1e6, (double)(alloc_count - allocs) / iterations);
+
+    //发送缓冲区按StringifiedLength预先申请好，生成时不再申请内存
+    total = 0;
+    length = StringifiedLength(&v);
+    out = (char *)malloc(length);
+    allocs = alloc_count;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        StringifyInto(&v, out, length, NULL);
+        total += length;
+    }
+    elapsed = now() - start;
+    printf("stringify (into)      : %8.2f MB/s, %6.1f allocs/stringify\n",
+        total / elapsed / 1e6, (double)(alloc_count - allocs) / iterations);
+    start = now();
+    for(i = 0; i < iterations; i++)
+        length = StringifiedLength(&v);
+    elapsed = now() - start;
+    printf("stringified length    : %8.2f MB/s\n", length * (double)iterations / elapsed / 1e6);
+    free(out);
+    FreeValue(&v);
+    free(json);
+}
+
+//遍历节点树，累加所有数值和字符串长度
+static double SumValue(const CJSONValue *v){
+    double sum = 0;
+    size_t i;
+    switch(GetType(v)){
+        case TYPE_NUMBER: return GetNumber(v);
+        case TYPE_STRING: return (double)GetStringLength(v);
+        case TYPE_ARRAY:
+            for(i = 0; i < GetArraySize(v); i++)
+                sum += SumValue(GetArrayElement(v, i));
+            return sum;
+        case TYPE_OBJECT:
+            for(i = 0; i < GetObjectSize(v); i++)
+                sum += GetObjectKeyLength(v, i) + SumValue(GetObjectValue(v, i));
+            return sum;
+        default: return 0;
+    }
+}
+
+//遍历磁带中下标为i的值，累加所有数值和字符串长度，*next为值之后的下标
+static double SumTape(const CJSONTape *tape, size_t i, size_t *next){
+    double sum = 0;
+    size_t n;
+    switch(GetTapeType(tape, i)){
+        case TYPE_NUMBER: sum = GetTapeNumber(tape, i); break;
+        case TYPE_STRING: sum = (double)GetTapeStringLength(tape, i); break;
+        case TYPE_ARRAY:
+            for(n = GetTapeArraySize(tape, i++); n > 0; n--)
+                sum += SumTape(tape, i, &i);
+            break;
+        case TYPE_OBJECT:
+            for(n = GetTapeObjectSize(tape, i++); n > 0; n--){
+                sum += GetTapeStringLength(tape, i);
+                sum += SumTape(tape, i + 2, &i);
+            }
+            break;
+        default: break;
+    }
+    *next = GetTapeNext(tape, i);
+    return sum;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_tape
+* Description: 解析并完整遍历一次，对比节点树(堆、文档)和磁带
+-----------------------------------------------------------------------------*/
+static void bench_tape(){
+    const int iterations = 200;
+    char *json = GenerateRecords(200 * 1024);
+    size_t length = strlen(json);
+    CJSONDocument doc;
+    CJSONTape tape;
+    CJSONValue v;
+    double start, elapsed, sum[3] = { 0, 0, 0 }, walk;
+    size_t next;
+    int i;
+
+    INIT_VALUE_NULL(&v);
+    alloc_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        Parse(&v, json);
+        sum[0] += SumValue(&v);
+        FreeValue(&v);
+    }
+    elapsed = now() - start;
+    printf("parse+walk (heap)     : %8.2f MB/s, %8.1f allocs/parse\n",
+        length * iterations / elapsed / 1e6, (double)alloc_count / iterations);
+
+    InitDocument(&doc);
+    alloc_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        ParseInDocument(&doc, &v, json);
+        sum[1] += SumValue(&v);
+        ClearDocument(&doc);
+    }
+    elapsed = now() - start;
+    printf("parse+walk (document) : %8.2f MB/s, %8.1f allocs/parse\n",
+        length * iterations / elapsed / 1e6, (double)alloc_count / iterations);
+    ParseInDocument(&doc, &v, json);
+    start = now();
+    for(i = 0, walk = 0; i < iterations; i++)
+        walk += SumValue(&v);
+    elapsed = now() - start;
+    printf("walk only (document)  : %8.2f MB/s\n", length * iterations / elapsed / 1e6);
+    FreeDocument(&doc);
+
+    InitTape(&tape);
+    alloc_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        ParseTape(&tape, json);
+        sum[2] += SumTape(&tape, 0, &next);
+    }
+    elapsed = now() - start;
+    printf("parse+walk (tape)     : %8.2f MB/s, %8.1f allocs/parse, %.1f bytes/input byte\n",
+        length * iterations / elapsed / 1e6, (double)alloc_count / iterations,
+        (double)(tape.capacity * sizeof(unsigned long long) + tape.scapacity) / length);
+    start = now();
+    for(i = 0; i < iterations; i++)
+        walk += SumTape(&tape, 0, &next);
+    elapsed = now() - start;
+    printf("walk only (tape)      : %8.2f MB/s\n", length * iterations / elapsed / 1e6);
+    FreeTape(&tape);
+    if(sum[0] != sum[1] || sum[0] != sum[2] || walk == 0)
+        printf("tape checksum mismatch\n");
+    free(json);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_parse_lazy
+* Description: 只读取少量字段时，对比完整解析和按需解析，以及按需解析后全部展开的代价
+-----------------------------------------------------------------------------*/
+static void bench_parse_lazy(){
+    const int iterations = 100;
+    char *json = GenerateRecords(2 * 1024 * 1024);
+    size_t length = strlen(json), n;
+    CJSONDocument doc;
+    CJSONValue v;
+    double start, elapsed, sum[2] = { 0, 0 };
+    int i, mode;
+    static const char *names[] = { "parse+3 fields (full) ", "parse+3 fields (lazy) " };
+
+    InitDocument(&doc);
+    for(mode = 0; mode < 2; mode++){
+        start = now();
+        for(i = 0; i < iterations; i++){
+            if(mode == 0)
+                ParseInDocument(&doc, &v, json);
+            else
+                ParseLazyInDocument(&doc, &v, json);
+            n = GetArraySize(&v);
+            sum[mode] += GetNumber(FindObjectValue(GetArrayElement(&v, 0), "score", 5));
+            sum[mode] += GetNumber(FindObjectValue(GetArrayElement(&v, n / 2), "score", 5));
+            sum[mode] += GetNumber(FindObjectValue(GetArrayElement(&v, n - 1), "score", 5));
+            ClearDocument(&doc);
+        }
+        elapsed = now() - start;
+        printf("%s: %8.2f MB/s\n", names[mode], length * iterations / elapsed / 1e6);
+    }
+    start = now();
+    for(i = 0; i < iterations; i++){
+        ParseLazyInDocument(&doc, &v, json);
+        MaterializeValue(&v);
+        ClearDocument(&doc);
+    }
+    elapsed = now() - start;
+    printf("parse+materialize all : %8.2f MB/s\n", length * iterations / elapsed / 1e6);
+    FreeDocument(&doc);
+    if(sum[0] != sum[1])
+        printf("lazy checksum mismatch\n");
+    free(json);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_parse_parallel
+* Description: 对比顺序解析和多线程解析大数组的吞吐，线程数从1递增到CPU核数
+    * 计数分配器不是线程安全的，测试期间临时换回malloc
+-----------------------------------------------------------------------------*/
+static void bench_parse_parallel(){
+    const int iterations = 5;
+    char *json = GenerateRecords(32 * 1024 * 1024);
+    size_t length = strlen(json), threads, cpus;
+    CJSONDocument doc;
+    CJSONValue v;
+    double start, elapsed, base;
+    int i;
+
+    SetAllocator(NULL);
+    cpus = (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpus < 4)
+        cpus = 4;
+    InitDocument(&doc);
+    start = now();
+    for(i = 0; i < iterations; i++){
+        ParseInDocument(&doc, &v, json);
+        ClearDocument(&doc);
+    }
+    base = now() - start;
+    printf("parse sequential      : %8.2f MB/s\n", length * iterations / base / 1e6);
+    for(threads = 1; threads <= cpus; threads++){
+        start = now();
+        for(i = 0; i < iterations; i++){
+            if(PARSE_OK != ParseParallelInDocument(&doc, &v, json, threads))
+                printf("parallel parse failed\n");
+            ClearDocument(&doc);
+        }
+        elapsed = now() - start;
+        printf("parse parallel x%-2u    : %8.2f MB/s (%.2fx)\n", (unsigned)threads, length * iterations / elapsed / 1e6, base / elapsed);
+    }
+    FreeDocument(&doc);
+    SetAllocator(&countingAllocator);
+    free(json);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_parse_lines
+* Description: 对比逐行调用ParseN和ParseLines批量解析NDJSON的吞吐
+    * 把GenerateRecords的数组改写成每行一个对象，对象之间的",{"换成"\n{"
+-----------------------------------------------------------------------------*/
+static int CountLine(void *user, size_t line, int ret, const CJSONValue *v){
+    (void)line;
+    if(ret == PARSE_OK)
+        *(double *)user += GetNumber(FindObjectValue((CJSONValue *)v, "score", 5));
+    return 1;
+}
+
+static void bench_parse_lines(){
+    const int iterations = 5;
+    char *json = GenerateRecords(32 * 1024 * 1024), *p, *eol;
+    size_t length = strlen(json), threads, cpus;
+    CJSONValue v;
+    double start, elapsed, base, sum[2] = { 0, 0 };
+    int i;
+
+    SetAllocator(NULL);
+    cpus = (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpus < 4)
+        cpus = 4;
+    json[0] = ' ';
+    json[length - 1] = '\n';
+    for(p = json; (p = strstr(p, ",{")) != NULL; p++)
+        *p = '\n';
+    start = now();
+    for(i = 0; i < iterations; i++){
+        for(p = json; p < json + length; p = eol + 1){
+            eol = strchr(p, '\n');
+            ParseN(&v, p, eol - p);
+            sum[0] += GetNumber(FindObjectValue(&v, "score", 5));
+            FreeValue(&v);
+        }
+    }
+    base = now() - start;
+    printf("lines ParseN per line : %8.2f MB/s\n", length * iterations / base / 1e6);
+    for(threads = 1; threads <= cpus; threads++){
+        sum[1] = 0;
+        start = now();
+        for(i = 0; i < iterations; i++)
+            ParseLines(json, length, threads, CountLine, &sum[1]);
+        elapsed = now() - start;
+        printf("lines ParseLines x%-2u  : %8.2f MB/s (%.2fx)\n", (unsigned)threads, length * iterations / elapsed / 1e6, base / elapsed);
+        if(sum[0] != sum[1])
+            printf("lines checksum mismatch\n");
+    }
+    SetAllocator(&countingAllocator);
+    free(json);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_parser_parse
+* Description: 大量小消息逐个解析，对比Parse每次重新扩展栈和ParserParse复用栈
+-----------------------------------------------------------------------------*/
+static void bench_parser_parse(){
+    const int iterations = 500000;
+    char json[1024];
+    size_t length, allocs;
+    CJSONParser *p;
+    CJSONValue v;
+    double start, elapsed;
+    int i;
+
+    length = (size_t)sprintf(json, "{\"id\":42,\"method\":\"update\",\"params\":{\"name\":\"user_42\",\"score\":97.5,"
+        "\"tags\":[\"alpha\",\"beta\"]},\"payload\":\"%0600d\"}", 0);
+    alloc_count = free_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        Parse(&v, json);
+        FreeValue(&v);
+    }
+    elapsed = now() - start;
+    allocs = alloc_count;
+    printf("small msgs Parse      : %8.2f Mmsg/s, %8.1f allocs/parse\n", iterations / elapsed / 1e6, (double)allocs / iterations);
+    p = ParserCreate();
+    alloc_count = free_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        ParserParse(p, &v, json, length);
+        FreeValue(&v);
+    }
+    elapsed = now() - start;
+    allocs = alloc_count;
+    ParserDestroy(p);
+    printf("small msgs ParserParse: %8.2f Mmsg/s, %8.1f allocs/parse\n", iterations / elapsed / 1e6, (double)allocs / iterations);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_build_dom
+* Description: 用PushBackArrayElement/SetObjectValue构造10万个元素的数组和10万个成员的对象
+-----------------------------------------------------------------------------*/
+static void bench_build_dom(){
+    const int iterations = 20, count = 100000;
+    CJSONValue root, *e;
+    char key[32];
+    size_t allocs, len;
+    double start, elapsed;
+    int i, k;
+
+    INIT_VALUE_NULL(&root);
+    alloc_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        SetArray(&root, 0);
+        for(k = 0; k < count; k++){
+            e = PushBackArrayElement(&root);
+            SetObject(e, 0);
+            SetNumber(SetObjectValue(e, "id", 2), k);
+            len = (size_t)sprintf(key, "user_%d", k);
+            SetString(SetObjectValue(e, "name", 4), key, len);
+            SetNumber(SetObjectValue(e, "score", 5), k * 0.5);
+        }
+        FreeValue(&root);
+    }
+    elapsed = now() - start;
+    allocs = alloc_count;
+    printf("build array (100k)    : %8.2f Melem/s, %8.1f allocs/element\n",
+        (double)count * iterations / elapsed / 1e6, (double)allocs / iterations / count);
+
+    alloc_count = 0;
+    start = now();
+    for(i = 0; i < iterations; i++){
+        SetObject(&root, 0);
+        for(k = 0; k < count; k++){
+            len = (size_t)sprintf(key, "key_%d", k);
+            SetNumber(SetObjectValue(&root, key, len), k);
+        }
+        FreeValue(&root);
+    }
+    elapsed = now() - start;
+    allocs = alloc_count;
+    printf("build object (100k)   : %8.2f Mmember/s, %8.1f allocs/member\n",
+        (double)count * iterations / elapsed / 1e6, (double)allocs / iterations / count);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : GenerateNested
+* Description: 生成一个数组，每个元素是嵌套约400层的对象/数组链，大小约为size字节
+-----------------------------------------------------------------------------*/
+static char *GenerateNested(size_t size){
+    const int depth = 200;
+    char *json = (char *)malloc(size + depth * 32 + 64);
+    size_t len = 0;
+    int i = 0, j;
+    json[len++] = '[';
+    while(len < size){
+        if(i > 0)
+            json[len++] = ',';
+        for(j = 0; j < depth; j++)
+            len += sprintf(json + len, "{\"d\":%d,\"c\":[", j);
+        len += sprintf(json + len, "%d", i);
+        for(j = 0; j < depth; j++){
+            json[len++] = ']';
+            json[len++] = '}';
+        }
+        i++;
+    }
+    json[len++] = ']';
+    json[len] = '\0';
+    return json;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : GenerateMixed
+* Description: 生成一个大的顶层数组，元素轮流是数字、字符串、小对象、字面量和小数组，大小约为size字节
+-----------------------------------------------------------------------------*/
+static char *GenerateMixed(size_t size){
+    char *json = (char *)malloc(size + 512);
+    size_t len = 0;
+    unsigned int seed = 1;
+    int i = 0;
+    json[len++] = '[';
+    while(len < size){
+        if(i > 0)
+            json[len++] = ',';
+        seed = seed * 1103515245 + 12345;
+        switch(i % 6){
+        case 0: len += sprintf(json + len, "%u.%02u", (seed >> 16) % 100000, seed % 100); break;
+        case 1: len += sprintf(json + len, "\"item %u of batch %d\"", seed >> 8, i / 6); break;
+        case 2: len += sprintf(json + len, "{\"id\":%d,\"ok\":%s,\"v\":%u}", i, (seed & 1) ? "true" : "false", seed >> 20); break;
+        case 3: len += sprintf(json + len, "%s", (seed & 2) ? "null" : "true"); break;
+        case 4: len += sprintf(json + len, "[%u,%u,\"%x\"]", seed >> 24, (seed >> 12) & 0xfff, seed); break;
+        default: len += sprintf(json + len, "%d", (int)(seed >> 1) - (1 << 30)); break;
+        }
+        i++;
+    }
+    json[len++] = ']';
+    json[len] = '\0';
+    return json;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : GenerateMessages
+* Description: 生成count条独立的小消息(约100到500字节)，模拟RPC请求和事件
+-----------------------------------------------------------------------------*/
+static char **GenerateMessages(size_t count){
+    static const char *methods[] = { "update", "create", "delete", "query", "subscribe" };
+    char **msgs = (char **)malloc(count * sizeof(char *));
+    unsigned int seed = 7;
+    size_t i;
+    int n;
+    for(i = 0; i < count; i++){
+        seed = seed * 1103515245 + 12345;
+        n = (int)((seed >> 16) % 300);
+        msgs[i] = (char *)malloc(512 + n);
+        sprintf(msgs[i], "{\"jsonrpc\":\"2.0\",\"id\":%u,\"method\":\"%s\",\"params\":{\"user\":\"user_%u\","
+            "\"score\":%u.%02u,\"tags\":[\"alpha\",\"beta\",\"gamma\"],\"active\":%s,\"note\":\"%.*s\"}}",
+            (unsigned)i, methods[i % 5], seed >> 20, (seed >> 8) % 1000, seed % 100, (seed & 4) ? "true" : "false",
+            n, "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et "
+            "dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex "
+            "ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat.");
+    }
+    return msgs;
+}
+
+//基准测试集的一份语料：一个或多个JSON文本，每次操作处理其中一个
+typedef struct{
+    const char *name;
+    char **docs;
+    size_t count;
+}BenchCorpus;
+
+//每种操作的统计：总耗时、内存分配次数和每次操作的耗时样本
+typedef struct{
+    const char *name;
+    double elapsed;
+    size_t allocs;
+    size_t frees;
+    double *samples;
+}BenchOp;
+
+static int CompareDouble(const void *a, const void *b){
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : Percentile
+* Description: 已排序样本的百分位数(取最近的秩)
+-----------------------------------------------------------------------------*/
+static double Percentile(const double *samples, size_t n, double q){
+    size_t i = (size_t)(q * n + 0.5);
+    return samples[i > 0 ? (i > n ? n : i) - 1 : 0];
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : RunCorpus
+* Description: 对一份语料循环执行 解析 -> 生成 -> 释放，分别计时和统计内存分配，
+    * 往返(roundtrip)是三步合计。吞吐量都按输入的字节数计算
+    * 循环次数使处理的总字节数约为64MB，小消息最多200000次
+-----------------------------------------------------------------------------*/
+static void RunCorpus(const BenchCorpus *corpus){
+    const size_t target = 64 * 1024 * 1024;
+    size_t *lens = (size_t *)malloc(corpus->count * sizeof(size_t));
+    size_t i, k, n, bytes = 0, total = 0, a0, f0, length;
+    BenchOp ops[4] = { { "parse" }, { "stringify" }, { "free" }, { "roundtrip" } };
+    double t[4];
+    CJSONValue v;
+    char *out;
+
+    for(i = 0; i < corpus->count; i++)
+        bytes += lens[i] = strlen(corpus->docs[i]);
+    n = target / (bytes / corpus->count);
+    n = n < 20 ? 20 : n > 200000 ? 200000 : n;
+    for(k = 0; k < 4; k++)
+        ops[k].samples = (double *)malloc(n * sizeof(double));
+
+    //预热一次，同时检查语料是合法的JSON
+    for(i = 0; i < corpus->count; i++){
+        if(ParseN(&v, corpus->docs[i], lens[i]) != PARSE_OK){
+            fprintf(stderr, "corpus %s: document %u does not parse\n", corpus->name, (unsigned)i);
+            exit(1);
+        }
+        FreeValue(&v);
+    }
+
+    for(i = 0; i < n; i++){
+        k = i % corpus->count;
+        a0 = alloc_count;
+        f0 = free_count;
+        t[0] = now();
+        ParseN(&v, corpus->docs[k], lens[k]);
+        t[1] = now();
+        ops[0].allocs += alloc_count - a0;
+        ops[0].frees += free_count - f0;
+        a0 = alloc_count;
+        f0 = free_count;
+        Stringify(&v, &out, &length);
+        free(out);
+        t[2] = now();
+        ops[1].allocs += alloc_count - a0;
+        ops[1].frees += free_count - f0;
+        a0 = alloc_count;
+        f0 = free_count;
+        FreeValue(&v);
+        t[3] = now();
+        ops[2].allocs += alloc_count - a0;
+        ops[2].frees += free_count - f0;
+        ops[0].samples[i] = t[1] - t[0];
+        ops[1].samples[i] = t[2] - t[1];
+        ops[2].samples[i] = t[3] - t[2];
+        ops[3].samples[i] = t[3] - t[0];
+        total += lens[k];
+    }
+    ops[3].allocs = ops[0].allocs + ops[1].allocs + ops[2].allocs;
+    ops[3].frees = ops[0].frees + ops[1].frees + ops[2].frees;
+
+    for(k = 0; k < 4; k++){
+        for(i = 0; i < n; i++)
+            ops[k].elapsed += ops[k].samples[i];
+        qsort(ops[k].samples, n, sizeof(double), CompareDouble);
+        printf("%s,%s,%u,%u,%u,%.2f,%.1f,%.1f,%.3f,%.3f\n", corpus->name, ops[k].name,
+            (unsigned)corpus->count, (unsigned)(bytes / corpus->count), (unsigned)n,
+            total / ops[k].elapsed / 1e6, (double)ops[k].allocs / n, (double)ops[k].frees / n,
+            Percentile(ops[k].samples, n, 0.50) * 1e6, Percentile(ops[k].samples, n, 0.99) * 1e6);
+        free(ops[k].samples);
+    }
+    fflush(stdout);
+    free(lens);
+}
+
+/*-----------------------------------------------------------------------------
+* Function   : bench_suite
+* Description: 标准语料上的解析/生成/释放/往返测试，输出CSV便于比较不同版本
+    * names非空时只运行名字在其中的语料
+-----------------------------------------------------------------------------*/
+static void bench_suite(char **names, int count){
+    BenchCorpus corpora[6];
+    char *docs[5];
+    size_t i, j;
+    int k;
+
+    docs[0] = GenerateNumbers(1024 * 1024, 2);
+    docs[1] = GenerateStrings(1024 * 1024);
+    docs[2] = GenerateNested(1024 * 1024);
+    docs[3] = GenerateRecords(1024 * 1024);
+    docs[4] = GenerateMixed(16 * 1024 * 1024);
+    corpora[0] = (BenchCorpus){ "numbers", &docs[0], 1 };
+    corpora[1] = (BenchCorpus){ "strings", &docs[1], 1 };
+    corpora[2] = (BenchCorpus){ "nested", &docs[2], 1 };
+    corpora[3] = (BenchCorpus){ "records", &docs[3], 1 };
+    corpora[4] = (BenchCorpus){ "small_messages", GenerateMessages(4096), 4096 };
+    corpora[5] = (BenchCorpus){ "large_array", &docs[4], 1 };
+
+    printf("corpus,op,docs,bytes_per_doc,iterations,mb_per_s,allocs_per_op,frees_per_op,p50_us,p99_us\n");
+    for(i = 0; i < 6; i++){
+        for(k = 0; k < count && strcmp(names[k], corpora[i].name) != 0; k++)
+            ;
+        if(count == 0 || k < count)
+            RunCorpus(&corpora[i]);
+    }
+    for(i = 0; i < 5; i++)
+        free(docs[i]);
+    for(j = 0; j < corpora[4].count; j++)
+        free(corpora[4].docs[j]);
+    free(corpora[4].docs);
+}
+
+int main(int argc, char **argv){
+    SetAllocator(&countingAllocator);
+    //./bench suite [语料名...] 只运行标准语料测试，输出CSV
+    if(argc > 1 && strcmp(argv[1], "suite") == 0){
+        bench_suite(argv + 2, argc - 2);
+        return 0;
+    }
+    bench_parse_document();
+    bench_parse_handler();
+    bench_parser_feed();
+    bench_parser_parse();
+    bench_find_object_value();
+    bench_build_dom();
+    bench_parse_strings();
+    bench_stringify_strings();
+    bench_parse_numbers();
+    bench_stringify_numbers();
+    bench_stringify_writer();
+    bench_tape();
+    bench_parse_lazy();
+    bench_parse_parallel();
+    bench_parse_lines();
+    return 0;
+}
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "../src/cJsonStruct.h"
 #include "../src/cJson.h"
 
@@ -86,6 +87,27 @@ static void test_parse_number(){
     TEST_NUMBER(1.234E+10, "1.234E+10");
     TEST_NUMBER(1.234E-10, "1.234E-10");
     TEST_NUMBER(0.0, "1e-10000");    //must underflow
+
+    TEST_NUMBER(1.0000000000000002, "1.0000000000000002"); /* the smallest number > 1 */
+    TEST_NUMBER( 4.9406564584124654e-324, "4.9406564584124654e-324"); /* minimum denormal */
+    TEST_NUMBER(-4.9406564584124654e-324, "-4.9406564584124654e-324");
+    TEST_NUMBER( 2.2250738585072009e-308, "2.2250738585072009e-308");  /* Max subnormal double */
+    TEST_NUMBER(-2.2250738585072009e-308, "-2.2250738585072009e-308");
+    TEST_NUMBER( 2.2250738585072014e-308, "2.2250738585072014e-308");  /* Min normal positive double */
+    TEST_NUMBER(-2.2250738585072014e-308, "-2.2250738585072014e-308");
+    TEST_NUMBER( 1.7976931348623157e+308, "1.7976931348623157e+308");  /* Max double */
+    TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
+
+    //超过19位有效数字，尾数被截断后需要精确比较才能确定舍入方向
+    TEST_NUMBER(9007199254740992.0, "9007199254740993");    /* 2^53+1，正好在中间，向偶数舍入 */
+    TEST_NUMBER(9007199254740994.0, "9007199254740993.0000000000000001");
+    TEST_NUMBER(9007199254740996.0, "9007199254740995");
+    TEST_NUMBER(1.2345678901234568e+29, "123456789012345678901234567890");
+    TEST_NUMBER(2.2250738585072011e-308, "2.2250738585072011e-308");
+    TEST_NUMBER(4.9406564584124654e-324, "2.47032822920623272088284396434110686182529901307162382212792841250337753635104375932649918180817996189898282347722858865463328355177969898199387398005390939063150356595155702263922908583924491051844359318028499365361525003193704576782492193656236698636584807570015857692699037063119282795585513329278343384093519780155312465972635795746227664652728272200563740064854999770965994704540208281662262378573934507363390079677619305775067401763246736009689513405355374585166611342237666786041621596804619144672918403005300575308490487653917113865916462395249126236538818796362393732804238910186723484976682350898633885879256283027559956575244555072551893136908362547791869486679949683240497058210285131854513962138377228261454376934125320985913276672363281251e-324"); /* 最小非规格化数的一半再多一点，进位 */
+    TEST_NUMBER(0.0, "2.4703282292062327208828439643411068618252990130716238221279284125033775363510437593264991818081799618989828234772285886546332835517796989819938739800539093906315035659515570226392290858392449105184435931802849936536152500319370457678249219365623669863658480757001585769269903706311928279558551332927834338409351978015531246597263579574622766465272827220056374006485499977096599470454020828166226237857393450736339007967761930577506740176324673600968951340535537458516661134223766678604162159680461914467291840300530057530849048765391711386591646239524912623653881879636239373280423891018672348497668235089863388587925628302755995657524455507255189313690836254779186948667994968324049705821028513185451396213837722826145437693412532098591327667236328125e-324"); /* 正好是一半，向偶数舍入 */
+    TEST_NUMBER(0.1, "0.1000000000000000000000000000000000000000000000000000000000000001");
+    TEST_NUMBER(0.0, "0.000000000000000000000000000000000000000000000000000000000000000e999999");
 }
 
 #define TEST_STRING(expect, json)\
@@ -101,10 +123,25 @@ static void test_parse_number(){
 static void test_parse_string(){
     TEST_STRING("",  "\"\"");
     TEST_STRING("Hello", "\"Hello\"");
-#if 0
     TEST_STRING("Hello\nWorld", "\"Hello\\nWorld\"");
     TEST_STRING("\" \\ / \b \f \n \r \t", "\"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
-#endif
+    //跨越多个SIMD块的长字符串
+    TEST_STRING("0123456789abcdef0123456789ABCDEF0123456789abcdef0123456789ABCDEF!",
+        "\"0123456789abcdef0123456789ABCDEF0123456789abcdef0123456789ABCDEF!\"");
+    TEST_STRING("0123456789abcdef0123456789ABCDEF\t0123456789abcdef0123456789ABCDEF\\",
+        "\"0123456789abcdef0123456789ABCDEF\\t0123456789abcdef0123456789ABCDEF\\\\\"");
+    //\uXXXX解码为UTF-8，U+10000以上用代理对
+    TEST_STRING("Hello\0World", "\"Hello\\u0000World\"");
+    TEST_STRING("\x24", "\"\\u0024\"");         /* Dollar sign U+0024 */
+    TEST_STRING("\xC2\xA2", "\"\\u00A2\"");     /* Cents sign U+00A2 */
+    TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
+    TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
+    TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+    TEST_STRING("\xF4\x8F\xBF\xBF", "\"\\uDBFF\\uDFFF\"");  /* U+10FFFF */
+    //原样出现的多字节UTF-8
+    TEST_STRING("\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x98\x80", "\"\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x98\x80\"");
+    TEST_STRING("0123456789abcdef0123456789ABCDEF\xEF\xBF\xBF" "0123456789abcdef0123456789ABCDEF",
+        "\"0123456789abcdef0123456789ABCDEF\xEF\xBF\xBF" "0123456789abcdef0123456789ABCDEF\"");
 }
 
 //ANSI C(C 89)并没有size_t打印方法
@@ -219,6 +256,967 @@ static void test_parse_object(){
     FreeValue(&v);
 }
 
+static void test_find_object_value(){
+    CJSONDocument doc;
+    CJSONValue v;
+    char json[4096];
+    size_t i, len;
+    int mode;
+
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, "{\"a\" : 1, \"ab\" : 2, \"\" : 3, \"a\" : 4}"));
+    EXPECT_EQ_SIZE_T(1, FindObjectIndex(&v, "ab", 2));
+    EXPECT_EQ_SIZE_T(2, FindObjectIndex(&v, "", 0));
+    //有重复键时返回第一个
+    EXPECT_EQ_DOUBLE(1.0, GetNumber(FindObjectValue(&v, "a", 1)));
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindObjectIndex(&v, "b", 1));
+    EXPECT_EQ_TRUE(FindObjectValue(&v, "abc", 3) == NULL);
+    FreeValue(&v);
+
+    //足够大的对象建立哈希索引，分别在堆上和文档中测试
+    len = 0;
+    json[len++] = '{';
+    for(i = 0; i < 100; i++)
+        len += sprintf(json + len, "%s\"k%u\":%u", i ? "," : "", (unsigned)i, (unsigned)i);
+    len += sprintf(json + len, ",\"k7\":-1}");
+    InitDocument(&doc);
+    for(mode = 0; mode < 2; mode++){
+        if(mode == 0)
+            EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));
+        else
+            EXPECT_EQ_INT(PARSE_OK, ParseInDocument(&doc, &v, json));
+        EXPECT_EQ_SIZE_T(101, GetObjectSize(&v));
+        for(i = 0; i < 100; i++){
+            char key[16];
+            size_t klen = sprintf(key, "k%u", (unsigned)i);
+            EXPECT_EQ_SIZE_T(i, FindObjectIndex(&v, key, klen));
+        }
+        EXPECT_EQ_DOUBLE(7.0, GetNumber(FindObjectValue(&v, "k7", 2)));
+        EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindObjectIndex(&v, "k100", 4));
+        EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindObjectIndex(&v, "k", 1));
+        FreeValue(&v);
+    }
+    FreeDocument(&doc);
+}
+
+static void test_parse_insitu(){
+    char json[] = "{\"s\" : \"abc\", \"k\\ney\" : [\"a\\tb\\\\c\", \"\", {\"x\" : \"y\\/\"}], \"n\" : 1.5}";
+    char bad[] = "{\"a\" : \"b\", \"c\" : [\"d\\v\"]}";
+    CJSONValue v, *a;
+
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, ParseInsitu(&v, json));
+    EXPECT_EQ_SIZE_T(3, GetObjectSize(&v));
+    EXPECT_EQ_STRING("s", GetObjectKey(&v, 0), GetObjectKeyLength(&v, 0));
+    EXPECT_EQ_STRING("abc", GetString(GetObjectValue(&v, 0)), GetStringLength(GetObjectValue(&v, 0)));
+    EXPECT_EQ_STRING("k\ney", GetObjectKey(&v, 1), GetObjectKeyLength(&v, 1));
+    a = GetObjectValue(&v, 1);
+    EXPECT_EQ_STRING("a\tb\\c", GetString(GetArrayElement(a, 0)), GetStringLength(GetArrayElement(a, 0)));
+    EXPECT_EQ_STRING("", GetString(GetArrayElement(a, 1)), GetStringLength(GetArrayElement(a, 1)));
+    EXPECT_EQ_STRING("y/", GetString(GetObjectValue(GetArrayElement(a, 2), 0)), 2);
+    EXPECT_EQ_DOUBLE(1.5, GetNumber(GetObjectValue(&v, 2)));
+    //字符串和键直接引用输入缓冲区，并以'\0'结尾
+    EXPECT_EQ_TRUE(GetString(GetObjectValue(&v, 0)) > json && GetString(GetObjectValue(&v, 0)) < json + sizeof(json));
+    EXPECT_EQ_TRUE(GetObjectKey(&v, 1) > json && GetObjectKey(&v, 1) < json + sizeof(json));
+    EXPECT_EQ_INT('\0', GetString(GetArrayElement(a, 0))[GetStringLength(GetArrayElement(a, 0))]);
+    //修改引用缓冲区的节点
+    SetString(GetArrayElement(a, 0), "copy", 4);
+    EXPECT_EQ_STRING("copy", GetString(GetArrayElement(a, 0)), GetStringLength(GetArrayElement(a, 0)));
+    //键借用缓冲区的标记在成员里，重新初始化、解析成员的值之后键仍然不会被释放
+    FreeValue(a);
+    INIT_VALUE_NULL(a);
+    EXPECT_EQ_INT(PARSE_OK, Parse(a, "[1,2]"));
+    EXPECT_EQ_STRING("k\ney", GetObjectKey(&v, 1), GetObjectKeyLength(&v, 1));
+    EXPECT_EQ_TRUE(GetObjectKey(&v, 1) > json && GetObjectKey(&v, 1) < json + sizeof(json));
+    EXPECT_EQ_TRUE(FindObjectValue(&v, "k\ney", 4) == a);
+    EXPECT_EQ_SIZE_T(2, GetArraySize(a));
+    FreeValue(&v);
+
+    EXPECT_EQ_INT(PARSE_INVALID_STRING_ESCAPE, ParseInsitu(&v, bad));
+    EXPECT_EQ_INT(TYPE_NULL, GetType(&v));
+
+    //\uXXXX解码后比转义序列短，原位写回
+    {
+        char unicode[] = "[\"\\u00e9t\\u00e9\", \"\\uD834\\uDD1Eclef\", \"\xE4\xB8\xAD\\u6587\"]";
+        char invalid[] = "[\"ok\", \"\xC3(\"]";
+        EXPECT_EQ_INT(PARSE_OK, ParseInsitu(&v, unicode));
+        EXPECT_EQ_STRING("\xC3\xA9t\xC3\xA9", GetString(GetArrayElement(&v, 0)), GetStringLength(GetArrayElement(&v, 0)));
+        EXPECT_EQ_STRING("\xF0\x9D\x84\x9E" "clef", GetString(GetArrayElement(&v, 1)), GetStringLength(GetArrayElement(&v, 1)));
+        EXPECT_EQ_STRING("\xE4\xB8\xAD\xE6\x96\x87", GetString(GetArrayElement(&v, 2)), GetStringLength(GetArrayElement(&v, 2)));
+        FreeValue(&v);
+        EXPECT_EQ_INT(PARSE_INVALID_UTF8, ParseInsitu(&v, invalid));
+        EXPECT_EQ_INT(TYPE_NULL, GetType(&v));
+    }
+}
+
+#define TEST_PARSE_N_ERROR(error, json, len)\
+    do{\
+        CJSONValue v;\
+        INIT_VALUE_NULL(&v);\
+        v.type = TYPE_FALSE;\
+        EXPECT_EQ_INT(error, ParseN(&v, json, len));\
+        EXPECT_EQ_INT(TYPE_NULL, GetType(&v));\
+    }while(0)
+
+static void test_parse_n(){
+    const char *json = "[1, \"abc\", {\"k\" : true}] trailing";
+    char *buf;
+    size_t i, n;
+    CJSONValue v;
+
+    /*只解析前缀，不依赖'\0'*/
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, ParseN(&v, json, 25));
+    EXPECT_EQ_INT(TYPE_ARRAY, GetType(&v));
+    EXPECT_EQ_SIZE_T(3, GetArraySize(&v));
+    EXPECT_EQ_STRING("abc", GetString(GetArrayElement(&v, 1)), GetStringLength(GetArrayElement(&v, 1)));
+    FreeValue(&v);
+
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, ParseN(&v, "123456", 3));
+    EXPECT_EQ_DOUBLE(123.0, GetNumber(&v));
+    FreeValue(&v);
+
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, ParseN(&v, "truex", 4));
+    EXPECT_EQ_INT(TYPE_TRUE, GetType(&v));
+    FreeValue(&v);
+
+    /*在各个位置截断*/
+    TEST_PARSE_N_ERROR(PARSE_EXPECT_VALUE, "null", 0);
+    TEST_PARSE_N_ERROR(PARSE_EXPECT_VALUE, "  1", 2);
+    TEST_PARSE_N_ERROR(PARSE_INVALID_VALUE, "null", 3);
+    TEST_PARSE_N_ERROR(PARSE_INVALID_VALUE, "1.5", 2);
+    TEST_PARSE_N_ERROR(PARSE_INVALID_VALUE, "1e5", 2);
+    TEST_PARSE_N_ERROR(PARSE_MISS_QUOTATION_MARK, "\"abc\"", 4);
+    TEST_PARSE_N_ERROR(PARSE_INVALID_STRING_ESCAPE, "\"a\\n\"", 3);
+    TEST_PARSE_N_ERROR(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1, 2]", 5);
+    TEST_PARSE_N_ERROR(PARSE_EXPECT_VALUE, "[1, 2]", 3);
+    TEST_PARSE_N_ERROR(PARSE_MISS_KEY, "{\"k\":1}", 1);
+    TEST_PARSE_N_ERROR(PARSE_MISS_COLON, "{\"k\":1}", 4);
+    TEST_PARSE_N_ERROR(PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"k\":1}", 6);
+
+    /*中间的'\0'不再表示结束*/
+    TEST_PARSE_N_ERROR(PARSE_ROOT_NOT_SINGULAR, "null\0", 5);
+    TEST_PARSE_N_ERROR(PARSE_INVALID_STRING_CHAR, "\"a\0b\"", 5);
+    TEST_PARSE_N_ERROR(PARSE_INVALID_VALUE, "[\0]", 3);
+
+    /*长字符串恰好在len处结束，覆盖SIMD扫描最后一块的边界*/
+    for(n = 1; n < 80; n++){
+        buf = (char *)malloc(n + 2);
+        buf[0] = '\"';
+        for(i = 1; i <= n; i++)
+            buf[i] = 'a' + (char)(i % 26);
+        buf[n + 1] = '\"';
+        INIT_VALUE_NULL(&v);
+        EXPECT_EQ_INT(PARSE_OK, ParseN(&v, buf, n + 2));
+        EXPECT_EQ_SIZE_T(n, GetStringLength(&v));
+        FreeValue(&v);
+        TEST_PARSE_N_ERROR(PARSE_MISS_QUOTATION_MARK, buf, n + 1);
+        free(buf);
+    }
+}
+
+static void test_parse_document(){
+    CJSONDocument doc;
+    CJSONValue v, s;
+    CJSONValue *a;
+
+    InitDocument(&doc);
+    INIT_VALUE_NULL(&v);
+    INIT_VALUE_NULL(&s);
+    EXPECT_EQ_INT(PARSE_OK, ParseInDocument(&doc, &v, "{\"s\" : \"abc\", \"a\" : [1, [2, \"x\"], {}], \"n\" : null}"));
+    EXPECT_EQ_INT(TYPE_OBJECT, GetType(&v));
+    EXPECT_EQ_SIZE_T(3, GetObjectSize(&v));
+    EXPECT_EQ_STRING("s", GetObjectKey(&v, 0), GetObjectKeyLength(&v, 0));
+    EXPECT_EQ_STRING("abc", GetString(GetObjectValue(&v, 0)), GetStringLength(GetObjectValue(&v, 0)));
+    a = GetObjectValue(&v, 1);
+    EXPECT_EQ_INT(TYPE_ARRAY, GetType(a));
+    EXPECT_EQ_SIZE_T(3, GetArraySize(a));
+    EXPECT_EQ_DOUBLE(2.0, GetNumber(GetArrayElement(GetArrayElement(a, 1), 0)));
+    EXPECT_EQ_STRING("x", GetString(GetArrayElement(GetArrayElement(a, 1), 1)), 1);
+    EXPECT_EQ_INT(TYPE_OBJECT, GetType(GetArrayElement(a, 2)));
+    EXPECT_EQ_INT(TYPE_NULL, GetType(GetObjectValue(&v, 2)));
+    //文档中的节点只会被重置，内存由文档释放
+    FreeValue(&v);
+    EXPECT_EQ_INT(TYPE_NULL, GetType(&v));
+
+    //复用文档
+    ClearDocument(&doc);
+    EXPECT_EQ_INT(PARSE_OK, ParseInDocument(&doc, &v, "[\"Hello\", 123]"));
+    EXPECT_EQ_SIZE_T(2, GetArraySize(&v));
+    EXPECT_EQ_STRING("Hello", GetString(GetArrayElement(&v, 0)), GetStringLength(GetArrayElement(&v, 0)));
+    //所有节点都标记为文档中的节点，改写成数值、释放之后仍然标记着，SetString等会断言失败
+    a = GetArrayElement(&v, 1);
+    EXPECT_EQ_TRUE(a->flags & VALUE_FLAG_DOCUMENT);
+    SetNumber(GetArrayElement(&v, 0), 1.0);
+    EXPECT_EQ_TRUE(GetArrayElement(&v, 0)->flags & VALUE_FLAG_DOCUMENT);
+    FreeValue(a);
+    EXPECT_EQ_TRUE(a->flags & VALUE_FLAG_DOCUMENT);
+    //换成字符串要用CopyValueInDocument
+    SetString(&s, "a string longer than the short string buffer", 44);
+    CopyValueInDocument(&doc, a, &s);
+    FreeValue(&s);
+    EXPECT_EQ_STRING("a string longer than the short string buffer", GetString(a), GetStringLength(a));
+    EXPECT_EQ_TRUE(a->flags & VALUE_FLAG_DOCUMENT);
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_CURLY_BRACKET, ParseInDocument(&doc, &v, "{\"a\":[1, \"b\"]"));
+    EXPECT_EQ_INT(TYPE_NULL, GetType(&v));
+    FreeDocument(&doc);
+}
+
+static void test_parse_lazy(){
+    static const char *jsons[] = {
+        "null", "-1.5e3", "\"[{\\\"\"", "[]", "{}", " [ [ ] , { } ] ",
+        "[null, false, true, 123, \"a]b}c\", [1, [2, [3]]], {\"a\" : [], \"b\" : {}}]",
+        "{\"n\" : null, \"[\" : \"{\\\\\", \"s\" : \"\\u4E2D\\\"]\","
+        " \"a\" : [1, 2, 3], \"o\" : {\"1\" : 1, \"2\" : 2, \"3\" : {\"x\" : [{}]}}}"
+    };
+    CJSONDocument doc;
+    CJSONValue v, e;
+    CJSONValue *a, *o;
+    char *json1, *json2, buf[64];
+    size_t i, len1, len2;
+
+    InitDocument(&doc);
+    EXPECT_EQ_INT(PARSE_OK, ParseLazyInDocument(&doc, &v, "{\"s\" : \"a{b\", \"a\" : [1, [2, \"x]\"], {}], \"o\" : {\"k\" : true}}"));
+    //根这一层在解析时就展开，嵌套的数组、对象在第一次访问时才展开，只展开一层
+    EXPECT_EQ_INT(TYPE_OBJECT, GetType(&v));
+    EXPECT_EQ_INT(0, v.flags & VALUE_FLAG_LAZY);
+    EXPECT_EQ_SIZE_T(3, GetObjectSize(&v));
+    EXPECT_EQ_STRING("a{b", GetString(GetObjectValue(&v, 0)), GetStringLength(GetObjectValue(&v, 0)));
+    a = FindObjectValue(&v, "a", 1);
+    o = GetObjectValue(&v, 2);
+    EXPECT_EQ_TRUE(a->flags & VALUE_FLAG_LAZY);
+    EXPECT_EQ_TRUE(o->flags & VALUE_FLAG_LAZY);
+    EXPECT_EQ_INT(TYPE_ARRAY, GetType(a));
+    EXPECT_EQ_SIZE_T(3, GetArraySize(a));
+    EXPECT_EQ_STRING("x]", GetString(GetArrayElement(GetArrayElement(a, 1), 1)), 2);
+    EXPECT_EQ_SIZE_T(0, GetObjectSize(GetArrayElement(a, 2)));
+    //没有访问过的子树一直不展开
+    EXPECT_EQ_TRUE(o->flags & VALUE_FLAG_LAZY);
+    EXPECT_EQ_INT(TYPE_TRUE, GetType(FindObjectValue(o, "k", 1)));
+
+    //结构错误在解析时发现
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseLazyInDocument(&doc, &v, "[1, [2]"));
+    EXPECT_EQ_INT(TYPE_NULL, GetType(&v));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_CURLY_BRACKET, ParseLazyInDocument(&doc, &v, "{\"a\" : [1]"));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseLazyInDocument(&doc, &v, "{\"a\" : [1}"));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseLazyInDocument(&doc, &v, "[\"]\""));
+    EXPECT_EQ_INT(PARSE_MISS_QUOTATION_MARK, ParseLazyInDocument(&doc, &v, "[\"abc]"));
+    EXPECT_EQ_INT(PARSE_MISS_QUOTATION_MARK, ParseLazyInDocument(&doc, &v, "[\"abc\\\"]"));
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, ParseLazyInDocument(&doc, &v, "]"));
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, ParseLazyInDocument(&doc, &v, "nul"));
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, ParseLazyInDocument(&doc, &v, "[1] ]"));
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, ParseLazyInDocument(&doc, &v, "[1] [2]"));
+    //根这一层的语法错误也在解析时发现
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, ParseLazyInDocument(&doc, &v, "{\"a\" : [1, 2 3], \"b\" : tru}"));
+    EXPECT_EQ_INT(TYPE_NULL, GetType(&v));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseLazyInDocument(&doc, &v, "[1 [2]]"));
+    EXPECT_EQ_INT(PARSE_MISS_COLON, ParseLazyInDocument(&doc, &v, "{\"a\" {}}"));
+
+    //子树中的语法错误在展开时发现，展开失败的子树记下错误码，不会被当作空的数组、对象
+    EXPECT_EQ_INT(PARSE_OK, ParseLazyInDocument(&doc, &v, "[1, [2 3], {\"a\" : nul}, 4]"));
+    EXPECT_EQ_SIZE_T(4, GetArraySize(&v));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, MaterializeValue(GetArrayElement(&v, 1)));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, MaterializeValue(GetArrayElement(&v, 1)));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, MaterializeValue(&v));
+    EXPECT_EQ_TRUE(FindObjectValue(GetArrayElement(&v, 2), "a", 1) == NULL);
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, MaterializeValue(GetArrayElement(&v, 2)));
+    EXPECT_EQ_DOUBLE(4.0, GetNumber(GetArrayElement(&v, 3)));
+    //输入不合法不是调用方的错误，访问函数不断言，返回0或NULL
+    EXPECT_EQ_SIZE_T(0, GetArraySize(GetArrayElement(&v, 1)));
+    EXPECT_EQ_TRUE(GetArrayElement(GetArrayElement(&v, 1), 0) == NULL);
+    EXPECT_EQ_SIZE_T(0, GetArrayCapacity(GetArrayElement(&v, 1)));
+    EXPECT_EQ_SIZE_T(0, GetObjectSize(GetArrayElement(&v, 2)));
+    EXPECT_EQ_TRUE(GetObjectKey(GetArrayElement(&v, 2), 0) == NULL);
+    EXPECT_EQ_SIZE_T(0, GetObjectKeyLength(GetArrayElement(&v, 2), 0));
+    EXPECT_EQ_TRUE(GetObjectValue(GetArrayElement(&v, 2), 0) == NULL);
+    EXPECT_EQ_SIZE_T(0, GetObjectCapacity(GetArrayElement(&v, 2)));
+    //生成JSON失败，不会输出合法但内容不同的JSON
+    EXPECT_EQ_INT(STRINGIFY_INVALID_LAZY_VALUE, Stringify(&v, &json1, &len1));
+    EXPECT_EQ_TRUE(json1 == NULL);
+    EXPECT_EQ_SIZE_T(INVALID_LENGTH, StringifiedLength(&v));
+    EXPECT_EQ_INT(STRINGIFY_INVALID_LAZY_VALUE, StringifyInto(&v, buf, sizeof(buf), &len1));
+    //副本保留错误码，释放之后错误码随之清除
+    INIT_VALUE_NULL(&e);
+    CopyValue(&e, &v);
+    EXPECT_EQ_INT(STRINGIFY_INVALID_LAZY_VALUE, Stringify(&e, &json1, &len1));
+    FreeValue(&e);
+    FreeValue(GetArrayElement(&v, 1));
+    FreeValue(GetArrayElement(&v, 2));
+    EXPECT_EQ_INT(PARSE_OK, MaterializeValue(&v));
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &json1, &len1));
+    EXPECT_EQ_STRING("[1,null,null,4]", json1, len1);
+    free(json1);
+    //第一次访问就展开失败
+    EXPECT_EQ_INT(PARSE_OK, ParseLazyInDocument(&doc, &v, "[[1,2,tru]]"));
+    EXPECT_EQ_SIZE_T(0, GetArraySize(GetArrayElement(&v, 0)));
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, MaterializeValue(&v));
+    EXPECT_EQ_INT(PARSE_OK, ParseLazyInDocument(&doc, &v, "{\"a\" : [1, \"\\x\"]}"));
+    EXPECT_EQ_INT(PARSE_INVALID_STRING_ESCAPE, MaterializeValue(&v));
+    ClearDocument(&doc);
+
+    //和Parse的结果逐个比较，生成时展开所有子树
+    for(i = 0; i < sizeof(jsons) / sizeof(jsons[0]); i++){
+        INIT_VALUE_NULL(&e);
+        EXPECT_EQ_INT(PARSE_OK, Parse(&e, jsons[i]));
+        EXPECT_EQ_INT(PARSE_OK, ParseLazyInDocument(&doc, &v, jsons[i]));
+        EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&e, &json1, &len1));
+        EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &json2, &len2));
+        EXPECT_EQ_SIZE_T(len1, len2);
+        EXPECT_EQ_TRUE(memcmp(json1, json2, len1) == 0);
+        EXPECT_EQ_INT(PARSE_OK, MaterializeValue(&v));
+        free(json1);
+        free(json2);
+        FreeValue(&e);
+        ClearDocument(&doc);
+    }
+
+    //结构扫描每次处理64字节，让转义、字符串、括号落在块边界的各个位置
+    for(i = 0; i < 140; i++){
+        char json[256];
+        memset(json, ' ', i);
+        strcpy(json + i, "[\"\\\\\", \"\\\"]\\\\[\", [\"{\\\"\"], {\"}\" : [[]]}]");
+        INIT_VALUE_NULL(&e);
+        EXPECT_EQ_INT(PARSE_OK, Parse(&e, json));
+        EXPECT_EQ_INT(PARSE_OK, ParseLazyInDocument(&doc, &v, json));
+        EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&e, &json1, &len1));
+        EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &json2, &len2));
+        EXPECT_EQ_SIZE_T(len1, len2);
+        EXPECT_EQ_TRUE(memcmp(json1, json2, len1) == 0);
+        free(json1);
+        free(json2);
+        FreeValue(&e);
+        json[strlen(json) - 1] = '\0';
+        EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseLazyInDocument(&doc, &v, json));
+        ClearDocument(&doc);
+    }
+    FreeDocument(&doc);
+}
+
+//生成一个很大的数组，元素中的字符串带有逗号、括号和转义，用于检查并行解析的切分
+static char *make_large_array(size_t count){
+    static const char *elements[] = {
+        "%u", "\"s,%u]\\\"[\"", "{\"k\" : [%u, \"x,y\"], \"e\" : {}}", "true", "null", "[]",
+        "[[%u], {\"}\" : \"\\\\\"}]", "-%u.5e-3", "\"\\u4E2D,%u\""
+    };
+    char *json = (char *)malloc(count * 40 + 16);
+    size_t i, len = 0;
+    json[len++] = '[';
+    for(i = 0; i < count; i++){
+        if(i > 0)
+            len += sprintf(json + len, (i % 7 == 0) ? ",\n " : ",");
+        len += sprintf(json + len, elements[i % (sizeof(elements) / sizeof(elements[0]))], (unsigned)i);
+    }
+    json[len++] = ']';
+    json[len] = '\0';
+    return json;
+}
+
+static void test_parse_parallel(){
+    CJSONDocument doc1, doc2;
+    CJSONValue v1, v2;
+    char *json = make_large_array(20000), *json1, *json2;
+    size_t threads, len1, len2, len = strlen(json);
+
+    InitDocument(&doc1);
+    InitDocument(&doc2);
+    EXPECT_EQ_INT(PARSE_OK, ParseInDocument(&doc1, &v1, json));
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v1, &json1, &len1));
+    for(threads = 1; threads <= 8; threads++){
+        EXPECT_EQ_INT(PARSE_OK, ParseParallelInDocument(&doc2, &v2, json, threads));
+        EXPECT_EQ_SIZE_T(20000, GetArraySize(&v2));
+        EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v2, &json2, &len2));
+        EXPECT_EQ_SIZE_T(len1, len2);
+        EXPECT_EQ_TRUE(memcmp(json1, json2, len1) == 0);
+        free(json2);
+        ClearDocument(&doc2);
+    }
+    free(json1);
+
+    //出错时和ParseInDocument的结果一致
+    json[len - 1] = ' ';
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseParallelInDocument(&doc2, &v2, json, 4));
+    json[len - 1] = '}';
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseParallelInDocument(&doc2, &v2, json, 4));
+    json[len - 1] = ']';
+    strstr(json + len / 2, ",\n ")[0] = ' ';
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseParallelInDocument(&doc2, &v2, json, 4));
+    EXPECT_EQ_INT(TYPE_NULL, GetType(&v2));
+    free(json);
+    json = make_large_array(20000);
+    strstr(json + len / 3 * 2, ",\n ")[1] = '#';
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, ParseParallelInDocument(&doc2, &v2, json, 4));
+    json = (char *)realloc(json, len + 8);
+    strstr(json + len / 3 * 2, ",# ")[1] = '\n';
+    strcpy(json + len, " [1]");
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, ParseParallelInDocument(&doc2, &v2, json, 4));
+    strcpy(json + len, " \n ");
+    EXPECT_EQ_INT(PARSE_OK, ParseParallelInDocument(&doc2, &v2, json, 4));
+    EXPECT_EQ_SIZE_T(20000, GetArraySize(&v2));
+    free(json);
+
+    //根节点不是数组、输入太小时等同于ParseInDocument
+    EXPECT_EQ_INT(PARSE_OK, ParseParallelInDocument(&doc2, &v2, " {\"a\" : [1, 2]} ", 4));
+    EXPECT_EQ_SIZE_T(2, GetArraySize(FindObjectValue(&v2, "a", 1)));
+    EXPECT_EQ_INT(PARSE_OK, ParseParallelInDocument(&doc2, &v2, "[1, 2]", 4));
+    EXPECT_EQ_SIZE_T(2, GetArraySize(&v2));
+    EXPECT_EQ_INT(PARSE_EXPECT_VALUE, ParseParallelInDocument(&doc2, &v2, "  ", 4));
+    FreeDocument(&doc1);
+    FreeDocument(&doc2);
+}
+
+//生成嵌套depth层的数组，最里层是1；object不为0时每层是{"a":...}
+static char *make_nested(size_t depth, int object){
+    char *json = (char *)malloc(depth * 6 + 2), *p = json;
+    size_t i;
+    for(i = 0; i < depth; i++){
+        if(object){
+            memcpy(p, "{\"a\":", 5);
+            p += 5;
+        }
+        else
+            *p++ = '[';
+    }
+    *p++ = '1';
+    for(i = 0; i < depth; i++)
+        *p++ = object ? '}' : ']';
+    *p = '\0';
+    return json;
+}
+
+static void test_parse_depth(){
+    //默认的PARSE_MAX_DEPTH是1024
+    const size_t limit = 1024;
+    CJSONHandler handler = { 0 };
+    CJSONDocument doc;
+    CJSONTape tape;
+    CJSONParser *p;
+    CJSONValue v, *e;
+    char *json, *out;
+    size_t i, len, object;
+
+    InitDocument(&doc);
+    InitTape(&tape);
+    for(object = 0; object <= 1; object++){
+        json = make_nested(limit, (int)object);
+        len = strlen(json);
+        EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));
+        EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &out, &i));
+        EXPECT_EQ_SIZE_T(len, i);
+        EXPECT_EQ_TRUE(memcmp(json, out, len) == 0);
+        EXPECT_EQ_SIZE_T(len, StringifiedLength(&v));
+        free(out);
+        FreeValue(&v);
+        EXPECT_EQ_INT(PARSE_OK, ParseLazyInDocument(&doc, &v, json));
+        EXPECT_EQ_INT(PARSE_OK, MaterializeValue(&v));
+        free(json);
+
+        //多一层就报错，各种解析方式一致
+        json = make_nested(limit + 1, (int)object);
+        len = strlen(json);
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, Parse(&v, json));
+        EXPECT_EQ_INT(TYPE_NULL, GetType(&v));
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParseN(&v, json, len));
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParseInDocument(&doc, &v, json));
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParseLazyInDocument(&doc, &v, json));
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParseWithHandler(json, &handler));
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParseTape(&tape, json));
+        p = ParserCreate();
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParserParse(p, &v, json, len));
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParserFeed(p, json, len));
+        EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParserFinish(p, &v));
+        ParserDestroy(p);
+        free(json);
+    }
+
+    //恶意的深层嵌套不会耗尽调用栈
+    json = (char *)malloc(1000001);
+    memset(json, '[', 1000000);
+    json[1000000] = '\0';
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, Parse(&v, json));
+    EXPECT_EQ_INT(PARSE_DEPTH_EXCEEDED, ParseLazyInDocument(&doc, &v, json));
+    free(json);
+
+    //构造出的节点树没有层数限制，生成和释放都不递归
+    INIT_VALUE_NULL(&v);
+    for(i = 0, e = &v; i < 1000000; i++){
+        e->type = TYPE_ARRAY;
+        e->flags = 0;
+        e->u.a.size = 1;
+        e->u.a.e = (CJSONValue *)malloc(sizeof(CJSONValue));
+        e = e->u.a.e;
+    }
+    e->type = TYPE_NULL;
+    e->flags = 0;
+    EXPECT_EQ_SIZE_T(2000004, StringifiedLength(&v));
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &out, &len));
+    EXPECT_EQ_SIZE_T(2000004, len);
+    EXPECT_EQ_TRUE(memcmp(out + 999999, "[null]", 6) == 0);
+    free(out);
+    FreeValue(&v);
+    EXPECT_EQ_INT(TYPE_NULL, GetType(&v));
+    FreeTape(&tape);
+    FreeDocument(&doc);
+}
+
+//把ParseLines交付的每一行记录成"行号 错误码 内容\n"，limit行之后中止
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t calls;
+    size_t limit;
+} LineRecorder;
+
+static int record_line(void *user, size_t line, int ret, const CJSONValue *v){
+    LineRecorder *rec = (LineRecorder *)user;
+    char *json = NULL;
+    size_t len = 0;
+    if(ret == PARSE_OK)
+        Stringify(v, &json, &len);
+    if(rec->len + len + 32 > rec->cap){
+        rec->cap = (rec->len + len + 32) * 2;
+        rec->buf = (char *)realloc(rec->buf, rec->cap);
+    }
+    rec->len += sprintf(rec->buf + rec->len, "%u %d ", (unsigned)line, ret);
+    if(len > 0)
+        memcpy(rec->buf + rec->len, json, len);
+    rec->len += len;
+    rec->buf[rec->len++] = '\n';
+    free(json);
+    return ++rec->calls != rec->limit;
+}
+
+static void test_parse_lines(){
+    static const char *records[] = {
+        "{\"id\" : %u, \"tags\" : [\"a\", \"b\"]}", "[%u, {\"\\n\" : null}]", "  \"s%u\"  ", "%u.25e1", "",
+        "{\"bad\" : %u,}", "true\r", " \t", "{\"u\" : \"\\u4E2D%u\"}"
+    };
+    const char *small = "{\"a\" : 1}\n\n  [true, null]\r\n{\"a\" : }\n\"x\"";
+    LineRecorder rec1 = { NULL, 0, 0, 0, 0 }, rec2;
+    char *json = (char *)malloc(40000 * 48);
+    size_t i, threads, len = 0;
+
+    EXPECT_EQ_INT(PARSE_OK, ParseLines(small, strlen(small), 4, record_line, &rec1));
+    EXPECT_EQ_SIZE_T(4, rec1.calls);
+    rec1.buf[rec1.len] = '\0';
+    EXPECT_EQ_TRUE(strcmp(rec1.buf, "1 0 {\"a\":1}\n3 0 [true,null]\n4 2 \n5 0 \"x\"\n") == 0);
+    free(rec1.buf);
+    rec1.buf = NULL;
+    rec1.len = rec1.cap = rec1.calls = 0;
+    EXPECT_EQ_INT(PARSE_OK, ParseLines(NULL, 0, 4, record_line, &rec1));
+    EXPECT_EQ_INT(PARSE_OK, ParseLines("\n \n", 3, 4, record_line, &rec1));
+    EXPECT_EQ_SIZE_T(0, rec1.calls);
+    //最后一行没有'\n'，输入正好到缓冲区的结尾为止
+    memcpy(json, "[1]\n2", 5);
+    {
+        char *exact = (char *)memcpy(malloc(5), json, 5);
+        EXPECT_EQ_INT(PARSE_OK, ParseLines(exact, 5, 4, record_line, &rec1));
+        free(exact);
+    }
+    EXPECT_EQ_SIZE_T(2, rec1.calls);
+    rec1.buf[rec1.len] = '\0';
+    EXPECT_EQ_TRUE(strcmp(rec1.buf, "1 0 [1]\n2 0 2\n") == 0);
+    free(rec1.buf);
+    rec1.buf = NULL;
+    rec1.len = rec1.cap = rec1.calls = 0;
+
+    //多批输入，各线程数下交付的内容和顺序都相同
+    for(i = 0; i < 40000; i++){
+        len += sprintf(json + len, records[i % (sizeof(records) / sizeof(records[0]))], (unsigned)i);
+        json[len++] = '\n';
+    }
+    EXPECT_EQ_INT(PARSE_OK, ParseLines(json, len, 1, record_line, &rec1));
+    EXPECT_EQ_SIZE_T(40000 / 9 * 7 + 4, rec1.calls);
+    for(threads = 2; threads <= 8; threads++){
+        rec2 = (LineRecorder){ NULL, 0, 0, 0, 0 };
+        EXPECT_EQ_INT(PARSE_OK, ParseLines(json, len - 1, threads, record_line, &rec2));
+        EXPECT_EQ_SIZE_T(rec1.len, rec2.len);
+        EXPECT_EQ_TRUE(memcmp(rec1.buf, rec2.buf, rec1.len) == 0);
+        free(rec2.buf);
+    }
+
+    //回调返回0时停止，之后的行不再交付
+    rec2 = (LineRecorder){ NULL, 0, 0, 0, 12345 };
+    EXPECT_EQ_INT(PARSE_TERMINATED, ParseLines(json, len, 4, record_line, &rec2));
+    EXPECT_EQ_SIZE_T(12345, rec2.calls);
+    EXPECT_EQ_TRUE(memcmp(rec1.buf, rec2.buf, rec2.len) == 0);
+    free(rec2.buf);
+    free(rec1.buf);
+    free(json);
+}
+
+//统计申请和释放次数的分配器，用于检查分配器是否被正确使用
+typedef struct {
+    size_t allocs;
+    size_t frees;
+} CountingStats;
+
+static void *CountingAlloc(void *user, size_t size){
+    ((CountingStats *)user)->allocs++;
+    return malloc(size);
+}
+
+static void *CountingRealloc(void *user, void *p, size_t size){
+    if(p == NULL)
+        ((CountingStats *)user)->allocs++;
+    return realloc(p, size);
+}
+
+static void CountingFree(void *user, void *p){
+    ((CountingStats *)user)->frees++;
+    free(p);
+}
+
+//比较节点树和磁带中的值是否相同，返回值之后的下标
+static size_t check_tape_equal(const CJSONValue *v, const CJSONTape *tape, size_t t){
+    size_t i;
+    EXPECT_EQ_INT(GetType(v), GetTapeType(tape, t));
+    switch(GetType(v)){
+        case TYPE_NUMBER:
+            EXPECT_EQ_DOUBLE(GetNumber(v), GetTapeNumber(tape, t));
+            break;
+        case TYPE_STRING:
+            EXPECT_EQ_SIZE_T(GetStringLength(v), GetTapeStringLength(tape, t));
+            EXPECT_EQ_TRUE(memcmp(GetString(v), GetTapeString(tape, t), GetStringLength(v) + 1) == 0);
+            break;
+        case TYPE_ARRAY:
+            EXPECT_EQ_SIZE_T(GetArraySize(v), GetTapeArraySize(tape, t));
+            for(i = 0, t++; i < GetArraySize(v); i++)
+                t = check_tape_equal(GetArrayElement(v, i), tape, t);
+            return t + 1;
+        case TYPE_OBJECT:
+            EXPECT_EQ_SIZE_T(GetObjectSize(v), GetTapeObjectSize(tape, t));
+            for(i = 0, t++; i < GetObjectSize(v); i++){
+                EXPECT_EQ_SIZE_T(GetObjectKeyLength(v, i), GetTapeStringLength(tape, t));
+                EXPECT_EQ_TRUE(memcmp(GetObjectKey(v, i), GetTapeString(tape, t), GetObjectKeyLength(v, i) + 1) == 0);
+                t = check_tape_equal(GetObjectValue(v, i), tape, t + 2);
+            }
+            return t + 1;
+        default:
+            break;
+    }
+    return GetTapeNext(tape, t);
+}
+
+static void test_parse_tape(){
+    static const char *jsons[] = {
+        "null", "true", "-1.5e3", "\"\"", "\"a\\u0000b\\ud834\\udd1e\"", "[]", "{}",
+        "[null, false, true, 123, \"abc\", [1, [2, [3]]], {\"a\" : [], \"b\" : {}}]",
+        "{\"n\" : null, \"f\" : false, \"t\" : true, \"i\" : 123, \"s\" : \"abc\","
+        " \"a\" : [1, 2, 3], \"o\" : {\"1\" : 1, \"2\" : 2, \"3\" : {\"x\" : [{}]}}}"
+    };
+    CJSONTape tape;
+    CJSONValue v;
+    size_t i, a, o, e;
+
+    InitTape(&tape);
+    EXPECT_EQ_INT(PARSE_OK, ParseTape(&tape, " [ 1 , \"ab\" , [ true , [ ] ] , { \"k\" : null , \"kk\" : false } , 2 ] "));
+    EXPECT_EQ_INT(TYPE_ARRAY, GetTapeType(&tape, 0));
+    EXPECT_EQ_SIZE_T(5, GetTapeArraySize(&tape, 0));
+    //根节点之后就是磁带的末尾
+    EXPECT_EQ_SIZE_T(tape.size, GetTapeNext(&tape, 0));
+    EXPECT_EQ_DOUBLE(1.0, GetTapeNumber(&tape, GetTapeArrayElement(&tape, 0, 0)));
+    e = GetTapeArrayElement(&tape, 0, 1);
+    EXPECT_EQ_STRING("ab", GetTapeString(&tape, e), GetTapeStringLength(&tape, e));
+    a = GetTapeArrayElement(&tape, 0, 2);
+    EXPECT_EQ_SIZE_T(2, GetTapeArraySize(&tape, a));
+    EXPECT_EQ_TRUE(GetTapeBoolean(&tape, GetTapeArrayElement(&tape, a, 0)));
+    EXPECT_EQ_SIZE_T(0, GetTapeArraySize(&tape, GetTapeArrayElement(&tape, a, 1)));
+    o = GetTapeArrayElement(&tape, 0, 3);
+    EXPECT_EQ_SIZE_T(o, GetTapeNext(&tape, a));
+    EXPECT_EQ_INT(TYPE_OBJECT, GetTapeType(&tape, o));
+    EXPECT_EQ_SIZE_T(2, GetTapeObjectSize(&tape, o));
+    EXPECT_EQ_STRING("kk", GetTapeObjectKey(&tape, o, 1), GetTapeObjectKeyLength(&tape, o, 1));
+    EXPECT_EQ_INT(TYPE_NULL, GetTapeType(&tape, GetTapeObjectValue(&tape, o, 0)));
+    EXPECT_EQ_INT(0, GetTapeBoolean(&tape, FindTapeObjectValue(&tape, o, "kk", 2)));
+    EXPECT_EQ_SIZE_T(GetTapeObjectValue(&tape, o, 0), FindTapeObjectValue(&tape, o, "k", 1));
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindTapeObjectValue(&tape, o, "kkk", 3));
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindTapeObjectValue(&tape, o, "", 0));
+    EXPECT_EQ_DOUBLE(2.0, GetTapeNumber(&tape, GetTapeArrayElement(&tape, 0, 4)));
+
+    //失败时磁带为空，再次解析时复用内存
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseTape(&tape, "[1, {\"a\" : [2}]"));
+    EXPECT_EQ_SIZE_T(0, tape.size);
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, ParseTape(&tape, "[] x"));
+    EXPECT_EQ_SIZE_T(0, tape.size);
+    EXPECT_EQ_INT(PARSE_INVALID_UTF8, ParseTape(&tape, "{\"a\" : \"\xC0\"}"));
+    EXPECT_EQ_SIZE_T(0, tape.size);
+
+    //与节点树逐个比较
+    for(i = 0; i < sizeof(jsons) / sizeof(jsons[0]); i++){
+        INIT_VALUE_NULL(&v);
+        EXPECT_EQ_INT(PARSE_OK, Parse(&v, jsons[i]));
+        EXPECT_EQ_INT(PARSE_OK, ParseTape(&tape, jsons[i]));
+        EXPECT_EQ_SIZE_T(tape.size, check_tape_equal(&v, &tape, 0));
+        FreeValue(&v);
+    }
+    FreeTape(&tape);
+    FreeTape(&tape);
+}
+
+static void test_parse_allocator(){
+    CountingStats stats = {0, 0};
+    CJSONAllocator allocator = { CountingAlloc, CountingRealloc, CountingFree, NULL };
+    CJSONDocument doc;
+    CJSONValue v;
+    char *json;
+    size_t length;
+    allocator.user = &stats;
+
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, ParseWithAllocator(&v, "{\"a\" : [1, \"b\", {\"c\" : \"d\"}]}", &allocator));
+    EXPECT_EQ_TRUE(stats.allocs > 0);
+    EXPECT_EQ_INT(STRINGIFY_OK, StringifyWithAllocator(&v, &json, &length, &allocator));
+    EXPECT_EQ_STRING("{\"a\":[1,\"b\",{\"c\":\"d\"}]}", json, length);
+    CountingFree(&stats, json);
+    FreeValueWithAllocator(&v, &allocator);
+    EXPECT_EQ_SIZE_T(stats.allocs, stats.frees);
+
+    //解析出错时，已经申请的内存也要还给分配器
+    stats.allocs = stats.frees = 0;
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_CURLY_BRACKET, ParseWithAllocator(&v, "{\"a\" : [\"b\"], \"c\" : \"d\"", &allocator));
+    EXPECT_EQ_SIZE_T(stats.allocs, stats.frees);
+
+    //替换默认分配器
+    stats.allocs = stats.frees = 0;
+    SetAllocator(&allocator);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, "[\"abc\", [\"def\"]]"));
+    SetString(GetArrayElement(&v, 0), "xyz", 3);
+    FreeValue(&v);
+    InitDocument(&doc);
+    SetAllocator(NULL);
+    EXPECT_EQ_INT(PARSE_OK, ParseInDocument(&doc, &v, "[\"abc\", [\"def\"]]"));
+    FreeDocument(&doc);
+    EXPECT_EQ_TRUE(stats.allocs > 0);
+    EXPECT_EQ_SIZE_T(stats.allocs, stats.frees);
+}
+
+//把SAX事件记录成一个字符串，检查事件的顺序和内容
+typedef struct {
+    char trace[256];
+    size_t len;
+    int stopAfter;    //收到这么多个事件后中止解析，0表示不中止
+    int events;
+} TraceHandler;
+
+static int TraceAppend(TraceHandler *t, const char *s, size_t len){
+    memcpy(t->trace + t->len, s, len);
+    t->len += len;
+    t->trace[t->len++] = ' ';
+    t->trace[t->len] = '\0';
+    return !(t->stopAfter > 0 && ++t->events >= t->stopAfter);
+}
+
+static int TraceNull(void *user){ return TraceAppend((TraceHandler *)user, "null", 4); }
+static int TraceBoolean(void *user, int b){ return TraceAppend((TraceHandler *)user, b ? "true" : "false", b ? 4 : 5); }
+static int TraceNumber(void *user, double n){
+    char buffer[32];
+    return TraceAppend((TraceHandler *)user, buffer, sprintf(buffer, "%g", n));
+}
+static int TraceString(void *user, const char *s, size_t len){ return TraceAppend((TraceHandler *)user, s, len); }
+static int TraceStartObject(void *user){ return TraceAppend((TraceHandler *)user, "{", 1); }
+static int TraceKey(void *user, const char *k, size_t klen){
+    TraceHandler *t = (TraceHandler *)user;
+    TraceAppend(t, k, klen);
+    return TraceAppend(t, ":", 1);
+}
+static int TraceEndObject(void *user, size_t size){
+    char buffer[32];
+    return TraceAppend((TraceHandler *)user, buffer, sprintf(buffer, "}%u", (unsigned)size));
+}
+static int TraceStartArray(void *user){ return TraceAppend((TraceHandler *)user, "[", 1); }
+static int TraceEndArray(void *user, size_t size){
+    char buffer[32];
+    return TraceAppend((TraceHandler *)user, buffer, sprintf(buffer, "]%u", (unsigned)size));
+}
+
+static int CountNumber(void *user, double n){
+    (*(int *)user)++;
+    return 1;
+}
+
+static void test_parse_handler(){
+    TraceHandler t;
+    CJSONHandler handler = { TraceNull, TraceBoolean, TraceNumber, TraceString, TraceStartObject,
+        TraceKey, TraceEndObject, TraceStartArray, TraceEndArray, NULL };
+    CJSONHandler numbers = { NULL, NULL, CountNumber, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    int count = 0;
+    handler.user = &t;
+
+    memset(&t, 0, sizeof(t));
+    EXPECT_EQ_INT(PARSE_OK, ParseWithHandler(" { \"a\" : [1, \"x\\ny\", {}], \"b\" : [ ], \"c\" : null, \"d\" : true } ", &handler));
+    EXPECT_EQ_STRING("{ a : [ 1 x\ny { }0 ]3 b : [ ]0 c : null d : true }4 ", t.trace, t.len);
+
+    //出错前已经产生的事件不会撤销
+    memset(&t, 0, sizeof(t));
+    EXPECT_EQ_INT(PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ParseWithHandler("[false, 2 3]", &handler));
+    EXPECT_EQ_STRING("[ false 2 ", t.trace, t.len);
+    memset(&t, 0, sizeof(t));
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, ParseWithHandler("\"abc\" x", &handler));
+    EXPECT_EQ_STRING("abc ", t.trace, t.len);
+
+    //处理函数返回0时中止解析
+    memset(&t, 0, sizeof(t));
+    t.stopAfter = 3;
+    EXPECT_EQ_INT(PARSE_TERMINATED, ParseWithHandler("[1, [2, 3], 4]", &handler));
+    EXPECT_EQ_STRING("[ 1 [ ", t.trace, t.len);
+
+    //没有设置的回调忽略对应的事件
+    numbers.user = &count;
+    EXPECT_EQ_INT(PARSE_OK, ParseWithHandler("{\"a\" : [1, 2, {\"b\" : 3}], \"c\" : \"4\"}", &numbers));
+    EXPECT_EQ_INT(3, count);
+}
+
+//把json按每块step字节输入增量解析器，结果应该和Parse完全相同
+static void TestParserChunks(const char *json, size_t step){
+    CJSONParser *p = ParserCreate();
+    CJSONValue expect, actual;
+    size_t len = strlen(json), i;
+    int ret;
+    char *s1, *s2;
+    size_t l1, l2;
+
+    for(i = 0; i < len; i += step)
+        ParserFeed(p, json + i, (len - i < step) ? len - i : step);
+    ret = ParserFinish(p, &actual);
+    EXPECT_EQ_INT(Parse(&expect, json), ret);
+    if(ret == PARSE_OK){
+        Stringify(&expect, &s1, &l1);
+        Stringify(&actual, &s2, &l2);
+        EXPECT_EQ_SIZE_T(l1, l2);
+        EXPECT_EQ_TRUE(memcmp(s1, s2, l1) == 0);
+        free(s1);
+        free(s2);
+    }
+    else
+        EXPECT_EQ_INT(TYPE_NULL, GetType(&actual));
+    FreeValue(&expect);
+    FreeValue(&actual);
+    ParserDestroy(p);
+}
+
+static void test_parser(){
+    static const char *jsons[] = {
+        " null ", "true", "false", "0", "-0.0", "123", "1.5e-3", "1.7976931348623157e+308", "12345678901234567890123",
+        "\"\"", "\"abc\"", "\"a\\tb\\\\c\\\"d\\/\"", "[ ]", "[1, [2, [3, \"x\"]], {}]", "{ }",
+        "{\"a\" : 1, \"b\" : [true, false, null], \"c\" : {\"d\" : \"e\\n\"}}",
+        "\"\\u0024\\u00A2\\u20AC\\uD834\\uDD1E\"", "{\"\\u00e9\" : \"\xC3\xA9\\u0000\"}",
+        /* 错误 */
+        "", " ", "nul", "nulx", "?", "+1", ".5", "1.", "1e", "0123", "1x", "-", "1e309",
+        "\"abc", "\"a\\vb\"", "\"a\x01\"", "[1", "[1,", "[1,]", "[1 2]", "[1x]", "{", "{1:2}", "{\"a\"",
+        "{\"a\" 1}", "{\"a\":", "{\"a\":1", "{\"a\":1,}", "{\"a\":1 \"b\":2}", "{\"a\":1x}", "null x", "[] []",
+        "\"\\u", "\"\\u12\"", "\"\\u12g4\"", "\"\\uD800", "\"\\uD800\"", "\"\\uD800\\n\"", "\"\\uD800\\u",
+        "\"\\uD800\\uDBFF\"", "\"\\uD800\\u00x0\"", "\"\\uDC00\"", "\"\xC3\"", "\"\xED\xA0\x80\"", "{\"\xFF\" : 1}"
+    };
+    CJSONParser *p;
+    TraceHandler t;
+    CJSONHandler handler = { TraceNull, TraceBoolean, TraceNumber, TraceString, TraceStartObject,
+        TraceKey, TraceEndObject, TraceStartArray, TraceEndArray, NULL };
+    const char *json = "{\"a\" : [1, \"x\\ny\", {}], \"b\" : null}";
+    size_t i, step;
+
+    for(i = 0; i < sizeof(jsons) / sizeof(jsons[0]); i++)
+        for(step = 1; step <= 8; step++)
+            TestParserChunks(jsons[i], step);
+
+    //逐字节输入，产生的事件和ParseWithHandler相同
+    p = ParserCreate();
+    handler.user = &t;
+    memset(&t, 0, sizeof(t));
+    ParserSetHandler(p, &handler);
+    for(i = 0; json[i]; i++)
+        EXPECT_EQ_INT(PARSE_OK, ParserFeed(p, json + i, 1));
+    EXPECT_EQ_INT(PARSE_OK, ParserFinish(p, NULL));
+    EXPECT_EQ_STRING("{ a : [ 1 x\ny { }0 ]3 b : null }2 ", t.trace, t.len);
+
+    //输入中的'\0'表示文本结束，之后不能再有内容
+    memset(&t, 0, sizeof(t));
+    EXPECT_EQ_INT(PARSE_OK, ParserFeed(p, "[1]\0", 4));
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, ParserFeed(p, "2", 1));
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, ParserFinish(p, NULL));
+    ParserDestroy(p);
+
+    //解析到一半销毁，未完成的节点也要释放
+    p = ParserCreate();
+    EXPECT_EQ_INT(PARSE_OK, ParserFeed(p, "{\"a\" : [\"b\", {\"c\" : \"d", 22));
+    ParserDestroy(p);
+}
+
+static void test_parser_parse(){
+    static const char *jsons[] = {
+        "{\"id\" : 1, \"tags\" : [\"a\", \"b\\n\"], \"ok\" : true}", "[1, [2, [3, \"x\"]], {}]", " \"abc\" ", "-1.5e3",
+        "", "[1,]", "{\"a\" : [\"b\"], \"c\" : \"d\"", "\"\xC3\"", "null x"
+    };
+    CountingStats stats = {0, 0};
+    CJSONAllocator allocator = { CountingAlloc, CountingRealloc, CountingFree, NULL };
+    CJSONParser *p;
+    CJSONValue v1, v2;
+    char *json1, *json2;
+    size_t i, len1, len2, allocs;
+    allocator.user = &stats;
+
+    //和ParseN的结果相同，出错的情况也一样
+    p = ParserCreate();
+    for(i = 0; i < sizeof(jsons) / sizeof(jsons[0]); i++){
+        EXPECT_EQ_INT(ParseN(&v1, jsons[i], strlen(jsons[i])), ParserParse(p, &v2, jsons[i], strlen(jsons[i])));
+        EXPECT_EQ_INT(GetType(&v1), GetType(&v2));
+        if(GetType(&v1) != TYPE_NULL){
+            EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v1, &json1, &len1));
+            EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v2, &json2, &len2));
+            EXPECT_EQ_SIZE_T(len1, len2);
+            EXPECT_EQ_TRUE(memcmp(json1, json2, len1) == 0);
+            free(json1);
+            free(json2);
+        }
+        FreeValue(&v1);
+        FreeValue(&v2);
+    }
+    EXPECT_EQ_INT(PARSE_ROOT_NOT_SINGULAR, ParserParse(p, &v2, "[1]\0", 4));
+    FreeValue(&v2);
+
+    //和增量解析交替使用，ParserReset放弃解析到一半的文档
+    EXPECT_EQ_INT(PARSE_OK, ParserFeed(p, "{\"a\" : [\"b\", {\"c\" : \"d", 22));
+    ParserReset(p);
+    EXPECT_EQ_INT(PARSE_OK, ParserParse(p, &v2, "[true]", 6));
+    EXPECT_EQ_INT(TYPE_TRUE, GetType(GetArrayElement(&v2, 0)));
+    FreeValue(&v2);
+    EXPECT_EQ_INT(PARSE_OK, ParserFeed(p, "[fal", 4));
+    EXPECT_EQ_INT(PARSE_OK, ParserFeed(p, "se]", 3));
+    EXPECT_EQ_INT(PARSE_OK, ParserFinish(p, &v2));
+    EXPECT_EQ_INT(TYPE_FALSE, GetType(GetArrayElement(&v2, 0)));
+    FreeValue(&v2);
+    ParserDestroy(p);
+
+    //栈在多次解析之间复用，之后只有节点本身的申请
+    SetAllocator(&allocator);
+    p = ParserCreate();
+    EXPECT_EQ_INT(PARSE_OK, ParserParse(p, &v2, jsons[0], strlen(jsons[0])));
+    FreeValue(&v2);
+    allocs = stats.allocs;
+    EXPECT_EQ_INT(PARSE_OK, ParserParse(p, &v2, jsons[0], strlen(jsons[0])));
+    FreeValue(&v2);
+    len1 = stats.allocs - allocs;
+    allocs = stats.allocs;
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v1, jsons[0]));
+    FreeValue(&v1);
+    EXPECT_EQ_SIZE_T(len1 + 1, stats.allocs - allocs);
+    //收缩之后栈重新申请
+    ParserShrink(p, 0);
+    allocs = stats.allocs;
+    EXPECT_EQ_INT(PARSE_OK, ParserParse(p, &v2, jsons[0], strlen(jsons[0])));
+    FreeValue(&v2);
+    EXPECT_EQ_SIZE_T(len1 + 1, stats.allocs - allocs);
+    ParserShrink(p, 1024);
+    ParserShrink(p, 1);
+    EXPECT_EQ_INT(PARSE_OK, ParserParse(p, &v2, jsons[1], strlen(jsons[1])));
+    FreeValue(&v2);
+    ParserDestroy(p);
+    SetAllocator(NULL);
+    EXPECT_EQ_SIZE_T(stats.allocs, stats.frees);
+}
+
 #define TEST_ERROR(error, json)\
     do {\
         CJSONValue v;\
@@ -270,6 +1268,8 @@ static void test_parse_root_not_singular(){
 static void test_parse_number_to_big(){
     TEST_ERROR(PARSE_NUMBER_TOO_BIG, "1e309");
     TEST_ERROR(PARSE_NUMBER_TOO_BIG, "-1e309");
+    TEST_ERROR(PARSE_NUMBER_TOO_BIG, "1.7976931348623159e308");
+    TEST_ERROR(PARSE_NUMBER_TOO_BIG, "179769313486231580793728971405303415079934132710037826936173778980444968292764750946649017977587207096330286416692887910946555547851940402630657488671505820681908902000708383676273854845817711531764475730270069855571366959622842914819860834936475292719074168444365510704342711559699508093042880177904174497792");
 }
 
 static void test_parse_missing_quotation_mark(){
@@ -278,19 +1278,63 @@ static void test_parse_missing_quotation_mark(){
 }
 
 static void test_parse_invalid_string_escape() {
-#if 0
-    TEST_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE, "\"\\v\"");
-    TEST_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE, "\"\\'\"");
-    TEST_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE, "\"\\0\"");
-    TEST_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE, "\"\\x12\"");
-#endif
+    TEST_ERROR(PARSE_INVALID_STRING_ESCAPE, "\"\\v\"");
+    TEST_ERROR(PARSE_INVALID_STRING_ESCAPE, "\"\\'\"");
+    TEST_ERROR(PARSE_INVALID_STRING_ESCAPE, "\"\\0\"");
+    TEST_ERROR(PARSE_INVALID_STRING_ESCAPE, "\"\\x12\"");
+}
+
+static void test_parse_invalid_unicode_hex(){
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u0\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u01\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u012\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u/000\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\uG000\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u0/00\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u0G00\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u00/0\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u00G0\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u000/\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u000G\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\u 123\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_HEX, "\"\\uD800\\u12\"");
+}
+
+static void test_parse_invalid_unicode_surrogate(){
+    TEST_ERROR(PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDBFF\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\\\\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uDBFF\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uE000\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDC00\"");
+    TEST_ERROR(PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDFFF\\uDC00\"");
+}
+
+static void test_parse_invalid_utf8(){
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\x80\"");                  /* 单独的后续字节 */
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xBF\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xC0\xAF\"");              /* 过长编码 */
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xC1\xBF\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xE0\x80\xAF\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xF0\x80\x80\xAF\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");          /* 代理项 U+D800 */
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"");      /* 超过U+10FFFF */
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xF5\x80\x80\x80\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xFF\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xC3\"");                  /* 不完整的序列 */
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xE2\x82\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xE2\x82x\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xF0\x9F\x98\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"\xC3\\u00A9\"");          /* 首字节之后是转义得到的字符 */
+    TEST_ERROR(PARSE_INVALID_UTF8, "\"0123456789abcdef0123456789ABCDEF0123456789abcdef\x80\"");
+    TEST_ERROR(PARSE_INVALID_UTF8, "{\"\xC3\x28\" : 1}");
 }
 
 static void test_parse_invalid_string_char(){
-#if 0
-    TEST_ERROR(PARSE_INVALID_STRING_ESCAPE, "\"\x01\"");
-    TEST_ERROR(PARSE_INVALID_STRING_ESCAPE, "\"\x1F\"");
-#endif
+    TEST_ERROR(PARSE_INVALID_STRING_CHAR, "\"\x01\"");
+    TEST_ERROR(PARSE_INVALID_STRING_CHAR, "\"\x1F\"");
+    TEST_ERROR(PARSE_INVALID_STRING_CHAR, "\"0123456789abcdef0123456789ABCDEF\x1F\"");
 }
 
 static void test_parse_miss_comma_or_square_bracket(){
@@ -355,6 +1399,269 @@ static void test_access_string(){
     FreeValue(&v);
 }
 
+//短字符串、短键存放在节点、成员内部，不申请内存
+static void test_access_short_string(){
+    CountingStats stats = {0, 0};
+    CJSONAllocator allocator = { CountingAlloc, CountingRealloc, CountingFree, NULL };
+    CJSONValue v, o, *e;
+    char s[SHORT_STRING_MAX + 2], json[64];
+    size_t i, allocs, base;
+    allocator.user = &stats;
+
+    memset(s, 'x', sizeof(s));
+    INIT_VALUE_NULL(&v);
+    SetAllocator(&allocator);
+    for(i = 0; i <= SHORT_STRING_MAX + 1; i++){
+        allocs = stats.allocs;
+        SetString(&v, s, i);
+        EXPECT_EQ_SIZE_T((size_t)(i > SHORT_STRING_MAX), stats.allocs - allocs);
+        EXPECT_EQ_SIZE_T(i, GetStringLength(&v));
+        EXPECT_EQ_TRUE(memcmp(GetString(&v), s, i) == 0 && GetString(&v)[i] == '\0');
+    }
+    FreeValue(&v);
+
+    //对象的键：不超过SHORT_KEY_MAX时存放在成员内
+    INIT_VALUE_NULL(&o);
+    SetObject(&v, 0);
+    for(i = 0; i <= SHORT_KEY_MAX + 1; i++)
+        SetString(SetObjectValue(&v, s, i), "v", 1);
+    EXPECT_EQ_SIZE_T(SHORT_KEY_MAX + 2, GetObjectSize(&v));
+    //副本只需要申请成员数组和最后一个长键
+    allocs = stats.allocs;
+    CopyValue(&o, &v);
+    EXPECT_EQ_SIZE_T(2, stats.allocs - allocs);
+    FreeValue(&v);
+    for(i = 0; i <= SHORT_KEY_MAX + 1; i++){
+        EXPECT_EQ_SIZE_T(i, FindObjectIndex(&o, s, i));
+        EXPECT_EQ_SIZE_T(i, GetObjectKeyLength(&o, i));
+        EXPECT_EQ_TRUE(memcmp(GetObjectKey(&o, i), s, i) == 0 && GetObjectKey(&o, i)[i] == '\0');
+    }
+    RemoveObjectValue(&o, SHORT_KEY_MAX + 1);
+    RemoveObjectValue(&o, 1);
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindObjectIndex(&o, s, 1));
+    EXPECT_EQ_SIZE_T(1, FindObjectIndex(&o, s, 2));
+    //替换成员的值、转移、交换都不影响成员内的键
+    e = GetObjectValue(&o, 1);
+    SetNumber(e, 1.0);
+    MoveValue(e, GetObjectValue(&o, 0));
+    SwapValue(e, GetObjectValue(&o, 2));
+    EXPECT_EQ_STRING("xx", GetObjectKey(&o, 1), GetObjectKeyLength(&o, 1));
+    EXPECT_EQ_STRING("", GetObjectKey(&o, 0), GetObjectKeyLength(&o, 0));
+    FreeValue(&o);
+    EXPECT_EQ_SIZE_T(stats.allocs, stats.frees);
+
+    //键的标记在成员里，重新初始化、解析成员的值也不影响短键和长键
+    sprintf(json, "{\"payload\":null,\"%.*s\":true}", (int)(SHORT_KEY_MAX + 1), s);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&o, json));
+    for(i = 0; i < 2; i++){
+        e = GetObjectValue(&o, i);
+        FreeValue(e);
+        INIT_VALUE_NULL(e);
+        EXPECT_EQ_INT(PARSE_OK, Parse(e, "[1,2]"));
+        EXPECT_EQ_SIZE_T(2, GetArraySize(e));
+    }
+    EXPECT_EQ_STRING("payload", GetObjectKey(&o, 0), GetObjectKeyLength(&o, 0));
+    EXPECT_EQ_SIZE_T(SHORT_KEY_MAX + 1, GetObjectKeyLength(&o, 1));
+    EXPECT_EQ_TRUE(memcmp(GetObjectKey(&o, 1), s, SHORT_KEY_MAX + 1) == 0);
+    EXPECT_EQ_TRUE(FindObjectValue(&o, "payload", 7) == GetObjectValue(&o, 0));
+    FreeValue(&o);
+    EXPECT_EQ_SIZE_T(stats.allocs, stats.frees);
+
+    //解析时同样处理，和同样结构的数字比较申请次数
+    allocs = stats.allocs;
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, "[1,2,3]"));
+    base = stats.allocs - allocs;
+    FreeValue(&v);
+    allocs = stats.allocs;
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, "[\"a\",\"\",\"\\u00e9\\n\"]"));
+    EXPECT_EQ_SIZE_T(base, stats.allocs - allocs);
+    EXPECT_EQ_STRING("\xC3\xA9\n", GetString(GetArrayElement(&v, 2)), GetStringLength(GetArrayElement(&v, 2)));
+    FreeValue(&v);
+    sprintf(json, "[\"%.*s\"]", (int)(SHORT_STRING_MAX + 1), s);
+    allocs = stats.allocs;
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));
+    EXPECT_EQ_SIZE_T(base + 1, stats.allocs - allocs);
+    FreeValue(&v);
+    allocs = stats.allocs;
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, "{\"a\":1}"));
+    base = stats.allocs - allocs;
+    FreeValue(&v);
+    for(i = SHORT_KEY_MAX; i <= SHORT_KEY_MAX + 1; i++){
+        sprintf(json, "{\"%.*s\":1}", (int)i, s);
+        allocs = stats.allocs;
+        EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));
+        EXPECT_EQ_SIZE_T(base + (i > SHORT_KEY_MAX), stats.allocs - allocs);
+        EXPECT_EQ_DOUBLE(1.0, GetNumber(FindObjectValue(&v, s, i)));
+        FreeValue(&v);
+    }
+    SetAllocator(NULL);
+    EXPECT_EQ_SIZE_T(stats.allocs, stats.frees);
+}
+
+static void test_access_array(){
+    CJSONValue a, *e;
+    char *json;
+    size_t i, length, capacity, grows;
+
+    INIT_VALUE_NULL(&a);
+    for(i = 0; i <= 5; i += 5){
+        SetArray(&a, i);
+        EXPECT_EQ_SIZE_T(0, GetArraySize(&a));
+        EXPECT_EQ_SIZE_T(i, GetArrayCapacity(&a));
+        for(capacity = 0; capacity < 10; capacity++)
+            SetNumber(PushBackArrayElement(&a), (double)capacity);
+        EXPECT_EQ_SIZE_T(10, GetArraySize(&a));
+        for(capacity = 0; capacity < 10; capacity++)
+            EXPECT_EQ_DOUBLE((double)capacity, GetNumber(GetArrayElement(&a, capacity)));
+    }
+
+    PopBackArrayElement(&a);
+    EXPECT_EQ_SIZE_T(9, GetArraySize(&a));
+    EraseArrayElement(&a, 4, 0);
+    EXPECT_EQ_SIZE_T(9, GetArraySize(&a));
+    EraseArrayElement(&a, 8, 1);
+    EraseArrayElement(&a, 0, 2);
+    EXPECT_EQ_SIZE_T(6, GetArraySize(&a));
+    EXPECT_EQ_DOUBLE(2.0, GetNumber(GetArrayElement(&a, 0)));
+    EXPECT_EQ_DOUBLE(7.0, GetNumber(GetArrayElement(&a, 5)));
+
+    SetString(InsertArrayElement(&a, 0), "first", 5);
+    SetString(InsertArrayElement(&a, 3), "mid", 3);
+    InsertArrayElement(&a, GetArraySize(&a));
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&a, &json, &length));
+    EXPECT_EQ_STRING("[\"first\",2,3,\"mid\",4,5,6,7,null]", json, length);
+    free(json);
+    //删除的元素被释放，ASan可以检查泄漏
+    EraseArrayElement(&a, 0, 4);
+    EXPECT_EQ_SIZE_T(5, GetArraySize(&a));
+
+    capacity = GetArrayCapacity(&a);
+    ClearArray(&a);
+    EXPECT_EQ_SIZE_T(0, GetArraySize(&a));
+    EXPECT_EQ_SIZE_T(capacity, GetArrayCapacity(&a));
+    ShrinkArray(&a);
+    EXPECT_EQ_SIZE_T(0, GetArrayCapacity(&a));
+    ReserveArray(&a, 3);
+    EXPECT_EQ_SIZE_T(3, GetArrayCapacity(&a));
+    SetArray(PushBackArrayElement(&a), 0);
+    SetNumber(PushBackArrayElement(GetArrayElement(&a, 0)), 1.0);
+    ShrinkArray(&a);
+    EXPECT_EQ_SIZE_T(1, GetArrayCapacity(&a));
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&a, &json, &length));
+    EXPECT_EQ_STRING("[[1]]", json, length);
+    free(json);
+    FreeValue(&a);
+
+    //解析出的数组容量等于元素个数，追加时扩展
+    EXPECT_EQ_INT(PARSE_OK, Parse(&a, "[1,[2]]"));
+    EXPECT_EQ_SIZE_T(2, GetArrayCapacity(&a));
+    SetNumber(PushBackArrayElement(GetArrayElement(&a, 1)), 3.0);
+    PushBackArrayElement(&a);
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&a, &json, &length));
+    EXPECT_EQ_STRING("[1,[2,3],null]", json, length);
+    free(json);
+
+    //连续追加时容量按比例扩展，重新分配的次数是对数级的
+    SetArray(&a, 0);
+    for(i = 0, grows = 0, capacity = 0; i < 100000; i++){
+        e = PushBackArrayElement(&a);
+        SetNumber(e, (double)i);
+        if(GetArrayCapacity(&a) != capacity){
+            capacity = GetArrayCapacity(&a);
+            grows++;
+        }
+    }
+    EXPECT_EQ_SIZE_T(100000, GetArraySize(&a));
+    EXPECT_EQ_TRUE(grows < 40);
+    EXPECT_EQ_DOUBLE(99999.0, GetNumber(GetArrayElement(&a, 99999)));
+    FreeValue(&a);
+}
+
+static void test_access_object(){
+    CJSONValue o, *v;
+    char *json, insitu[] = "{\"a\":1,\"b\":\"x\"}", key[16];
+    size_t i, length, capacity, grows;
+
+    INIT_VALUE_NULL(&o);
+    for(i = 0; i <= 5; i += 5){
+        SetObject(&o, i);
+        EXPECT_EQ_SIZE_T(0, GetObjectSize(&o));
+        EXPECT_EQ_SIZE_T(i, GetObjectCapacity(&o));
+        for(capacity = 0; capacity < 10; capacity++){
+            key[0] = (char)('a' + capacity);
+            key[1] = '\0';
+            SetNumber(SetObjectValue(&o, key, 1), (double)capacity);
+        }
+        EXPECT_EQ_SIZE_T(10, GetObjectSize(&o));
+        for(capacity = 0; capacity < 10; capacity++){
+            key[0] = (char)('a' + capacity);
+            EXPECT_EQ_SIZE_T(capacity, FindObjectIndex(&o, key, 1));
+            EXPECT_EQ_SIZE_T(1, GetObjectKeyLength(&o, capacity));
+            EXPECT_EQ_TRUE(GetObjectKey(&o, capacity)[0] == key[0]);
+            EXPECT_EQ_DOUBLE((double)capacity, GetNumber(GetObjectValue(&o, capacity)));
+        }
+    }
+
+    //已有的键返回原来的值，不追加
+    v = SetObjectValue(&o, "j", 1);
+    EXPECT_EQ_TRUE(v == GetObjectValue(&o, 9));
+    SetString(v, "ten", 3);
+    EXPECT_EQ_SIZE_T(10, GetObjectSize(&o));
+    RemoveObjectValue(&o, 0);
+    RemoveObjectValue(&o, 8);
+    EXPECT_EQ_SIZE_T(8, GetObjectSize(&o));
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindObjectIndex(&o, "a", 1));
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindObjectIndex(&o, "j", 1));
+    EXPECT_EQ_SIZE_T(0, FindObjectIndex(&o, "b", 1));
+    SetObject(SetObjectValue(&o, "", 0), 0);
+    SetNumber(SetObjectValue(FindObjectValue(&o, "", 0), "k", 1), 1.0);
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&o, &json, &length));
+    EXPECT_EQ_STRING("{\"b\":1,\"c\":2,\"d\":3,\"e\":4,\"f\":5,\"g\":6,\"h\":7,\"i\":8,\"\":{\"k\":1}}", json, length);
+    free(json);
+
+    capacity = GetObjectCapacity(&o);
+    ClearObject(&o);
+    EXPECT_EQ_SIZE_T(0, GetObjectSize(&o));
+    EXPECT_EQ_SIZE_T(capacity, GetObjectCapacity(&o));
+    ShrinkObject(&o);
+    EXPECT_EQ_SIZE_T(0, GetObjectCapacity(&o));
+    ReserveObject(&o, 2);
+    EXPECT_EQ_SIZE_T(2, GetObjectCapacity(&o));
+    FreeValue(&o);
+
+    //原位解析的键指向输入缓冲区，删除时不释放
+    EXPECT_EQ_INT(PARSE_OK, ParseInsitu(&o, insitu));
+    EXPECT_EQ_SIZE_T(2, GetObjectCapacity(&o));
+    RemoveObjectValue(&o, 1);
+    SetNumber(SetObjectValue(&o, "c", 1), 3.0);
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&o, &json, &length));
+    EXPECT_EQ_STRING("{\"a\":1,\"c\":3}", json, length);
+    free(json);
+    FreeValue(&o);
+
+    //逐个追加大量成员：哈希索引在追加时更新或按新的大小重建，整体是O(n)的
+    SetObject(&o, 0);
+    for(i = 0, grows = 0, capacity = 0; i < 100000; i++){
+        length = (size_t)sprintf(key, "k%u", (unsigned)i);
+        SetNumber(SetObjectValue(&o, key, length), (double)i);
+        if(GetObjectCapacity(&o) != capacity){
+            capacity = GetObjectCapacity(&o);
+            grows++;
+        }
+    }
+    EXPECT_EQ_SIZE_T(100000, GetObjectSize(&o));
+    EXPECT_EQ_TRUE(grows < 40);
+    for(i = 0; i < 100000; i += 997){
+        length = (size_t)sprintf(key, "k%u", (unsigned)i);
+        EXPECT_EQ_SIZE_T(i, FindObjectIndex(&o, key, length));
+    }
+    RemoveObjectValue(&o, 0);
+    EXPECT_EQ_SIZE_T(KEY_NOT_EXIST, FindObjectIndex(&o, "k0", 2));
+    EXPECT_EQ_SIZE_T(0, FindObjectIndex(&o, "k1", 2));
+    EXPECT_EQ_DOUBLE(99999.0, GetNumber(FindObjectValue(&o, "k99999", 6)));
+    FreeValue(&o);
+}
+
 #define TEST_ROUNDTRIP(json)\
     do {\
         CJSONValue v;\
@@ -368,7 +1675,175 @@ static void test_access_string(){
         free(json2);\
     } while(0)
 
+//生成v的JSON并和json比较
+static int stringify_equal(const CJSONValue *v, const char *json){
+    char *out;
+    size_t length;
+    int equal;
+    if(Stringify(v, &out, &length) != STRINGIFY_OK)
+        return 0;
+    equal = (length == strlen(json) && memcmp(out, json, length) == 0);
+    free(out);
+    return equal;
+}
+
+static void test_copy(){
+    const char *json = "{\"a\":[1,\"two\",{\"k\":null}],\"b\":{},\"c\":[],\"d\":\"\",\"e\":true}";
+    CountingStats stats = {0, 0};
+    CJSONAllocator allocator = { CountingAlloc, CountingRealloc, CountingFree, NULL };
+    CJSONDocument doc, doc2;
+    CJSONValue src, dst, *e;
+    char insitu[] = "{\"key\":\"value\",\"arr\":[\"x\"]}", key[16], *nested;
+    size_t i, length;
+
+    INIT_VALUE_NULL(&src);
+    INIT_VALUE_NULL(&dst);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&src, json));
+    CopyValue(&dst, &src);
+    FreeValue(&src);
+    EXPECT_EQ_TRUE(stringify_equal(&dst, json));
+    //副本可以修改
+    SetNumber(PushBackArrayElement(FindObjectValue(&dst, "a", 1)), 4.0);
+    CopyValue(&src, &dst);
+    EXPECT_EQ_TRUE(stringify_equal(&src, "{\"a\":[1,\"two\",{\"k\":null},4],\"b\":{},\"c\":[],\"d\":\"\",\"e\":true}"));
+    //src在dst的子树中
+    CopyValue(&dst, FindObjectValue(&dst, "a", 1));
+    EXPECT_EQ_TRUE(stringify_equal(&dst, "[1,\"two\",{\"k\":null},4]"));
+    CopyValue(&dst, GetArrayElement(&dst, 1));
+    EXPECT_EQ_TRUE(stringify_equal(&dst, "\"two\""));
+    FreeValue(&src);
+
+    //原位解析的副本不再引用输入缓冲区
+    EXPECT_EQ_INT(PARSE_OK, ParseInsitu(&src, insitu));
+    CopyValue(&dst, &src);
+    FreeValue(&src);
+    memset(insitu, 'x', sizeof(insitu) - 1);
+    EXPECT_EQ_TRUE(stringify_equal(&dst, "{\"key\":\"value\",\"arr\":[\"x\"]}"));
+
+    //文档和按需解析的节点复制到堆上，文档释放后副本仍然有效
+    InitDocument(&doc);
+    EXPECT_EQ_INT(PARSE_OK, ParseLazyInDocument(&doc, &src, json));
+    CopyValue(&dst, &src);
+    EXPECT_EQ_INT(0, dst.flags & (VALUE_FLAG_DOCUMENT | VALUE_FLAG_LAZY));
+    FreeDocument(&doc);
+    EXPECT_EQ_TRUE(stringify_equal(&dst, json));
+    EXPECT_EQ_INT(TYPE_NULL, GetType(FindObjectValue(GetArrayElement(FindObjectValue(&dst, "a", 1), 2), "k", 1)));
+
+    //大对象的副本也能按键查找
+    INIT_VALUE_NULL(&src);
+    SetObject(&src, 0);
+    for(i = 0; i < 100; i++){
+        length = (size_t)sprintf(key, "key%u", (unsigned)i);
+        SetNumber(SetObjectValue(&src, key, length), (double)i);
+    }
+    EXPECT_EQ_SIZE_T(50, FindObjectIndex(&src, "key50", 5));
+    CopyValue(&dst, &src);
+    EXPECT_EQ_DOUBLE(77.0, GetNumber(FindObjectValue(&dst, "key77", 5)));
+
+    //复制到文档中只申请一次内存，大对象同时建立索引
+    allocator.user = &stats;
+    InitDocumentWithAllocator(&doc2, &allocator);
+    CopyValueInDocument(&doc2, &dst, &src);
+    EXPECT_EQ_SIZE_T(1, stats.allocs);
+    EXPECT_EQ_TRUE(dst.flags & VALUE_FLAG_DOCUMENT);
+    EXPECT_EQ_DOUBLE(99.0, GetNumber(FindObjectValue(&dst, "key99", 5)));
+    EXPECT_EQ_SIZE_T(1, stats.allocs);
+    FreeValue(&src);
+    EXPECT_EQ_INT(PARSE_OK, ParseInDocument(&doc2, &src, json));
+    e = FindObjectValue(&src, "a", 1);
+    CopyValueInDocument(&doc2, &dst, e);
+    CopyValueInDocument(&doc2, GetArrayElement(e, 0), e);
+    EXPECT_EQ_TRUE(stringify_equal(&src, "{\"a\":[[1,\"two\",{\"k\":null}],\"two\",{\"k\":null}],\"b\":{},\"c\":[],\"d\":\"\",\"e\":true}"));
+    EXPECT_EQ_TRUE(stringify_equal(&dst, "[1,\"two\",{\"k\":null}]"));
+    FreeDocument(&doc2);
+    EXPECT_EQ_SIZE_T(stats.allocs, stats.frees);
+    INIT_VALUE_NULL(&dst);
+
+    //很深的树也不会耗尽调用栈
+    nested = make_nested(1000, 1);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&src, nested));
+    CopyValue(&dst, &src);
+    FreeValue(&src);
+    EXPECT_EQ_TRUE(stringify_equal(&dst, nested));
+    InitDocument(&doc);
+    CopyValueInDocument(&doc, &src, &dst);
+    EXPECT_EQ_TRUE(stringify_equal(&src, nested));
+    FreeDocument(&doc);
+    FreeValue(&dst);
+    free(nested);
+}
+
+static void test_move_swap(){
+    CJSONDocument doc;
+    CJSONValue a, b, *e;
+    char insitu[] = "{\"a\":\"x\",\"b\":[1]}";
+
+    INIT_VALUE_NULL(&a);
+    INIT_VALUE_NULL(&b);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&a, "[1,[\"two\",3]]"));
+    SetString(&b, "old", 3);
+    MoveValue(&b, &a);
+    EXPECT_EQ_INT(TYPE_NULL, GetType(&a));
+    EXPECT_EQ_TRUE(stringify_equal(&b, "[1,[\"two\",3]]"));
+    //src在dst的子树中
+    MoveValue(&b, GetArrayElement(&b, 1));
+    EXPECT_EQ_TRUE(stringify_equal(&b, "[\"two\",3]"));
+    SetNumber(&a, 5.0);
+    SwapValue(&a, &b);
+    EXPECT_EQ_TRUE(stringify_equal(&a, "[\"two\",3]"));
+    EXPECT_EQ_DOUBLE(5.0, GetNumber(&b));
+    SwapValue(&a, &a);
+    SwapValue(GetArrayElement(&a, 0), GetArrayElement(&a, 1));
+    EXPECT_EQ_TRUE(stringify_equal(&a, "[3,\"two\"]"));
+    FreeValue(&a);
+
+    //原位解析的键属于成员，交换、转移、重新设置值后都不会被释放
+    EXPECT_EQ_INT(PARSE_OK, ParseInsitu(&a, insitu));
+    SwapValue(GetObjectValue(&a, 0), GetObjectValue(&a, 1));
+    EXPECT_EQ_TRUE(stringify_equal(&a, "{\"a\":[1],\"b\":\"x\"}"));
+    e = SetObjectValue(&a, "c", 1);
+    SwapValue(e, GetObjectValue(&a, 0));
+    MoveValue(GetObjectValue(&a, 1), e);
+    SetNumber(GetObjectValue(&a, 2), 2.0);
+    EXPECT_EQ_TRUE(stringify_equal(&a, "{\"a\":null,\"b\":[1],\"c\":2}"));
+    MoveValue(&b, GetObjectValue(&a, 1));
+    EXPECT_EQ_TRUE(stringify_equal(&b, "[1]"));
+    FreeValue(&a);
+    FreeValue(&b);
+
+    //不持有内存的值转移、交换时，VALUE_FLAG_DOCUMENT留在原来的位置上
+    InitDocument(&doc);
+    EXPECT_EQ_INT(PARSE_OK, ParseInDocument(&doc, &a, "[1,\"a string longer than the short string buffer\"]"));
+    SetNumber(&b, 2.0);
+    MoveValue(GetArrayElement(&a, 0), &b);
+    EXPECT_EQ_TRUE(GetArrayElement(&a, 0)->flags & VALUE_FLAG_DOCUMENT);
+    EXPECT_EQ_INT(0, b.flags & VALUE_FLAG_DOCUMENT);
+    SetNumber(&b, 3.0);
+    SwapValue(&b, GetArrayElement(&a, 0));
+    EXPECT_EQ_DOUBLE(2.0, GetNumber(&b));
+    EXPECT_EQ_INT(0, b.flags & VALUE_FLAG_DOCUMENT);
+    EXPECT_EQ_TRUE(GetArrayElement(&a, 0)->flags & VALUE_FLAG_DOCUMENT);
+    SetString(&b, "x", 1);
+    EXPECT_EQ_STRING("x", GetString(&b), GetStringLength(&b));
+    FreeValue(&b);
+    //内容在文档中的值带着标志转移，不会被FreeValue释放；之后b要用INIT_VALUE_NULL才能放入其他值
+    SwapValue(&b, GetArrayElement(&a, 1));
+    EXPECT_EQ_TRUE(b.flags & VALUE_FLAG_DOCUMENT);
+    EXPECT_EQ_TRUE(GetArrayElement(&a, 1)->flags & VALUE_FLAG_DOCUMENT);
+    EXPECT_EQ_INT(TYPE_NULL, GetType(GetArrayElement(&a, 1)));
+    MoveValue(GetArrayElement(&a, 1), &b);
+    EXPECT_EQ_TRUE(GetArrayElement(&a, 1)->flags & VALUE_FLAG_DOCUMENT);
+    EXPECT_EQ_TRUE(stringify_equal(&a, "[3,\"a string longer than the short string buffer\"]"));
+    INIT_VALUE_NULL(&b);
+    FreeDocument(&doc);
+}
+
 static void test_stringify(){
+    //返回值的数值是接口的一部分，新增的返回值不能改变已有的值
+    EXPECT_EQ_INT(11, PARSE_MISS_COMMA_OR_CURLY_BRACKET);
+    EXPECT_EQ_INT(12, STRINGIFY_OK);
+    EXPECT_EQ_INT(STRINGIFY_OK + 1, PARSE_TERMINATED);
+
     TEST_ROUNDTRIP("null");
     TEST_ROUNDTRIP("false");
     TEST_ROUNDTRIP("true");
@@ -382,16 +1857,334 @@ static void test_stringify(){
     TEST_ROUNDTRIP("-1.234");
     TEST_ROUNDTRIP("1.23e-20");
     TEST_ROUNDTRIP("1.23e+20");
+    TEST_ROUNDTRIP("0.1");
+    TEST_ROUNDTRIP("0.001");
+    TEST_ROUNDTRIP("1.5e-05");
+    TEST_ROUNDTRIP("123456.789");
+    TEST_ROUNDTRIP("9007199254740991");
+    TEST_ROUNDTRIP("-9007199254740991");
+    TEST_ROUNDTRIP("9007199254740992");
+    TEST_ROUNDTRIP("10000000000000000");
+    TEST_ROUNDTRIP("1e+17");
+    TEST_ROUNDTRIP("1e+100");
+    TEST_ROUNDTRIP("1.0000000000000002"); /* the smallest number > 1 */
+    TEST_ROUNDTRIP("5e-324"); /* minimum denormal */
+    TEST_ROUNDTRIP("-5e-324");
+    TEST_ROUNDTRIP("2.225073858507201e-308");  /* Max subnormal double */
+    TEST_ROUNDTRIP("2.2250738585072014e-308");  /* Min normal positive double */
+    TEST_ROUNDTRIP("1.7976931348623157e+308");  /* Max double */
+    TEST_ROUNDTRIP("-1.7976931348623157e+308");
     
     TEST_ROUNDTRIP("\"abcdef\"");
-    // TEST_ROUNDTRIP("\"\"");
-    // TEST_ROUNDTRIP("\"Hello\nWorld\"");
+    TEST_ROUNDTRIP("\"\"");
+    TEST_ROUNDTRIP("\"Hello\\nWorld\"");
+    TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
+    TEST_ROUNDTRIP("{\"k\\\"ey\\n\":\"v\\\\\"}");
 
     TEST_ROUNDTRIP("[123,234,[1,2]]");
 
     TEST_ROUNDTRIP("{\"employees\":[{\"firstName\":\"Bill\",\"lastName\":\"Gates\"},{\"firstName\":\"George\",\"lastName\":\"Bush\"},{\"firstName\":\"Thomas\",\"lastName\":\"Carter\"}]}");
 }
 
+#define TEST_STRINGIFY_INTO(json)\
+    do {\
+        CJSONValue v;\
+        char *json2;\
+        size_t length, length2;\
+        INIT_VALUE_NULL(&v);\
+        EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));\
+        length = StringifiedLength(&v);\
+        EXPECT_EQ_SIZE_T(sizeof(json) - 1, length);\
+        json2 = (char *)malloc(length + 1);\
+        memset(json2, '#', length + 1);\
+        if(length > 0)\
+            EXPECT_EQ_INT(STRINGIFY_BUFFER_TOO_SMALL, StringifyInto(&v, json2, length - 1, &length2));\
+        EXPECT_EQ_SIZE_T(length, length2);\
+        EXPECT_EQ_TRUE(json2[0] == '#');\
+        EXPECT_EQ_INT(STRINGIFY_OK, StringifyInto(&v, json2, length, &length2));\
+        EXPECT_EQ_STRING(json, json2, length2);\
+        EXPECT_EQ_TRUE(json2[length] == '#');\
+        EXPECT_EQ_INT(STRINGIFY_OK, StringifyInto(&v, json2, length + 1, NULL));\
+        EXPECT_EQ_TRUE(json2[length] == '\0');\
+        FreeValue(&v);\
+        free(json2);\
+    } while(0)
+
+static void test_stringify_into(){
+    size_t length;
+    CJSONValue v;
+
+    TEST_STRINGIFY_INTO("null");
+    TEST_STRINGIFY_INTO("false");
+    TEST_STRINGIFY_INTO("true");
+    TEST_STRINGIFY_INTO("0");
+    TEST_STRINGIFY_INTO("-1.5");
+    TEST_STRINGIFY_INTO("1.23e-20");
+    TEST_STRINGIFY_INTO("-1.7976931348623157e+308");
+    TEST_STRINGIFY_INTO("5e-324");
+    TEST_STRINGIFY_INTO("\"\"");
+    TEST_STRINGIFY_INTO("\"abcdef\"");
+    TEST_STRINGIFY_INTO("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
+    TEST_STRINGIFY_INTO("[]");
+    TEST_STRINGIFY_INTO("{}");
+    TEST_STRINGIFY_INTO("[[],{},[{}]]");
+    TEST_STRINGIFY_INTO("[123,234,[1,2]]");
+    TEST_STRINGIFY_INTO("{\"a\":[true,false,null],\"\":{\"c\":\"d\"},\"n\":0.1}");
+
+    /*只计算需要的长度*/
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, "[1, 2, 3]"));
+    EXPECT_EQ_INT(STRINGIFY_BUFFER_TOO_SMALL, StringifyInto(&v, NULL, 0, &length));
+    EXPECT_EQ_SIZE_T(7, length);
+    FreeValue(&v);
+}
+
+/*收集输出函数写出的内容，fail不为0时第fail次调用返回失败*/
+typedef struct{
+    char *buf;
+    size_t len;
+    size_t calls;
+    size_t fail;
+}TestWriter;
+
+static int TestWrite(void *user, const char *buf, size_t len){
+    TestWriter *w = (TestWriter *)user;
+    w->calls++;
+    if(w->fail != 0 && w->calls >= w->fail)
+        return 0;
+    w->buf = (char *)realloc(w->buf, w->len + len);
+    memcpy(w->buf + w->len, buf, len);
+    w->len += len;
+    return 1;
+}
+
+#define TEST_STRINGIFY_WRITER(json)\
+    do {\
+        CJSONValue v;\
+        TestWriter w = { NULL, 0, 0, 0 };\
+        INIT_VALUE_NULL(&v);\
+        EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));\
+        EXPECT_EQ_INT(STRINGIFY_OK, StringifyToWriter(&v, TestWrite, &w));\
+        EXPECT_EQ_STRING(json, w.buf, w.len);\
+        FreeValue(&v);\
+        free(w.buf);\
+    } while(0)
+
+static void test_stringify_writer(){
+    CJSONValue v;
+    TestWriter w = { NULL, 0, 0, 0 };
+    char *json, *json2;
+    size_t i, length, n = 20000;
+    FILE *fp;
+
+    TEST_STRINGIFY_WRITER("null");
+    TEST_STRINGIFY_WRITER("-1.5");
+    TEST_STRINGIFY_WRITER("\"\"");
+    TEST_STRINGIFY_WRITER("[123,234,[1,2]]");
+    TEST_STRINGIFY_WRITER("{\"a\":[true,false,null],\"b\":{\"c\":\"d\"}}");
+
+    /*大数组分多次输出，拼起来和Stringify的结果相同*/
+    json = (char *)malloc(n * 8 + 2);
+    length = 0;
+    json[length++] = '[';
+    for(i = 0; i < n; i++)
+        length += sprintf(json + length, "%u,", (unsigned)(i * 7));
+    json[length - 1] = ']';
+    json[length] = '\0';
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));
+    EXPECT_EQ_INT(STRINGIFY_OK, StringifyToWriter(&v, TestWrite, &w));
+    EXPECT_EQ_TRUE(w.calls > 1);
+    EXPECT_EQ_SIZE_T(length, w.len);
+    EXPECT_EQ_TRUE(memcmp(json, w.buf, length) == 0);
+    FreeValue(&v);
+    free(w.buf);
+    free(json);
+
+    /*比缓冲区还长的字符串直接交给输出函数*/
+    n = 100000;
+    json = (char *)malloc(n + 3);
+    json[0] = json[n + 1] = '\"';
+    memset(json + 1, 'x', n);
+    json[n + 2] = '\0';
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));
+    w.buf = NULL;
+    w.len = w.calls = 0;
+    EXPECT_EQ_INT(STRINGIFY_OK, StringifyToWriter(&v, TestWrite, &w));
+    EXPECT_EQ_SIZE_T(3, w.calls);
+    EXPECT_EQ_SIZE_T(n + 2, w.len);
+    EXPECT_EQ_TRUE(memcmp(json, w.buf, n + 2) == 0);
+    free(w.buf);
+
+    /*输出失败后不再调用输出函数*/
+    w.buf = NULL;
+    w.len = w.calls = 0;
+    w.fail = 1;
+    EXPECT_EQ_INT(STRINGIFY_WRITE_ERROR, StringifyToWriter(&v, TestWrite, &w));
+    EXPECT_EQ_SIZE_T(1, w.calls);
+    EXPECT_EQ_SIZE_T(0, w.len);
+    FreeValue(&v);
+    free(json);
+
+    /*写入FILE和文件描述符*/
+    INIT_VALUE_NULL(&v);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, "{\"k\":[1,\"two\",3.5]}"));
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &json2, &length));
+    if((fp = tmpfile()) != NULL){
+        char buf[64];
+        EXPECT_EQ_INT(STRINGIFY_OK, StringifyToFile(&v, fp));
+        rewind(fp);
+        EXPECT_EQ_SIZE_T(length, fread(buf, 1, sizeof(buf), fp));
+        EXPECT_EQ_TRUE(memcmp(json2, buf, length) == 0);
+        fclose(fp);
+    }
+    if((fp = tmpfile()) != NULL){
+        char buf[64];
+        EXPECT_EQ_INT(STRINGIFY_OK, StringifyToFd(&v, fileno(fp)));
+        rewind(fp);
+        EXPECT_EQ_SIZE_T(length, fread(buf, 1, sizeof(buf), fp));
+        EXPECT_EQ_TRUE(memcmp(json2, buf, length) == 0);
+        fclose(fp);
+    }
+    free(json2);
+    FreeValue(&v);
+}
+
+//inf、nan在JSON中没有对应的表示，生成时报错，而不是输出一个看起来正常的数
+static void test_stringify_invalid_number(){
+    const double values[] = { HUGE_VAL, -HUGE_VAL, NAN };
+    TestWriter w = { NULL, 0, 0, 0 };
+    CJSONValue v, *e;
+    char buf[64] = "unchanged", *json = buf, *nested;
+    size_t i, length = 7;
+
+    INIT_VALUE_NULL(&v);
+    for(i = 0; i < sizeof(values) / sizeof(values[0]); i++){
+        SetNumber(&v, values[i]);
+        EXPECT_EQ_INT(STRINGIFY_INVALID_NUMBER, Stringify(&v, &json, &length));
+        EXPECT_EQ_TRUE(json == NULL);
+        EXPECT_EQ_SIZE_T(INVALID_LENGTH, StringifiedLength(&v));
+        EXPECT_EQ_INT(STRINGIFY_INVALID_NUMBER, StringifyInto(&v, buf, sizeof(buf), &length));
+        EXPECT_EQ_SIZE_T(7, length);
+        EXPECT_EQ_STRING("unchanged", buf, strlen(buf));
+    }
+
+    //嵌套在很深的数组、对象中时，遍历用的栈也要释放
+    nested = make_nested(100, 1);
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, nested));
+    for(e = &v; GetType(e) == TYPE_OBJECT; e = GetObjectValue(e, 0))
+        ;
+    SetNumber(e, NAN);
+    EXPECT_EQ_INT(STRINGIFY_INVALID_NUMBER, Stringify(&v, &json, &length));
+    EXPECT_EQ_SIZE_T(INVALID_LENGTH, StringifiedLength(&v));
+    EXPECT_EQ_INT(STRINGIFY_INVALID_NUMBER, StringifyInto(&v, buf, sizeof(buf), &length));
+    EXPECT_EQ_INT(STRINGIFY_INVALID_NUMBER, StringifyToWriter(&v, TestWrite, &w));
+    SetNumber(e, 1.0);
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &json, &length));
+    EXPECT_EQ_TRUE(length == strlen(nested) && memcmp(json, nested, length) == 0);
+    free(json);
+    free(nested);
+    free(w.buf);
+    FreeValue(&v);
+}
+
+static void test_stringify_escape(){
+    CJSONValue v;
+    char *json, *s;
+    size_t length, i, n = 40000;
+    TestWriter w = { NULL, 0, 0, 0 };
+
+    /*没有简写的控制字符输出为\u00XX，'/'不转义*/
+    INIT_VALUE_NULL(&v);
+    SetString(&v, "\x01/\x1f\x7f", 4);
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &json, &length));
+    EXPECT_EQ_STRING("\"\\u0001/\\u001F\x7f\"", json, length);
+    EXPECT_EQ_SIZE_T(length, StringifiedLength(&v));
+    free(json);
+
+    /*字符串中间的'\0'*/
+    SetString(&v, "a\0b", 3);
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &json, &length));
+    EXPECT_EQ_STRING("\"a\\u0000b\"", json, length);
+    free(json);
+
+    /*大量转义字符跨越输出缓冲区的边界*/
+    s = (char *)malloc(n);
+    for(i = 0; i < n; i++)
+        s[i] = "a\"\\\n\x02"[i % 5];
+    SetString(&v, s, n);
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &json, &length));
+    EXPECT_EQ_SIZE_T(n / 5 * 13 + 2, length);
+    EXPECT_EQ_SIZE_T(length, StringifiedLength(&v));
+    EXPECT_EQ_INT(STRINGIFY_OK, StringifyToWriter(&v, TestWrite, &w));
+    EXPECT_EQ_SIZE_T(length, w.len);
+    EXPECT_EQ_TRUE(memcmp(json, w.buf, length) == 0);
+    FreeValue(&v);
+    free(json);
+    free(w.buf);
+    free(s);
+}
+
+/*编译时定义CJSON_STATS才有统计，否则GetStats全部为0；测试也需要同样定义CJSON_STATS*/
+static void test_stats(){
+    const char *json = " {\"a\":[1,true,null,\"xy\"],\"b\":{}} ";
+    CJSONStats s, zero;
+    CJSONValue v;
+    TestWriter w = { NULL, 0, 0, 0 };
+    char *out;
+    size_t len;
+
+    memset(&zero, 0, sizeof(zero));
+    ResetStats();
+    EXPECT_EQ_INT(PARSE_OK, Parse(&v, json));
+    EXPECT_EQ_INT(STRINGIFY_OK, Stringify(&v, &out, &len));
+    GetStats(&s);
+#if defined(CJSON_STATS)
+    char insitu[] = "[\"abc\"]";
+    EXPECT_EQ_SIZE_T(1, s.parses);
+    EXPECT_EQ_SIZE_T(strlen(json), s.parseBytes);
+    EXPECT_EQ_SIZE_T(1, s.nodes[TYPE_NULL]);
+    EXPECT_EQ_SIZE_T(0, s.nodes[TYPE_FALSE]);
+    EXPECT_EQ_SIZE_T(1, s.nodes[TYPE_TRUE]);
+    EXPECT_EQ_SIZE_T(1, s.nodes[TYPE_NUMBER]);
+    EXPECT_EQ_SIZE_T(1, s.nodes[TYPE_STRING]);
+    EXPECT_EQ_SIZE_T(1, s.nodes[TYPE_ARRAY]);
+    EXPECT_EQ_SIZE_T(2, s.nodes[TYPE_OBJECT]);
+    EXPECT_EQ_SIZE_T(2, s.keys);
+    EXPECT_EQ_SIZE_T(4, s.stringBytes);
+    EXPECT_EQ_SIZE_T(2, s.maxDepth);
+    EXPECT_EQ_TRUE(s.parseStackPeak >= 5 * sizeof(CJSONValue));
+    EXPECT_EQ_TRUE(s.stackReallocs >= 1);
+    EXPECT_EQ_SIZE_T(1, s.stringifies);
+    EXPECT_EQ_SIZE_T(len, s.stringifyBytes);
+    EXPECT_EQ_TRUE(s.stringifyStackPeak >= len);
+
+    //流式生成的字节数在输出时统计，出错时的字节数算到出错的位置
+    ResetStats();
+    EXPECT_EQ_INT(STRINGIFY_OK, StringifyToWriter(&v, TestWrite, &w));
+    FreeValue(&v);
+    EXPECT_EQ_INT(PARSE_INVALID_VALUE, Parse(&v, "[1,x]"));
+    EXPECT_EQ_INT(PARSE_OK, ParseInsitu(&v, insitu));
+    GetStats(&s);
+    EXPECT_EQ_SIZE_T(1, s.stringifies);
+    EXPECT_EQ_SIZE_T(w.len, s.stringifyBytes);
+    EXPECT_EQ_SIZE_T(2, s.parses);
+    EXPECT_EQ_SIZE_T(3 + strlen("[\"abc\"]"), s.parseBytes);
+    EXPECT_EQ_SIZE_T(0, s.stringBytes);
+    EXPECT_EQ_SIZE_T(2, s.nodes[TYPE_NUMBER] + s.nodes[TYPE_STRING]);
+    EXPECT_EQ_SIZE_T(1, s.nodes[TYPE_ARRAY]);
+    FreeValue(&v);
+
+    ResetStats();
+    GetStats(&s);
+#endif
+    EXPECT_EQ_TRUE(memcmp(&zero, &s, sizeof(s)) == 0);
+    free(out);
+    free(w.buf);
+    FreeValue(&v);
+}
+
 static void test_parse(){
     test_parse_null();
     test_parse_true();
@@ -400,6 +2193,19 @@ static void test_parse(){
     test_parse_string();
     test_parse_array();
     test_parse_object();
+    test_parse_insitu();
+    test_parse_n();
+    test_parse_document();
+    test_parse_lazy();
+    test_parse_parallel();
+    test_parse_lines();
+    test_parse_depth();
+    test_find_object_value();
+    test_parse_tape();
+    test_parse_allocator();
+    test_parse_handler();
+    test_parser();
+    test_parser_parse();
 
     test_parse_expect_value();
     test_parse_invalid_value();
@@ -408,6 +2214,9 @@ static void test_parse(){
     test_parse_missing_quotation_mark();
     test_parse_invalid_string_escape();
     test_parse_invalid_string_char();
+    test_parse_invalid_unicode_hex();
+    test_parse_invalid_unicode_surrogate();
+    test_parse_invalid_utf8();
     test_parse_miss_comma_or_square_bracket();
     test_parse_miss_key();
     test_parse_miss_colon();
@@ -417,11 +2226,21 @@ static void test_parse(){
     test_access_boolean();
     test_access_number();
     test_access_string();
+    test_access_short_string();
+    test_access_array();
+    test_access_object();
+    test_copy();
+    test_move_swap();
 }
 
 int main(){
     test_parse();
     test_stringify();
+    test_stringify_writer();
+    test_stringify_invalid_number();
+    test_stringify_into();
+    test_stringify_escape();
+    test_stats();
     printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
     return main_ret;
 }